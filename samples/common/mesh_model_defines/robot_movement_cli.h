@@ -5,6 +5,8 @@
 
 #define OP_VND_ROBOT_MOVEMENT_SET_STATUS BT_MESH_MODEL_OP_3(0x03, CONFIG_BT_COMPANY_ID)
 #define OP_VND_ROBOT_MOVEMENT_DONE_STATUS BT_MESH_MODEL_OP_3(0x04, CONFIG_BT_COMPANY_ID)
+#define OP_VND_ROBOT_MOVEMENT_SET_MULTI_STATUS BT_MESH_MODEL_OP_3(0x06, CONFIG_BT_COMPANY_ID)
+#define OP_VND_ROBOT_PARAMS_STATUS BT_MESH_MODEL_OP_3(0x08, CONFIG_BT_COMPANY_ID)
 
 /**
  * @brief ACK/Status message for movement set operation
@@ -15,6 +17,31 @@ struct robot_movement_set_status_msg
 
 };
 
+/**
+ * @brief ACK/Status message for multicast movement set operation
+ */
+struct robot_movement_set_multi_status_msg
+{
+    uint8_t tid;
+    uint8_t status;
+};
+
+enum robot_params_status
+{
+    ROBOT_PARAMS_STATUS_OK,
+    ROBOT_PARAMS_STATUS_CRC_MISMATCH, /* Resent by the gateway. */
+    ROBOT_PARAMS_STATUS_INVALID,
+};
+
+/**
+ * @brief ACK/Status message for parameter set operation
+ */
+struct robot_params_status_msg
+{
+    uint8_t tid;
+    uint8_t status; /* enum robot_params_status */
+};
+
 /**
  * @brief ACK/Status message for clear to move operation
  */
@@ -3,11 +3,83 @@
 
 #define ROBOT_MOVEMENT_SRV_MODEL_ID 0x0001
 
+/* Group addresses the movement server of a robot can subscribe to, such as its team and arena.
+ * Commands sent to a group reach all its robots with one message.
+ */
+#define ROBOT_MOVEMENT_SRV_GROUPS_MAX 4
+
 #define OP_VND_ROBOT_MOVEMENT_GET  BT_MESH_MODEL_OP_3(0x00, CONFIG_BT_COMPANY_ID)
 #define OP_VND_ROBOT_MOVEMENT_SET  BT_MESH_MODEL_OP_3(0x01, CONFIG_BT_COMPANY_ID)
 #define OP_VND_ROBOT_CLEAR_TO_MOVE BT_MESH_MODEL_OP_3(0x02, CONFIG_BT_COMPANY_ID)
+#define OP_VND_ROBOT_MOVEMENT_SET_MULTI BT_MESH_MODEL_OP_3(0x05, CONFIG_BT_COMPANY_ID)
+#define OP_VND_ROBOT_PARAMS_SET BT_MESH_MODEL_OP_3(0x07, CONFIG_BT_COMPANY_ID)
 
 struct robot_movement_set_msg {
     uint32_t time;
     int32_t angle;
-};
\ No newline at end of file
+};
+
+/**
+ * @brief Clear to move with the time to start at.
+ *
+ * The start time is in the time base of the gateway, in milliseconds. As robots do not know that
+ * time base, the message also carries the time left until the start when it was sent, and the
+ * TTL it was sent with, so that a robot can account for the hops it took. The gateway sends the
+ * message several times with the same start time. On the wire all fields are big endian.
+ */
+struct robot_clear_to_move_msg {
+    uint32_t start_ms;
+    uint16_t delay_ms;
+    uint8_t ttl;
+};
+
+#define ROBOT_CLEAR_TO_MOVE_MSG_LEN (sizeof(uint32_t) + sizeof(uint16_t) + sizeof(uint8_t))
+
+/**
+ * @brief Movement configuration of one robot in a multicast movement set.
+ *
+ * OP_VND_ROBOT_MOVEMENT_SET_MULTI carries a transaction id followed by entries for many robots.
+ * On the wire every entry is the big endian address, time and angle. Each robot applies the
+ * entry with its own address and answers with OP_VND_ROBOT_MOVEMENT_SET_MULTI_STATUS.
+ */
+struct robot_movement_set_multi_entry {
+    uint16_t addr;
+    struct robot_movement_set_msg config;
+};
+
+#define ROBOT_MOVEMENT_SET_MULTI_ENTRY_LEN (sizeof(uint16_t) + sizeof(struct robot_movement_set_msg))
+
+/* Entries that fit in one message with a three byte opcode and the transaction id. */
+#define ROBOT_MOVEMENT_SET_MULTI_MAX \
+    ((BT_MESH_TX_SDU_MAX - BT_MESH_MIC_SHORT - 3 - 1) / ROBOT_MOVEMENT_SET_MULTI_ENTRY_LEN)
+
+/* Steps of the longest movement script in a parameter set. With the 3 byte opcode and the
+ * transport MIC the message takes 10 segments, see ROBOT_PARAMS_SET_MSG_LEN().
+ */
+#define ROBOT_PARAMS_STEPS_MAX 12
+
+/**
+ * @brief Movement parameters and script of a robot, sent in one segmented message.
+ *
+ * OP_VND_ROBOT_PARAMS_SET carries a transaction id and a CRC-32 (IEEE) of the rest of the
+ * message, then the PID gains for turning, the power trims of the motors, the number of steps
+ * and the steps of the script. The robot checks the CRC before it takes anything from the
+ * message, and answers with OP_VND_ROBOT_PARAMS_STATUS. On the wire all fields are big endian.
+ */
+struct robot_params {
+    int16_t kp; /* Gains in thousandths. */
+    int16_t ki;
+    int16_t kd;
+    int16_t trim_a; /* Thousandths of full power added to motor A, at most ROBOT_PARAMS_TRIM_MAX either way. */
+    int16_t trim_b;
+    uint8_t step_count;
+    struct robot_movement_set_msg steps[ROBOT_PARAMS_STEPS_MAX];
+};
+
+#define ROBOT_PARAMS_TRIM_MAX 1000
+
+/* Transaction id and CRC, followed by the CRC protected part. */
+#define ROBOT_PARAMS_SET_HEADER_LEN (sizeof(uint8_t) + sizeof(uint32_t))
+#define ROBOT_PARAMS_SET_MSG_LEN(_steps) \
+    (ROBOT_PARAMS_SET_HEADER_LEN + 5 * sizeof(int16_t) + sizeof(uint8_t) + \
+     (_steps) * sizeof(struct robot_movement_set_msg))
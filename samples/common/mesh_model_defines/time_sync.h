@@ -0,0 +1,25 @@
+#pragma once
+#include <zephyr/bluetooth/mesh/access.h>
+
+#define TIME_SYNC_SRV_MODEL_ID 0x0003
+#define TIME_SYNC_CLI_MODEL_ID 0x0004
+
+#define OP_VND_TIME_SYNC_BEACON BT_MESH_MODEL_OP_3(0x07, CONFIG_BT_COMPANY_ID)
+
+/**
+ * @brief Time beacon from the gateway.
+ *
+ * The time a message is sent at is only known once it goes on air, so each beacon carries the
+ * time the previous beacon was sent at, in microseconds of gateway uptime. A receiver pairs it
+ * with the time it received the previous beacon. The TTL the beacon was sent with tells how many
+ * relays it passed. On the wire the time is a big endian 48 bit value, 0 if the time of the
+ * previous beacon is not known.
+ */
+struct time_sync_beacon_msg
+{
+    uint8_t seq;
+    uint8_t ttl;
+    uint64_t prev_tx_us;
+};
+
+#define TIME_SYNC_BEACON_MSG_LEN (2 * sizeof(uint8_t) + 6)
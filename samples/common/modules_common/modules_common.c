@@ -0,0 +1,719 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <zephyr/kernel.h>
+#include <zephyr/types.h>
+#include <string.h>
+#include <zephyr/drivers/watchdog.h>
+#include <app_event_manager.h>
+#include "modules_common.h"
+
+#include <zephyr/logging/log.h>
+
+LOG_MODULE_REGISTER(modules_common, CONFIG_MODULES_COMMON_LOG_LEVEL);
+
+struct event_prototype {
+	struct app_event_header header;
+	uint8_t event_id;
+};
+
+/* Header prepended to every application event allocation. It records the size of the event and
+ * holds a reference count, so that an event can be shared between module queues without being
+ * copied. The Application Event Manager owns the initial reference. The size is kept as a 32-bit
+ * value so that the event that follows stays 8-byte aligned.
+ */
+struct event_ref {
+	atomic_t ref;
+	uint32_t size;
+};
+
+/* List containing metadata on active modules in the application. */
+static sys_slist_t module_list = SYS_SLIST_STATIC_INIT(&module_list);
+static K_MUTEX_DEFINE(module_list_lock);
+
+/* Structure containing general information about the modules in the application. */
+static struct modules_info {
+	/* Modules that support shutdown. */
+	atomic_t shutdown_supported_count;
+	/* Number of active modules in the application. */
+	atomic_t active_modules_count;
+} modules_info;
+
+#if defined(CONFIG_MODULES_COMMON_DISPATCH_STATS)
+/* Number of events routed and number of times an event was delivered to a module. */
+static struct {
+	uint32_t events;
+	uint32_t deliveries;
+} route_stats;
+#endif
+
+static struct event_ref *event_ref_hdr(const void *event)
+{
+	return (struct event_ref *)((uint8_t *)event - sizeof(struct event_ref));
+}
+
+static void event_ref_get(const void *event)
+{
+	atomic_inc(&event_ref_hdr(event)->ref);
+}
+
+static void event_ref_put(const void *event)
+{
+	struct event_ref *ref = event_ref_hdr(event);
+
+	if (atomic_dec(&ref->ref) == 1) {
+		k_free(ref);
+	}
+}
+
+static void event_log(const struct module_data *module, const struct app_event_header *aeh)
+{
+	struct event_type *event = (struct event_type *)aeh->type_id;
+
+	if (event->log_event_func) {
+		event->log_event_func(aeh);
+	}
+#ifdef CONFIG_APP_EVENT_MANAGER_USE_DEPRECATED_LOG_FUN
+	else if (event->log_event_func_dep) {
+		char buf[50];
+
+		event->log_event_func_dep(aeh, buf, sizeof(buf));
+		LOG_DBG("%s module: Dequeued %s",
+			module->name,
+			log_strdup(buf));
+	}
+#endif
+}
+
+static void enqueue_stats_update(struct module_data *module, int err, uint32_t start)
+{
+#if defined(CONFIG_MODULES_COMMON_DISPATCH_STATS)
+	if (err) {
+		module->stats.dropped++;
+		return;
+	}
+
+	module->stats.enqueued++;
+	module->stats.enqueue_cycles += k_cycle_get_32() - start;
+#endif
+}
+
+#if defined(CONFIG_MODULES_COMMON_SUPERVISOR)
+static void supervision_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(supervision_work, supervision_work_fn);
+
+#if defined(CONFIG_MODULES_COMMON_SUPERVISOR_WATCHDOG)
+static const struct device *const wdt = DEVICE_DT_GET_OR_NULL(DT_ALIAS(watchdog0));
+static int wdt_channel = -1;
+#endif
+
+static uint32_t supervision_now(void)
+{
+	/* 0 is reserved for "not pending". */
+	return MAX(k_uptime_get_32(), 1);
+}
+
+static uint32_t supervision_budget(const struct module_data *module)
+{
+	return module->handler_budget_ms ? module->handler_budget_ms :
+					   CONFIG_MODULES_COMMON_HANDLER_BUDGET_MS;
+}
+
+static void supervision_enqueued(struct module_data *module)
+{
+	atomic_cas(&module->supervision.pending_since, 0, supervision_now());
+}
+
+static void supervision_handler_start(struct module_data *module, bool more_pending)
+{
+	struct module_supervision *sv = &module->supervision;
+	uint32_t now = supervision_now();
+
+	sv->handler_start = k_cycle_get_32();
+	atomic_set(&sv->busy_since, now);
+	atomic_set(&sv->busy, 1);
+	atomic_set(&sv->pending_since, more_pending ? now : 0);
+}
+
+static void supervision_handler_end(struct module_data *module)
+{
+	struct module_supervision *sv = &module->supervision;
+	uint32_t us = k_cyc_to_us_floor32(k_cycle_get_32() - sv->handler_start);
+	size_t bucket = us ? (32 - __builtin_clz(us)) : 0;
+
+	sv->hist[MIN(bucket, ARRAY_SIZE(sv->hist) - 1)]++;
+	sv->max_us = MAX(sv->max_us, us);
+
+	if ((us / USEC_PER_MSEC) > supervision_budget(module)) {
+		sv->overruns++;
+	}
+
+	atomic_set(&sv->last_progress, supervision_now());
+	atomic_set(&sv->busy, 0);
+}
+
+static bool supervision_module_stuck(struct module_data *module, uint32_t now)
+{
+	struct module_supervision *sv = &module->supervision;
+	uint32_t budget = supervision_budget(module);
+	uint32_t pending_since = atomic_get(&sv->pending_since);
+
+	if (atomic_get(&sv->busy)) {
+		return (now - (uint32_t)atomic_get(&sv->busy_since)) > budget;
+	}
+
+	return pending_since && ((now - pending_since) > budget);
+}
+
+static void supervision_work_fn(struct k_work *work)
+{
+	struct module_data *module;
+	uint32_t now = supervision_now();
+	bool healthy = true;
+
+	k_mutex_lock(&module_list_lock, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER(&module_list, module, header) {
+		struct module_supervision *sv = &module->supervision;
+
+		if (!supervision_module_stuck(module, now)) {
+			sv->stalls = 0;
+			continue;
+		}
+
+		sv->stalls++;
+
+		if ((sv->stalls == 1) && module->recover) {
+			LOG_ERR("Module \"%s\" is stuck, last progress %d ms ago, recovering",
+				module->name, now - (uint32_t)atomic_get(&sv->last_progress));
+			module->recover();
+			continue;
+		}
+
+		LOG_ERR("Module \"%s\" is stuck, last progress %d ms ago",
+			module->name, now - (uint32_t)atomic_get(&sv->last_progress));
+		healthy = false;
+	}
+	k_mutex_unlock(&module_list_lock);
+
+#if defined(CONFIG_MODULES_COMMON_SUPERVISOR_WATCHDOG)
+	/* A module that could not be recovered is left to the hardware watchdog. */
+	if (healthy && (wdt_channel >= 0)) {
+		wdt_feed(wdt, wdt_channel);
+	}
+#endif
+
+	k_work_reschedule(&supervision_work, K_MSEC(CONFIG_MODULES_COMMON_SUPERVISOR_PERIOD_MS));
+}
+
+static int supervision_init(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+
+#if defined(CONFIG_MODULES_COMMON_SUPERVISOR_WATCHDOG)
+	int err;
+	struct wdt_timeout_cfg wdt_config = {
+		.window.min = 0,
+		.window.max = CONFIG_MODULES_COMMON_SUPERVISOR_WATCHDOG_TIMEOUT_MS,
+		.callback = NULL,
+		.flags = WDT_FLAG_RESET_SOC,
+	};
+
+	if (!device_is_ready(wdt)) {
+		LOG_ERR("Watchdog device not ready");
+		return -ENODEV;
+	}
+
+	wdt_channel = wdt_install_timeout(wdt, &wdt_config);
+	if (wdt_channel < 0) {
+		LOG_ERR("wdt_install_timeout, error: %d", wdt_channel);
+		return wdt_channel;
+	}
+
+	err = wdt_setup(wdt, WDT_OPT_PAUSE_HALTED_BY_DBG);
+	if (err) {
+		LOG_ERR("wdt_setup, error: %d", err);
+		wdt_channel = -1;
+		return err;
+	}
+#endif
+
+	k_work_schedule(&supervision_work, K_MSEC(CONFIG_MODULES_COMMON_SUPERVISOR_PERIOD_MS));
+
+	return 0;
+}
+
+SYS_INIT(supervision_init, APPLICATION, CONFIG_APPLICATION_INIT_PRIORITY);
+#endif /* CONFIG_MODULES_COMMON_SUPERVISOR */
+
+/* Overrides of the Application Event Manager allocator. Every event is allocated with a
+ * struct event_ref in front of it, and is freed when the last reference is released.
+ */
+void *app_event_manager_alloc(size_t size)
+{
+	struct event_ref *ref = k_malloc(sizeof(struct event_ref) + size);
+
+	if (unlikely(!ref)) {
+		LOG_ERR("Application Event Manager OOM error");
+		__ASSERT_NO_MSG(false);
+		k_panic();
+		return NULL;
+	}
+
+	atomic_set(&ref->ref, 1);
+	ref->size = size;
+
+	return ref + 1;
+}
+
+void app_event_manager_free(void *addr)
+{
+	event_ref_put(addr);
+}
+
+static void queue_purge(struct k_msgq *msg_q)
+{
+	if (IS_ENABLED(CONFIG_MODULES_COMMON_ZERO_COPY)) {
+		const struct app_event_header *aeh;
+
+		/* Queued pointers own a reference that must be released. */
+		while (k_msgq_get(msg_q, &aeh, K_NO_WAIT) == 0) {
+			event_ref_put(aeh);
+		}
+		return;
+	}
+
+	k_msgq_purge(msg_q);
+}
+
+/* Put an event in a queue without waiting. */
+static int queue_put(struct k_msgq *msg_q, const struct app_event_header *aeh)
+{
+	int err;
+
+#if defined(CONFIG_MODULES_COMMON_ZERO_COPY)
+	event_ref_get(aeh);
+
+	err = k_msgq_put(msg_q, &aeh, K_NO_WAIT);
+	if (err) {
+		event_ref_put(aeh);
+	}
+#else
+	uint8_t msg[CONFIG_MODULES_COMMON_MSG_SIZE_MAX] __aligned(4) = {0};
+
+	__ASSERT_NO_MSG(msg_q->msg_size <= sizeof(msg));
+
+	memcpy(msg, aeh, MIN(event_ref_hdr(aeh)->size, msg_q->msg_size));
+
+	err = k_msgq_put(msg_q, msg, K_NO_WAIT);
+#endif
+	return err;
+}
+
+/* Discard the message at the head of a queue. The lane semaphore is left as is, a stale
+ * count only makes module_get_next_event() look at the lanes once more.
+ */
+static void queue_drop_oldest(struct module_data *module, struct k_msgq *msg_q)
+{
+#if defined(CONFIG_MODULES_COMMON_ZERO_COPY)
+	const struct app_event_header *aeh;
+
+	if (k_msgq_get(msg_q, &aeh, K_NO_WAIT) == 0) {
+		event_ref_put(aeh);
+	}
+#else
+	uint8_t msg[CONFIG_MODULES_COMMON_MSG_SIZE_MAX] __aligned(4);
+
+	if (k_msgq_get(msg_q, msg, K_NO_WAIT)) {
+		return;
+	}
+#endif
+
+#if defined(CONFIG_MODULES_COMMON_DISPATCH_STATS)
+	module->stats.dropped++;
+#endif
+}
+
+/* Get the queue that an event should be put in. */
+static struct k_msgq *lane_classify(struct module_data *module,
+				    const struct app_event_header *aeh)
+{
+	const struct event_prototype *evt_proto = (const struct event_prototype *)aeh;
+
+	if (module->lane_count == 0) {
+		return module->msg_q;
+	}
+
+	for (size_t i = 0; i < module->lane_class_count; i++) {
+		const struct module_lane_class *class = &module->lane_classes[i];
+
+		if (class->type != aeh->type_id) {
+			continue;
+		}
+
+		if ((class->subtype == MODULE_SUBTYPE_ANY) ||
+		    (class->subtype == evt_proto->event_id)) {
+			__ASSERT_NO_MSG(class->lane < module->lane_count);
+			return module->lanes[class->lane].msg_q;
+		}
+	}
+
+	return module->lanes[module->lane_count - 1].msg_q;
+}
+
+/* Get the lane that the next message should be taken from. Returns NULL if all lanes are
+ * empty, which can happen if a lane has been purged.
+ */
+static struct k_msgq *lane_select(struct module_data *module)
+{
+	if (module->lane_policy == MODULE_LANE_POLICY_STRICT) {
+		for (size_t i = 0; i < module->lane_count; i++) {
+			if (k_msgq_num_used_get(module->lanes[i].msg_q)) {
+				return module->lanes[i].msg_q;
+			}
+		}
+
+		return NULL;
+	}
+
+	for (int round = 0; round < 2; round++) {
+		for (size_t i = 0; i < module->lane_count; i++) {
+			struct module_lane *lane = &module->lanes[i];
+
+			if (lane->credit && k_msgq_num_used_get(lane->msg_q)) {
+				lane->credit--;
+				return lane->msg_q;
+			}
+		}
+
+		/* Every lane holding messages has used its credit, start a new round. */
+		for (size_t i = 0; i < module->lane_count; i++) {
+			module->lanes[i].credit = module->lanes[i].weight;
+		}
+	}
+
+	return NULL;
+}
+
+/* Public interface */
+void module_purge_queue(struct module_data *module)
+{
+	if (module->lane_count == 0) {
+		queue_purge(module->msg_q);
+		return;
+	}
+
+	for (size_t i = 0; i < module->lane_count; i++) {
+		queue_purge(module->lanes[i].msg_q);
+	}
+}
+
+int module_get_next_msg(struct module_data *module, void *msg)
+{
+	int err = k_msgq_get(module->msg_q, msg, K_FOREVER);
+
+	if (err == 0 && IS_ENABLED(CONFIG_MODULES_COMMON_LOG_LEVEL_DBG)) {
+		struct event_prototype *evt_proto =
+			(struct event_prototype *)msg;
+
+		event_log(module, &evt_proto->header);
+	}
+	return err;
+}
+
+int module_enqueue_msg(struct module_data *module, void *msg)
+{
+	int err;
+	uint32_t start = k_cycle_get_32();
+
+	err = k_msgq_put(module->msg_q, msg, K_NO_WAIT);
+	enqueue_stats_update(module, err, start);
+	if (err) {
+		LOG_WRN("%s: Message could not be enqueued, error code: %d",
+			module->name, err);
+			/* Purge message queue before reporting an error. This
+			 * makes sure that the calling module can
+			 * enqueue and process new events and is not being
+			 * blocked by a full message queue.
+			 *
+			 * This error is concidered irrecoverable and should be
+			 * rebooted on.
+			 */
+			module_purge_queue(module);
+		return err;
+	}
+
+	if (IS_ENABLED(CONFIG_MODULES_COMMON_LOG_LEVEL_DBG)) {
+		struct event_prototype *evt_proto = (struct event_prototype *)msg;
+
+		event_log(module, &evt_proto->header);
+	}
+
+	return 0;
+}
+
+int module_enqueue_event(struct module_data *module, const struct app_event_header *aeh)
+{
+	int err;
+	uint32_t start = k_cycle_get_32();
+	struct k_msgq *msg_q = lane_classify(module, aeh);
+
+	err = queue_put(msg_q, aeh);
+	if (err && module->overload_policy == MODULE_OVERLOAD_DROP_OLDEST) {
+		queue_drop_oldest(module, msg_q);
+		err = queue_put(msg_q, aeh);
+	}
+
+	enqueue_stats_update(module, err, start);
+	if (err) {
+		LOG_WRN("%s: Event could not be enqueued, error code: %d",
+			module->name, err);
+		/* See module_enqueue_msg(). Only the full lane is purged so that a backlog of
+		 * low priority messages does not cost the module its high priority messages.
+		 */
+		if (module->overload_policy == MODULE_OVERLOAD_PURGE) {
+			queue_purge(msg_q);
+		}
+		return err;
+	}
+
+	if (module->lane_count) {
+		k_sem_give(module->lane_sem);
+	}
+
+#if defined(CONFIG_MODULES_COMMON_SUPERVISOR)
+	supervision_enqueued(module);
+#endif
+
+	if (IS_ENABLED(CONFIG_MODULES_COMMON_LOG_LEVEL_DBG)) {
+		event_log(module, aeh);
+	}
+
+	return 0;
+}
+
+void *module_get_next_event(struct module_data *module, void *buf)
+{
+	void *msg = buf;
+	void *dst = IS_ENABLED(CONFIG_MODULES_COMMON_ZERO_COPY) ? (void *)&msg : buf;
+
+	if (module->lane_count == 0) {
+		(void)k_msgq_get(module->msg_q, dst, K_FOREVER);
+	} else {
+		while (true) {
+			struct k_msgq *msg_q;
+
+			(void)k_sem_take(module->lane_sem, K_FOREVER);
+
+			msg_q = lane_select(module);
+			if (msg_q && (k_msgq_get(msg_q, dst, K_NO_WAIT) == 0)) {
+				break;
+			}
+		}
+	}
+
+#if defined(CONFIG_MODULES_COMMON_DISPATCH_STATS)
+	module->stats.dequeued++;
+#endif
+
+#if defined(CONFIG_MODULES_COMMON_SUPERVISOR)
+	supervision_handler_start(module, module->lane_count ?
+					  k_sem_count_get(module->lane_sem) > 0 :
+					  k_msgq_num_used_get(module->msg_q) > 0);
+#endif
+
+	if (IS_ENABLED(CONFIG_MODULES_COMMON_LOG_LEVEL_DBG)) {
+		event_log(module, (const struct app_event_header *)msg);
+	}
+
+	return msg;
+}
+
+void module_release_event(struct module_data *module, void *msg)
+{
+	if (IS_ENABLED(CONFIG_MODULES_COMMON_ZERO_COPY)) {
+		event_ref_put(msg);
+	}
+
+#if defined(CONFIG_MODULES_COMMON_SUPERVISOR)
+	supervision_handler_end(module);
+#endif
+}
+
+bool modules_route_event(const struct app_event_header *aeh)
+{
+	const struct event_prototype *evt_proto = (const struct event_prototype *)aeh;
+
+#if defined(CONFIG_MODULES_COMMON_DISPATCH_STATS)
+	route_stats.events++;
+#endif
+
+	STRUCT_SECTION_FOREACH(module_route, route) {
+		if (route->type != aeh->type_id) {
+			continue;
+		}
+
+		if ((route->subtype != MODULE_SUBTYPE_ANY) &&
+		    (route->subtype != evt_proto->event_id)) {
+			continue;
+		}
+
+#if defined(CONFIG_MODULES_COMMON_DISPATCH_STATS)
+		route_stats.deliveries++;
+#endif
+
+		int err = module_enqueue_event(route->module, aeh);
+
+		if (err) {
+			LOG_ERR("%s: Message could not be enqueued", route->module->name);
+		}
+	}
+
+	return false;
+}
+
+void modules_dispatch_stats_log(void)
+{
+#if defined(CONFIG_MODULES_COMMON_DISPATCH_STATS)
+	struct module_data *module;
+
+	LOG_INF("Routed %d events, %d deliveries", route_stats.events, route_stats.deliveries);
+
+	k_mutex_lock(&module_list_lock, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER(&module_list, module, header) {
+		struct module_dispatch_stats *stats = &module->stats;
+
+		LOG_INF("%s: enqueued %d, dequeued %d, dropped %d, avg enqueue %d cycles",
+			module->name, stats->enqueued, stats->dequeued, stats->dropped,
+			stats->enqueued ? (uint32_t)(stats->enqueue_cycles / stats->enqueued) : 0);
+	}
+	k_mutex_unlock(&module_list_lock);
+#endif
+}
+
+void modules_handler_stats_log(void)
+{
+#if defined(CONFIG_MODULES_COMMON_SUPERVISOR)
+	struct module_data *module;
+
+	k_mutex_lock(&module_list_lock, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER(&module_list, module, header) {
+		struct module_supervision *sv = &module->supervision;
+
+		LOG_INF("%s: max handler time %d us, %d overruns", module->name, sv->max_us,
+			sv->overruns);
+
+		for (size_t i = 0; i < ARRAY_SIZE(sv->hist) - 1; i++) {
+			if (sv->hist[i]) {
+				LOG_INF("%s:   < %d us: %d", module->name, BIT(i), sv->hist[i]);
+			}
+		}
+
+		LOG_INF("%s:  >= %d us: %d", module->name,
+			BIT(ARRAY_SIZE(sv->hist) - 2), sv->hist[ARRAY_SIZE(sv->hist) - 1]);
+	}
+	k_mutex_unlock(&module_list_lock);
+#endif
+}
+
+bool modules_shutdown_register(uint32_t id_reg)
+{
+	bool retval = false;
+	struct module_data *module, *next_module = NULL;
+
+	if (id_reg == 0) {
+		LOG_WRN("Passed in module ID cannot be 0");
+		return false;
+	}
+
+	k_mutex_lock(&module_list_lock, K_FOREVER);
+	SYS_SLIST_FOR_EACH_CONTAINER_SAFE(&module_list, module, next_module, header) {
+		if (module->id == id_reg) {
+			if (module->supports_shutdown) {
+				/* A module shutdown has been registered. Decrease the number of
+				 * active modules in the application and delete the list entry for
+				 * the corresponding module.
+				 */
+				sys_slist_find_and_remove(&module_list, &module->header);
+				atomic_dec(&modules_info.active_modules_count);
+				atomic_dec(&modules_info.shutdown_supported_count);
+
+				LOG_WRN("Module \"%s\" shutdown registered", module->name);
+			} else {
+				goto exit;
+			}
+			break;
+		}
+	};
+
+	if (modules_info.shutdown_supported_count == 0) {
+		/* All modules in the application have reported a shutdown. */
+		retval = true;
+	}
+
+exit:
+	k_mutex_unlock(&module_list_lock);
+	return retval;
+}
+
+int module_start(struct module_data *module)
+{
+	if (module == NULL) {
+		LOG_ERR("Module metadata is NULL");
+		return -EINVAL;
+	}
+
+	if (module->name == NULL) {
+		LOG_ERR("Module name is NULL");
+		return -EINVAL;
+	}
+
+	if (module->lane_count && (module->lane_sem == NULL)) {
+		LOG_ERR("Module \"%s\" has lanes but no lane semaphore", module->name);
+		return -EINVAL;
+	}
+
+	for (size_t i = 0; i < module->lane_count; i++) {
+		if ((module->lane_policy == MODULE_LANE_POLICY_WEIGHTED) &&
+		    (module->lanes[i].weight == 0)) {
+			LOG_ERR("Module \"%s\" lane %d has no weight", module->name, i);
+			return -EINVAL;
+		}
+	}
+
+	module->id = k_cycle_get_32();
+	atomic_inc(&modules_info.active_modules_count);
+
+#if defined(CONFIG_MODULES_COMMON_SUPERVISOR)
+	/* Events may have been queued before a module that sets up first starts. They are only
+	 * overdue from now on.
+	 */
+	if (atomic_get(&module->supervision.pending_since)) {
+		atomic_set(&module->supervision.pending_since, supervision_now());
+	}
+#endif
+
+	if (module->supports_shutdown) {
+		atomic_inc(&modules_info.shutdown_supported_count);
+	}
+
+	/* Append passed in module metadata to linked list. */
+	k_mutex_lock(&module_list_lock, K_FOREVER);
+	sys_slist_append(&module_list, &module->header);
+	k_mutex_unlock(&module_list_lock);
+
+	if (module->thread_id) {
+		LOG_DBG("Module \"%s\" with thread ID %p started", module->name, module->thread_id);
+	} else {
+		LOG_DBG("Module \"%s\" started", module->name);
+	}
+
+	return 0;
+}
+
+uint32_t module_active_count_get(void)
+{
+	return atomic_get(&modules_info.active_modules_count);
+}
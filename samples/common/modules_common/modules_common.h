@@ -0,0 +1,372 @@
+/*
+ * Copyright (c) 2021 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#ifndef _MODULES_COMMON_H_
+#define _MODULES_COMMON_H_
+
+/**@file
+ *@brief Modules common library header.
+ */
+
+#include <zephyr/kernel.h>
+#include <app_event_manager.h>
+
+/**
+ * @defgroup modules_common Modules common library
+ * @{
+ * @brief A Library that exposes generic functionality shared between modules.
+ */
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** @brief Macro that checks if an event is of a certain type.
+ *
+ * @param _ptr Name of module message struct variable.
+ * @param _mod Name of module that the event corresponds to.
+ * @param _evt Name of the event.
+ *
+ * @return true if the event matches the event checked for, otherwise false.
+ */
+#define IS_EVENT(_ptr, _mod, _evt) \
+		is_ ## _mod ## _module_event(&_ptr->module._mod.header) &&		\
+		_ptr->module._mod.type == _evt
+
+/** @brief Macro used to submit an event.
+ *
+ * @param _mod Name of module that the event corresponds to.
+ * @param _type Name of the type of event.
+ */
+#define SEND_EVENT(_mod, _type)								\
+	struct _mod ## _module_event *event = new_ ## _mod ## _module_event();		\
+	event->type = _type;								\
+	APP_EVENT_SUBMIT(event)
+
+/** @brief Macro used to submit an error event.
+ *
+ * @param _mod Name of module that the event corresponds to.
+ * @param _type Name of the type of error event.
+ * @param _error_code Error code.
+ */
+#define SEND_ERROR(_mod, _type, _error_code)						\
+	struct _mod ## _module_event *event = new_ ## _mod ## _module_event();		\
+	event->type = _type;								\
+	event->data.err = _error_code;							\
+	APP_EVENT_SUBMIT(event)
+
+/** @brief Macro used to submit an shutdown event.
+ *
+ * @param _mod Name of module that the event corresponds to.
+ * @param _type Name of the type of shutdown event.
+ * @param _id ID of the module that acknowledges the shutdown.
+ */
+#define SEND_SHUTDOWN_ACK(_mod, _type, _id)						\
+	struct _mod ## _module_event *event = new_ ## _mod ## _module_event();		\
+	event->type = _type;								\
+	event->data.id = _id;								\
+	APP_EVENT_SUBMIT(event)
+
+/** @brief Macro used to define a module message queue.
+ *
+ * With zero-copy dispatch enabled each queue entry holds a pointer to an application event,
+ * otherwise it holds a copy of the event in the module's message union.
+ *
+ * @param _name Name of the message queue.
+ * @param _msg_type Type of the module's message union.
+ * @param _count Maximum number of messages in the queue.
+ */
+#define MODULE_MSGQ_DEFINE(_name, _msg_type, _count)					\
+	BUILD_ASSERT(sizeof(_msg_type) <= CONFIG_MODULES_COMMON_MSG_SIZE_MAX,		\
+		     "Module message exceeds CONFIG_MODULES_COMMON_MSG_SIZE_MAX");	\
+	K_MSGQ_DEFINE(_name,								\
+		      IS_ENABLED(CONFIG_MODULES_COMMON_ZERO_COPY) ?			\
+				sizeof(void *) : sizeof(_msg_type),			\
+		      _count, 4)
+
+/** @brief Order in which the priority lanes of a module are served. */
+enum module_lane_policy {
+	/* Always serve the highest priority lane that holds a message. */
+	MODULE_LANE_POLICY_STRICT,
+	/* Serve lanes in priority order, but at most weight messages from a lane per round
+	 * while lower priority lanes are waiting.
+	 */
+	MODULE_LANE_POLICY_WEIGHTED,
+};
+
+/** @brief What happens to a queue, or lane, that is full when an event is enqueued. */
+enum module_overload_policy {
+	/* Purge the full queue and drop the event. */
+	MODULE_OVERLOAD_PURGE,
+	/* Drop the event and keep the queued messages. */
+	MODULE_OVERLOAD_DROP_NEWEST,
+	/* Drop the oldest queued message to make room for the event. */
+	MODULE_OVERLOAD_DROP_OLDEST,
+};
+
+/** @brief Priority lane in a module's message queue. */
+struct module_lane {
+	/* Message queue holding the messages in the lane. */
+	struct k_msgq *msg_q;
+	/* Number of messages served from the lane per round with MODULE_LANE_POLICY_WEIGHTED. */
+	uint8_t weight;
+	/* Messages left to serve from the lane in the current round. Internal. */
+	uint8_t credit;
+};
+
+/** @brief Subtype value that matches any subtype of an event type. */
+#define MODULE_SUBTYPE_ANY -1
+
+/** @brief Entry in a module's lane classification table. */
+struct module_lane_class {
+	/* Event type. */
+	const struct event_type *type;
+	/* Event subtype, i.e. the type field of the event, or MODULE_SUBTYPE_ANY. */
+	int subtype;
+	/* Index of the lane that events matching the entry are put in. */
+	uint8_t lane;
+};
+
+/** @brief Macro used to define an entry in a lane classification table.
+ *
+ * @param _evt Name of the event type, for example robot_module_event.
+ * @param _subtype Event subtype, or MODULE_SUBTYPE_ANY.
+ * @param _lane Index of the lane.
+ */
+#define MODULE_LANE_CLASS(_evt, _subtype, _lane)					\
+	{ .type = APP_EVENT_ID(_evt), .subtype = (_subtype), .lane = (_lane) }
+
+/** @brief Entry in the event routing table. */
+struct module_route {
+	/* Event type. */
+	const struct event_type *type;
+	/* Event subtype, i.e. the type field of the event, or MODULE_SUBTYPE_ANY. */
+	int subtype;
+	/* Module that matching events are enqueued to. */
+	struct module_data *module;
+};
+
+/** @brief Macro used to subscribe a module to an event subtype.
+ *
+ * Adds an entry to the static event routing table. Events are only enqueued to modules that have
+ * subscribed to their type and subtype. A module must not subscribe to the same subtype twice,
+ * neither explicitly nor through MODULE_SUBTYPE_ANY.
+ *
+ * @param _module Module metadata structure, for example self.
+ * @param _evt Name of the event type, for example robot_module_event.
+ * @param _subtype Event subtype, or MODULE_SUBTYPE_ANY.
+ */
+#define MODULE_SUBSCRIBE(_module, _evt, _subtype)					\
+	static const STRUCT_SECTION_ITERABLE(module_route,				\
+					     _CONCAT(__module_route_, __COUNTER__)) = {	\
+		.type = APP_EVENT_ID(_evt),						\
+		.subtype = (_subtype),							\
+		.module = &(_module),							\
+	}
+
+/** @brief Event dispatch statistics for a module. */
+struct module_dispatch_stats {
+	/* Number of messages enqueued. */
+	uint32_t enqueued;
+	/* Number of messages dequeued. */
+	uint32_t dequeued;
+	/* Number of messages dropped because the queue was full. */
+	uint32_t dropped;
+	/* Total number of cycles spent enqueueing messages. */
+	uint64_t enqueue_cycles;
+};
+
+/** @brief Supervision state and handler statistics for a module. */
+struct module_supervision {
+	/* Set while the module is handling a message. */
+	atomic_t busy;
+	/* Uptime in milliseconds at which the current handler started. */
+	atomic_t busy_since;
+	/* Uptime in milliseconds since which a message has been waiting, 0 if none. */
+	atomic_t pending_since;
+	/* Uptime in milliseconds at which the last handler finished. */
+	atomic_t last_progress;
+	/* Cycle count at which the current handler started. */
+	uint32_t handler_start;
+	/* Number of consecutive supervisor checks that found the module stuck. */
+	uint32_t stalls;
+	/* Number of handlers that exceeded the budget. */
+	uint32_t overruns;
+	/* Longest handler execution time in microseconds. */
+	uint32_t max_us;
+#if defined(CONFIG_MODULES_COMMON_SUPERVISOR)
+	/* Histogram of handler execution times, see CONFIG_MODULES_COMMON_HANDLER_HIST_BUCKETS. */
+	uint32_t hist[CONFIG_MODULES_COMMON_HANDLER_HIST_BUCKETS];
+#endif
+};
+
+/** @brief Structure that contains module metadata. */
+struct module_data {
+	/* Variable used to construct a linked list of module metadata. */
+	sys_snode_t header;
+	/* ID specific to each module. Internally assigned when calling module_start(). */
+	uint32_t id;
+	/* The ID of the module thread. */
+	k_tid_t thread_id;
+	/* Name of the module. */
+	char *name;
+	/* Pointer to the internal message queue in the module. Used if the module has no lanes. */
+	struct k_msgq *msg_q;
+	/* Priority lanes, highest priority first. Optional. */
+	struct module_lane *lanes;
+	/* Number of priority lanes. */
+	size_t lane_count;
+	/* Table classifying events into lanes. Events without an entry go to the last lane. */
+	const struct module_lane_class *lane_classes;
+	/* Number of entries in the lane classification table. */
+	size_t lane_class_count;
+	/* Order in which the lanes are served. */
+	enum module_lane_policy lane_policy;
+	/* Semaphore counting the messages in all lanes. Required if the module has lanes. */
+	struct k_sem *lane_sem;
+	/* Handling of events that arrive when their queue is full. */
+	enum module_overload_policy overload_policy;
+	/* Time in milliseconds the module may spend on one message, or leave a message waiting,
+	 * before the supervisor considers it stuck. 0 selects CONFIG_MODULES_COMMON_HANDLER_BUDGET_MS.
+	 */
+	uint32_t handler_budget_ms;
+	/* Called from the supervisor when the module is found stuck. Optional. */
+	void (*recover)(void);
+	/* Flag signifying if the module supports shutdown. */
+	bool supports_shutdown;
+#if defined(CONFIG_MODULES_COMMON_DISPATCH_STATS)
+	/* Event dispatch statistics. */
+	struct module_dispatch_stats stats;
+#endif
+#if defined(CONFIG_MODULES_COMMON_SUPERVISOR)
+	/* Supervision state. */
+	struct module_supervision supervision;
+#endif
+};
+
+/** @brief Purge a module's queue.
+ *
+ *  @param[in] module Pointer to a structure containing module metadata.
+ *
+ *  @return 0 if successful, otherwise a negative error code.
+ */
+void module_purge_queue(struct module_data *module);
+
+/** @brief Get the next message in a modules's queue.
+ *
+ *  Only for modules without priority lanes.
+ *
+ *  @param[in] module Pointer to a structure containing module metadata.
+ *  @param[out] msg Pointer to a message buffer that the output will be written to.
+ *
+ *  @return 0 if successful, otherwise a negative error code.
+ */
+int module_get_next_msg(struct module_data *module, void *msg);
+
+/** @brief Enqueue message to a module's queue.
+ *
+ *  Only for modules without priority lanes.
+ *
+ *  @param[in] module Pointer to a structure containing module metadata.
+ *  @param[in] msg Pointer to a message that will be enqueued.
+ *
+ *  @return 0 if successful, otherwise a negative error code.
+ */
+int module_enqueue_msg(struct module_data *module, void *msg);
+
+/** @brief Enqueue an application event to a module's queue.
+ *
+ *  With zero-copy dispatch enabled a reference to the event is taken and a pointer to it is
+ *  enqueued. Otherwise the event is copied into the queue. If the module has priority lanes the
+ *  event is put in the lane given by the module's classification table. The call never blocks,
+ *  if the queue, or lane, is full the module's overload policy decides what is dropped.
+ *
+ *  @param[in] module Pointer to a structure containing module metadata.
+ *  @param[in] aeh Pointer to the header of the event that will be enqueued.
+ *
+ *  @return 0 if successful, otherwise a negative error code.
+ */
+int module_enqueue_event(struct module_data *module, const struct app_event_header *aeh);
+
+/** @brief Get the next event in a module's queue.
+ *
+ *  Blocks until a message is available. If the module has priority lanes, the lane to serve is
+ *  picked according to the module's lane policy. The returned message must be released with
+ *  module_release_event() when the module is done with it.
+ *
+ *  @param[in] module Pointer to a structure containing module metadata.
+ *  @param[in] buf Buffer the message is copied into when zero-copy dispatch is disabled.
+ *		   Must be the size of the module's message union.
+ *
+ *  @return Pointer to the message. Points to the event itself with zero-copy dispatch enabled,
+ *	    otherwise to @p buf. Only the union member matching the event type may be accessed,
+ *	    and the message must not be modified since it can be shared with other modules.
+ */
+void *module_get_next_event(struct module_data *module, void *buf);
+
+/** @brief Release a message returned by module_get_next_event().
+ *
+ *  Marks the end of the module's handling of the message for the supervisor.
+ *
+ *  @param[in] module Pointer to a structure containing module metadata.
+ *  @param[in] msg Pointer to the message.
+ */
+void module_release_event(struct module_data *module, void *msg);
+
+/** @brief Route an application event to the modules that have subscribed to it.
+ *
+ *  Used as the Application Event Manager handler of the single listener that is subscribed to
+ *  all module event types.
+ *
+ *  @param[in] aeh Pointer to the header of the event.
+ *
+ *  @return false, the event is never consumed.
+ */
+bool modules_route_event(const struct app_event_header *aeh);
+
+/** @brief Log the event dispatch statistics of all active modules.
+ *
+ *  Does nothing unless CONFIG_MODULES_COMMON_DISPATCH_STATS is enabled.
+ */
+void modules_dispatch_stats_log(void);
+
+/** @brief Log the handler execution time histograms of all active modules.
+ *
+ *  Does nothing unless CONFIG_MODULES_COMMON_SUPERVISOR is enabled.
+ */
+void modules_handler_stats_log(void);
+
+/** @brief Register that a module has performed a graceful shutdown.
+ *
+ *  @param[in] id_reg Identifier of module.
+ *
+ *  @return true If this API has been called for all modules supporting graceful shutdown in the
+ *	    application.
+ */
+bool modules_shutdown_register(uint32_t id_reg);
+
+/** @brief Register and start a module.
+ *
+ *  The supervisor watches the module from here on. A module with a long setup calls this once
+ *  it is set up and about to handle messages.
+ *
+ *  @param[in] module Pointer to a structure containing module metadata.
+ *
+ *  @return 0 if successful, otherwise a negative error code.
+ */
+int module_start(struct module_data *module);
+
+/** @brief Get the number of active modules in the application.
+ *
+ *  @return Number of active modules in the application.
+ */
+uint32_t module_active_count_get(void);
+
+/**
+ *@}
+ */
+
+#endif /* _MODULES_COMMON_H_ */
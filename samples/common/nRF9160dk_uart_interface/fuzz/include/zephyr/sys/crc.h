@@ -0,0 +1,26 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* The parts of the Zephyr header the frame parser uses, for host builds. */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+/* Same algorithm as lib/os/crc16_sw.c. */
+static inline uint16_t crc16_ccitt(uint16_t seed, const uint8_t *src, size_t len)
+{
+	for (; len > 0; len--)
+	{
+		uint8_t e, f;
+
+		e = seed ^ *src++;
+		f = e ^ (e << 4);
+		seed = (seed >> 8) ^ ((uint16_t)f << 8) ^ ((uint16_t)f << 3) ^ ((uint16_t)f >> 4);
+	}
+
+	return seed;
+}
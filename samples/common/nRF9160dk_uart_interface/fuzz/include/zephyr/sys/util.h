@@ -0,0 +1,24 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* The parts of the Zephyr header the UART interface uses, for host builds. */
+
+#pragma once
+#include <stddef.h>
+#include <stdbool.h>
+
+#define __packed __attribute__((__packed__))
+
+#define ARRAY_SIZE(array) (sizeof(array) / sizeof((array)[0]))
+#define MIN(a, b) (((a) < (b)) ? (a) : (b))
+#define MAX(a, b) (((a) > (b)) ? (a) : (b))
+
+#define ARG_UNUSED(x) (void)(x)
+
+#define BIT(n) (1UL << (n))
+#define CONTAINER_OF(ptr, type, field) ((type *)(((char *)(ptr)) - offsetof(type, field)))
+
+#define BUILD_ASSERT(EXPR, MSG...) _Static_assert(EXPR, "" MSG)
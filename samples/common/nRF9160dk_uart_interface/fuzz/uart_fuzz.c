@@ -0,0 +1,124 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Host fuzz target for the UART codec and frame parser.
+ *
+ * The input is fed both as a message to the codec and as received bytes to the frame parser.
+ * A message that decodes must have the length the table gives for it and must encode back to
+ * the same bytes. Every frame the parser accepts must be at most MESH_UART_FRAME_PAYLOAD_MAX
+ * long and must survive being framed again and parsed by a fresh parser. Whatever the input
+ * left the parser in, a valid frame that follows must get through and leave it between frames.
+ */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+#include "uart_codec.h"
+#include "uart_frame.h"
+
+#define CHECK(_cond) \
+	do \
+	{ \
+		if (!(_cond)) \
+		{ \
+			abort(); \
+		} \
+	} while (0)
+
+static void codec_check(const uint8_t *data, size_t size)
+{
+	union mesh_uart_msg msg;
+	uint8_t buf[sizeof(union mesh_uart_msg)];
+
+	if (mesh_uart_msg_decode(data, size, &msg))
+	{
+		return;
+	}
+
+	CHECK(size <= sizeof(msg));
+	CHECK(mesh_uart_msg_len(&msg) == (int)size);
+	CHECK(mesh_uart_msg_name(msg.header.type) != NULL);
+
+	int len = mesh_uart_msg_encode(&msg, size, MESH_UART_PROTOCOL_VERSION, buf, sizeof(buf));
+	CHECK(len == (int)size);
+	CHECK(memcmp(buf, data, size) == 0);
+}
+
+struct reframe
+{
+	const uint8_t *payload;
+	size_t len;
+	int frames;
+};
+
+static void reframe_handler(const uint8_t *payload, size_t len, void *user_data)
+{
+	struct reframe *reframe = user_data;
+
+	CHECK(len == reframe->len && memcmp(payload, reframe->payload, len) == 0);
+	reframe->frames++;
+}
+
+static void frame_handler(const uint8_t *payload, size_t len, void *user_data)
+{
+	static struct mesh_uart_frame_parser parser;
+	uint8_t frame[MESH_UART_FRAME_ENCODED_MAX];
+	struct reframe reframe = {
+		.payload = payload,
+		.len = len,
+	};
+
+	ARG_UNUSED(user_data);
+
+	CHECK(len <= MESH_UART_FRAME_PAYLOAD_MAX);
+
+	int frame_len = mesh_uart_frame_encode(payload, len, frame, sizeof(frame));
+	CHECK(frame_len > 0 && frame_len <= (int)MESH_UART_FRAME_ENCODED_SIZE(len));
+
+	mesh_uart_frame_parser_init(&parser, reframe_handler, &reframe);
+	mesh_uart_frame_parse(&parser, frame, frame_len);
+	CHECK(reframe.frames == 1);
+
+	codec_check(payload, len);
+}
+
+static const uint8_t probe_payload[] = {0x01, 0x00, 0xa5, 0x00, 0x5a};
+
+/* The input may end in a frame of its own, which the delimiter of the probe completes. */
+static void probe_handler(const uint8_t *payload, size_t len, void *user_data)
+{
+	int *probes = user_data;
+
+	if (len == sizeof(probe_payload) && memcmp(payload, probe_payload, len) == 0)
+	{
+		(*probes)++;
+	}
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+	static struct mesh_uart_frame_parser parser;
+	uint8_t probe[MESH_UART_FRAME_ENCODED_SIZE(sizeof(probe_payload))];
+	int probes = 0;
+
+	codec_check(data, size);
+
+	mesh_uart_frame_parser_init(&parser, frame_handler, NULL);
+	mesh_uart_frame_parse(&parser, data, size);
+
+	int probe_len = mesh_uart_frame_encode(probe_payload, sizeof(probe_payload), probe, sizeof(probe));
+	CHECK(probe_len > 0);
+
+	parser.handler = probe_handler;
+	parser.user_data = &probes;
+	mesh_uart_frame_parse(&parser, probe, probe_len);
+	CHECK(probes >= 1);
+	CHECK(!mesh_uart_frame_parser_in_frame(&parser));
+
+	return 0;
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* The parts of the Zephyr UART API the UART interface uses. The loopback implements the
+ * functions on its simulated line.
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/device.h>
+
+enum uart_event_type
+{
+	UART_TX_DONE,
+	UART_TX_ABORTED,
+	UART_RX_RDY,
+	UART_RX_BUF_REQUEST,
+	UART_RX_BUF_RELEASED,
+	UART_RX_DISABLED,
+	UART_RX_STOPPED,
+};
+
+struct uart_event_tx
+{
+	const uint8_t *buf;
+	size_t len;
+};
+
+struct uart_event_rx
+{
+	uint8_t *buf;
+	size_t offset;
+	size_t len;
+};
+
+struct uart_event_rx_buf
+{
+	uint8_t *buf;
+};
+
+struct uart_event_rx_stop
+{
+	int reason;
+	struct uart_event_rx data;
+};
+
+struct uart_event
+{
+	enum uart_event_type type;
+	union
+	{
+		struct uart_event_tx tx;
+		struct uart_event_rx rx;
+		struct uart_event_rx_buf rx_buf;
+		struct uart_event_rx_stop rx_stop;
+	} data;
+};
+
+struct uart_config
+{
+	uint32_t baudrate;
+};
+
+int uart_tx(const struct device *dev, const uint8_t *buf, size_t len, int32_t timeout);
+int uart_tx_abort(const struct device *dev);
+int uart_rx_enable(const struct device *dev, uint8_t *buf, size_t len, int32_t timeout);
+int uart_rx_buf_rsp(const struct device *dev, uint8_t *buf, size_t len);
+int uart_rx_disable(const struct device *dev);
+int uart_config_get(const struct device *dev, struct uart_config *cfg);
@@ -0,0 +1,235 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* The parts of the Zephyr kernel API the UART interface uses, on the simulated clock of the
+ * loopback. There is a single thread, so a spinlock is only checked: none may be taken while
+ * another is held.
+ */
+
+#pragma once
+#include <assert.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <zephyr/sys/util.h>
+
+#define MSEC_PER_SEC 1000U
+#define USEC_PER_MSEC 1000U
+#define NSEC_PER_USEC 1000U
+#define NSEC_PER_SEC 1000000000UL
+
+#define SYS_FOREVER_US (-1)
+
+/* Simulated uptime, one tick and one cycle per microsecond. */
+extern uint64_t sim_now_us;
+/* Spinlocks held right now. */
+extern int sim_locks_held;
+
+typedef struct
+{
+	int64_t us;
+} k_timeout_t;
+
+#define K_NO_WAIT ((k_timeout_t){.us = 0})
+#define K_FOREVER ((k_timeout_t){.us = -1})
+#define K_MSEC(ms) ((k_timeout_t){.us = (int64_t)(ms) * USEC_PER_MSEC})
+
+static inline uint32_t k_uptime_get_32(void)
+{
+	return sim_now_us / USEC_PER_MSEC;
+}
+
+static inline uint32_t k_cycle_get_32(void)
+{
+	return sim_now_us;
+}
+
+static inline uint64_t k_cyc_to_ns_floor64(uint64_t cycles)
+{
+	return cycles * NSEC_PER_USEC;
+}
+
+static inline uint32_t k_ticks_to_ms_ceil32(int64_t ticks)
+{
+	return (ticks + USEC_PER_MSEC - 1) / USEC_PER_MSEC;
+}
+
+static inline int32_t k_sleep(k_timeout_t timeout)
+{
+	ARG_UNUSED(timeout);
+	return 0;
+}
+
+typedef long atomic_t;
+typedef long atomic_val_t;
+
+static inline atomic_val_t atomic_get(const atomic_t *target)
+{
+	return *target;
+}
+
+static inline atomic_val_t atomic_set(atomic_t *target, atomic_val_t value)
+{
+	atomic_val_t old = *target;
+
+	*target = value;
+	return old;
+}
+
+struct k_spinlock
+{
+	bool locked;
+};
+
+typedef int k_spinlock_key_t;
+
+static inline k_spinlock_key_t k_spin_lock(struct k_spinlock *lock)
+{
+	assert(sim_locks_held == 0);
+	lock->locked = true;
+	sim_locks_held++;
+	return 0;
+}
+
+static inline void k_spin_unlock(struct k_spinlock *lock, k_spinlock_key_t key)
+{
+	ARG_UNUSED(key);
+	assert(lock->locked);
+	lock->locked = false;
+	sim_locks_held--;
+}
+
+struct k_work;
+typedef void (*k_work_handler_t)(struct k_work *work);
+
+struct k_work
+{
+	k_work_handler_t handler;
+};
+
+/* Run by the loopback once sim_now_us reaches due_us. */
+struct k_work_delayable
+{
+	struct k_work work;
+	uint64_t due_us;
+	bool pending;
+};
+
+/* Makes the work known to the loopback. */
+void sim_work_register(struct k_work_delayable *dwork);
+
+static inline void k_work_init_delayable(struct k_work_delayable *dwork, k_work_handler_t handler)
+{
+	dwork->work.handler = handler;
+	dwork->pending = false;
+	sim_work_register(dwork);
+}
+
+static inline int k_work_reschedule(struct k_work_delayable *dwork, k_timeout_t delay)
+{
+	dwork->due_us = sim_now_us + delay.us;
+	dwork->pending = true;
+	return 1;
+}
+
+static inline bool k_work_delayable_is_pending(const struct k_work_delayable *dwork)
+{
+	return dwork->pending;
+}
+
+static inline int64_t k_work_delayable_remaining_get(const struct k_work_delayable *dwork)
+{
+	return dwork->pending && dwork->due_us > sim_now_us ? dwork->due_us - sim_now_us : 0;
+}
+
+static inline struct k_work_delayable *k_work_delayable_from_work(struct k_work *work)
+{
+	return CONTAINER_OF(work, struct k_work_delayable, work);
+}
+
+/* The parser thread is not run, the loopback parses the received bytes itself. */
+struct k_sem
+{
+	unsigned int count;
+	unsigned int limit;
+};
+
+static inline void k_sem_init(struct k_sem *sem, unsigned int initial, unsigned int limit)
+{
+	sem->count = initial;
+	sem->limit = limit;
+}
+
+static inline void k_sem_give(struct k_sem *sem)
+{
+	sem->count = MIN(sem->count + 1, sem->limit);
+}
+
+static inline int k_sem_take(struct k_sem *sem, k_timeout_t timeout)
+{
+	ARG_UNUSED(timeout);
+	if (sem->count == 0)
+	{
+		return -EBUSY;
+	}
+	sem->count--;
+	return 0;
+}
+
+/* Reception is never enabled, so the inactivity timeout does not adapt and the timer that
+ * applies a new one is never needed.
+ */
+struct k_timer
+{
+	void (*expiry_fn)(struct k_timer *timer);
+};
+
+static inline void k_timer_init(struct k_timer *timer, void (*expiry_fn)(struct k_timer *timer),
+				void (*stop_fn)(struct k_timer *timer))
+{
+	ARG_UNUSED(stop_fn);
+	timer->expiry_fn = expiry_fn;
+}
+
+static inline void k_timer_start(struct k_timer *timer, k_timeout_t duration, k_timeout_t period)
+{
+	ARG_UNUSED(timer);
+	ARG_UNUSED(duration);
+	ARG_UNUSED(period);
+}
+
+/* Nor are receive buffers. */
+struct k_mem_slab
+{
+	size_t block_size;
+};
+
+static inline int k_mem_slab_alloc(struct k_mem_slab *slab, void **mem, k_timeout_t timeout)
+{
+	ARG_UNUSED(slab);
+	ARG_UNUSED(timeout);
+	*mem = NULL;
+	return -ENOMEM;
+}
+
+static inline void k_mem_slab_free(struct k_mem_slab *slab, void **mem)
+{
+	ARG_UNUSED(slab);
+	ARG_UNUSED(mem);
+}
+
+static inline uint32_t k_mem_slab_num_used_get(struct k_mem_slab *slab)
+{
+	ARG_UNUSED(slab);
+	return 0;
+}
+
+static inline uint32_t k_mem_slab_num_free_get(struct k_mem_slab *slab)
+{
+	ARG_UNUSED(slab);
+	return 0;
+}
@@ -0,0 +1,17 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Messages go to stdout. Logging with a spinlock held fails the run. */
+
+#pragma once
+
+void sim_log(int level, const char *fmt, ...) __attribute__((format(printf, 2, 3)));
+
+#define LOG_MODULE_REGISTER(...)
+#define LOG_ERR(...) sim_log(1, __VA_ARGS__)
+#define LOG_WRN(...) sim_log(2, __VA_ARGS__)
+#define LOG_INF(...) sim_log(3, __VA_ARGS__)
+#define LOG_DBG(...) sim_log(4, __VA_ARGS__)
@@ -0,0 +1,66 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* The parts of the Zephyr ring buffer the receive path uses. Bytes are claimed up to the end of
+ * the storage, like the Zephyr one does.
+ */
+
+#pragma once
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+#include <zephyr/sys/util.h>
+
+struct ring_buf
+{
+	uint8_t *buf;
+	uint32_t size;
+	uint32_t head;
+	uint32_t count;
+};
+
+static inline void ring_buf_init(struct ring_buf *ring, uint32_t size, uint8_t *buf)
+{
+	ring->buf = buf;
+	ring->size = size;
+	ring->head = 0;
+	ring->count = 0;
+}
+
+static inline uint32_t ring_buf_size_get(struct ring_buf *ring)
+{
+	return ring->count;
+}
+
+static inline bool ring_buf_is_empty(struct ring_buf *ring)
+{
+	return ring->count == 0;
+}
+
+static inline uint32_t ring_buf_put(struct ring_buf *ring, const uint8_t *data, uint32_t size)
+{
+	uint32_t put = MIN(size, ring->size - ring->count);
+
+	for (uint32_t i = 0; i < put; i++)
+	{
+		ring->buf[(ring->head + ring->count + i) % ring->size] = data[i];
+	}
+	ring->count += put;
+	return put;
+}
+
+static inline uint32_t ring_buf_get_claim(struct ring_buf *ring, uint8_t **data, uint32_t size)
+{
+	*data = &ring->buf[ring->head];
+	return MIN(size, MIN(ring->count, ring->size - ring->head));
+}
+
+static inline int ring_buf_get_finish(struct ring_buf *ring, uint32_t size)
+{
+	ring->head = (ring->head + size) % ring->size;
+	ring->count -= size;
+	return 0;
+}
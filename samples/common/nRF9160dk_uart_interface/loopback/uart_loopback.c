@@ -0,0 +1,534 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Host loopback benchmark of the UART link protocol.
+ *
+ * Two ends of the link, each with a requester, a transmit queue and a receive path, are connected
+ * by a simulated line. Both ends keep a full request window of LINK_TEST requests going and answer
+ * the requests of the other end with a STATUS, as the nRF52840 does. The receive paths inject
+ * the drop, corruption and latency faults given on the command line. For every end the run
+ * reports the exchanges per second, the frames per second it sent, the p50 and p99 exchange
+ * latency, and the longest time without a completed exchange, which is how long the link took to
+ * recover from the worst fault.
+ *
+ * Time is simulated. A byte takes ten bit times on the line, and the receiving end gets the bytes
+ * of a transfer once it has left the line. Nothing else takes time, so the numbers are those of
+ * the protocol, not of the chips. Runs with the same arguments repeat exactly.
+ *
+ * The run fails if a spinlock is taken with another one held, if the UART is started or a
+ * message logged with a spinlock held, if the link stalls, or if an exchange fails without
+ * faults.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <zephyr/kernel.h>
+
+#include "uart_codec.h"
+#include "uart_frame.h"
+#include "uart_request.h"
+#include "uart_rx.h"
+#include "uart_tx_queue.h"
+
+/* Defaults of the nRF9160 gateway Kconfig. */
+#define LOOPBACK_FRAMES 1000
+#define LOOPBACK_BAUDRATE 1000000
+#define LOOPBACK_TIMEOUT_MS 200
+#define LOOPBACK_RETRIES 2
+#define LOOPBACK_RING_SIZE 1024
+
+/* Simulated time after which a run is given up. */
+#define LOOPBACK_TIME_MAX_US (600ULL * USEC_PER_MSEC * MSEC_PER_SEC)
+
+uint64_t sim_now_us;
+int sim_locks_held;
+
+static struct k_work_delayable *works[2];
+static size_t work_count;
+static int log_level = 3;
+
+struct exchange
+{
+	struct end *end;
+	uint64_t sent_us;
+};
+
+struct end
+{
+	const char *name;
+	struct device dev;
+	struct end *peer;
+	struct mesh_uart_tx_queue tx_queue;
+	struct mesh_uart_requester requester;
+	struct mesh_uart_frame_parser parser;
+	struct mesh_uart_rx rx;
+	uint8_t ring[LOOPBACK_RING_SIZE];
+	/* Transfer on the line, it ends at tx_end_us. */
+	const uint8_t *tx_buf;
+	size_t tx_len;
+	bool tx_active;
+	bool tx_aborted;
+	uint64_t tx_end_us;
+	/* Received bytes are parsed at parse_us. */
+	bool parse_pending;
+	uint64_t parse_us;
+	/* Benchmark. */
+	struct exchange *exchanges;
+	uint32_t *latency_us;
+	uint32_t sent;
+	uint32_t ok;
+	uint32_t failed;
+	uint64_t last_done_us;
+	uint64_t gap_max_us;
+	uint32_t answers_dropped;
+	uint32_t undecodable;
+};
+
+static struct end ends[2];
+static uint32_t frames = LOOPBACK_FRAMES;
+static uint32_t baudrate = LOOPBACK_BAUDRATE;
+static uint32_t timeout_ms = LOOPBACK_TIMEOUT_MS;
+static struct mesh_uart_rx_faults faults;
+
+void sim_work_register(struct k_work_delayable *dwork)
+{
+	assert(work_count < ARRAY_SIZE(works));
+	works[work_count++] = dwork;
+}
+
+void sim_log(int level, const char *fmt, ...)
+{
+	va_list args;
+
+	assert(sim_locks_held == 0);
+	if (level > log_level)
+	{
+		return;
+	}
+	printf("%10.3f ms  ", sim_now_us / 1000.0);
+	va_start(args, fmt);
+	vprintf(fmt, args);
+	va_end(args);
+	printf("\n");
+}
+
+/* Simulated UART. */
+
+int uart_tx(const struct device *dev, const uint8_t *buf, size_t len, int32_t timeout)
+{
+	struct end *end = dev->data;
+
+	ARG_UNUSED(timeout);
+	assert(sim_locks_held == 0);
+
+	if (end->tx_active)
+	{
+		return -EBUSY;
+	}
+	end->tx_buf = buf;
+	end->tx_len = len;
+	end->tx_active = true;
+	end->tx_aborted = false;
+	end->tx_end_us = sim_now_us + ((uint64_t)len * 10 * USEC_PER_MSEC * MSEC_PER_SEC + baudrate - 1) /
+		baudrate;
+	return 0;
+}
+
+int uart_tx_abort(const struct device *dev)
+{
+	struct end *end = dev->data;
+
+	if (!end->tx_active)
+	{
+		return -EFAULT;
+	}
+	end->tx_aborted = true;
+	end->tx_end_us = sim_now_us;
+	return 0;
+}
+
+int uart_rx_enable(const struct device *dev, uint8_t *buf, size_t len, int32_t timeout)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(buf);
+	ARG_UNUSED(len);
+	ARG_UNUSED(timeout);
+	return -ENOTSUP;
+}
+
+int uart_rx_buf_rsp(const struct device *dev, uint8_t *buf, size_t len)
+{
+	ARG_UNUSED(dev);
+	ARG_UNUSED(buf);
+	ARG_UNUSED(len);
+	return -ENOTSUP;
+}
+
+int uart_rx_disable(const struct device *dev)
+{
+	ARG_UNUSED(dev);
+	return -ENOTSUP;
+}
+
+int uart_config_get(const struct device *dev, struct uart_config *cfg)
+{
+	ARG_UNUSED(dev);
+	cfg->baudrate = baudrate;
+	return 0;
+}
+
+/* The transfer has left the line. The peer receives it, and the sender gets UART_TX_DONE. */
+static void tx_end(struct end *end)
+{
+	struct uart_event evt = {
+		.type = end->tx_aborted ? UART_TX_ABORTED : UART_TX_DONE,
+	};
+
+	end->tx_active = false;
+	if (!end->tx_aborted)
+	{
+		struct end *peer = end->peer;
+		struct uart_event rx_evt = {
+			.type = UART_RX_RDY,
+			.data.rx = {
+				.buf = (uint8_t *)end->tx_buf,
+				.len = end->tx_len,
+			},
+		};
+
+		mesh_uart_rx_on_event(&peer->rx, &rx_evt);
+		if (!peer->parse_pending)
+		{
+			peer->parse_pending = true;
+			peer->parse_us = sim_now_us + (uint64_t)peer->rx.faults.latency_ms * USEC_PER_MSEC;
+		}
+	}
+	mesh_uart_tx_queue_on_event(&end->tx_queue, &evt);
+}
+
+/* Benchmark. */
+
+static void exchange_start(struct end *end);
+
+static void exchange_done(int err, const union mesh_uart_msg *rsp, void *user_data)
+{
+	struct exchange *exchange = user_data;
+	struct end *end = exchange->end;
+
+	if (!err && rsp->header.type == STATUS)
+	{
+		err = rsp->status.data.status;
+	}
+
+	if (err)
+	{
+		end->failed++;
+	}
+	else
+	{
+		end->latency_us[end->ok++] = sim_now_us - exchange->sent_us;
+		end->gap_max_us = MAX(end->gap_max_us, sim_now_us - end->last_done_us);
+		end->last_done_us = sim_now_us;
+	}
+
+	exchange_start(end);
+}
+
+static void exchange_start(struct end *end)
+{
+	struct mesh_uart_link_test_msg msg = {
+		.header = {
+			.type = LINK_TEST,
+		},
+	};
+
+	if (end->sent == frames)
+	{
+		return;
+	}
+
+	struct exchange *exchange = &end->exchanges[end->sent++];
+
+	exchange->end = end;
+	exchange->sent_us = sim_now_us;
+	msg.seed = end->sent;
+	for (int i = 0; i < MESH_UART_LINK_TEST_LEN; i++)
+	{
+		msg.pattern[i] = MESH_UART_LINK_TEST_BYTE(msg.seed, i);
+	}
+
+	int err = mesh_uart_request_send(&end->requester, &msg, sizeof(msg), timeout_ms,
+					 exchange_done, exchange);
+	if (err)
+	{
+		exchange_done(err, NULL, exchange);
+	}
+}
+
+static int link_test_check(const struct mesh_uart_link_test_msg *msg)
+{
+	for (size_t i = 0; i < MESH_UART_LINK_TEST_LEN; i++)
+	{
+		if (msg->pattern[i] != MESH_UART_LINK_TEST_BYTE(msg->seed, i))
+		{
+			return -EIO;
+		}
+	}
+	return 0;
+}
+
+static void frame_handler(const uint8_t *payload, size_t len, void *user_data)
+{
+	struct end *end = user_data;
+	union mesh_uart_msg msg;
+
+	if (mesh_uart_msg_decode(payload, len, &msg))
+	{
+		end->undecodable++;
+		return;
+	}
+
+	switch (msg.header.type)
+	{
+	case LINK_TEST:
+	{
+		struct mesh_uart_status_msg status = {
+			.header = {
+				.type = STATUS,
+				.seq = msg.header.seq,
+			},
+			.data = {
+				.status = link_test_check(&msg.link_test),
+			},
+		};
+
+		if (mesh_uart_tx_queue_send(&end->tx_queue, &status, sizeof(status), NULL, NULL))
+		{
+			end->answers_dropped++;
+		}
+		break;
+	}
+	case STATUS:
+		mesh_uart_request_on_response(&end->requester, &msg);
+		break;
+	default:
+		end->undecodable++;
+		break;
+	}
+}
+
+static void end_init(struct end *end, const char *name, struct end *peer, uint32_t seed)
+{
+	end->name = name;
+	end->dev.name = name;
+	end->dev.data = end;
+	end->peer = peer;
+	end->exchanges = calloc(frames, sizeof(*end->exchanges));
+	end->latency_us = calloc(frames, sizeof(*end->latency_us));
+	if (!end->exchanges || !end->latency_us)
+	{
+		exit(1);
+	}
+
+	mesh_uart_tx_queue_init(&end->tx_queue, &end->dev);
+	mesh_uart_tx_queue_version_set(&end->tx_queue, MESH_UART_PROTOCOL_VERSION);
+	mesh_uart_requester_init(&end->requester, &end->tx_queue, LOOPBACK_RETRIES);
+	mesh_uart_frame_parser_init(&end->parser, frame_handler, end);
+	mesh_uart_rx_init(&end->rx, &end->parser, end->ring, sizeof(end->ring), false);
+	/* Both ends would otherwise hit the same bytes. */
+	end->rx.fault_rand = seed;
+	mesh_uart_rx_faults_set(&end->rx, &faults);
+}
+
+static bool end_done(const struct end *end)
+{
+	return end->ok + end->failed == frames;
+}
+
+/* Run whatever is due next. Returns false if nothing is left to run. */
+static bool step(void)
+{
+	uint64_t next = UINT64_MAX;
+	struct end *tx = NULL;
+	struct end *parse = NULL;
+	struct k_work_delayable *work = NULL;
+
+	for (size_t i = 0; i < ARRAY_SIZE(ends); i++)
+	{
+		if (ends[i].tx_active && ends[i].tx_end_us < next)
+		{
+			next = ends[i].tx_end_us;
+			tx = &ends[i];
+		}
+	}
+	for (size_t i = 0; i < ARRAY_SIZE(ends); i++)
+	{
+		if (ends[i].parse_pending && ends[i].parse_us < next)
+		{
+			next = ends[i].parse_us;
+			tx = NULL;
+			parse = &ends[i];
+		}
+	}
+	for (size_t i = 0; i < work_count; i++)
+	{
+		if (works[i]->pending && works[i]->due_us < next)
+		{
+			next = works[i]->due_us;
+			tx = NULL;
+			parse = NULL;
+			work = works[i];
+		}
+	}
+
+	if (next == UINT64_MAX)
+	{
+		return false;
+	}
+	sim_now_us = MAX(sim_now_us, next);
+
+	if (tx)
+	{
+		tx_end(tx);
+	}
+	else if (parse)
+	{
+		parse->parse_pending = false;
+		mesh_uart_rx_process(&parse->rx);
+	}
+	else
+	{
+		work->pending = false;
+		work->work.handler(&work->work);
+	}
+	return true;
+}
+
+static int compare_u32(const void *a, const void *b)
+{
+	uint32_t x = *(const uint32_t *)a;
+	uint32_t y = *(const uint32_t *)b;
+
+	return (x > y) - (x < y);
+}
+
+static void end_report(struct end *end)
+{
+	uint64_t elapsed_us = MAX(end->last_done_us, 1);
+	struct mesh_uart_tx_stats tx_stats;
+
+	mesh_uart_tx_queue_stats_get(&end->tx_queue, &tx_stats);
+	printf("%s: %u of %u exchanges, %u exchanges/s, %u frames/s sent\n", end->name, end->ok,
+	       frames, (uint32_t)(end->ok * USEC_PER_MSEC * MSEC_PER_SEC / elapsed_us),
+	       (uint32_t)((uint64_t)tx_stats.frames * USEC_PER_MSEC * MSEC_PER_SEC / elapsed_us));
+	if (end->ok)
+	{
+		qsort(end->latency_us, end->ok, sizeof(*end->latency_us), compare_u32);
+		printf("%s: latency p50 %u us, p99 %u us, longest recovery %u us\n", end->name,
+		       end->latency_us[end->ok / 2], end->latency_us[end->ok * 99 / 100],
+		       (uint32_t)end->gap_max_us);
+	}
+	printf("%s: received %u frames, %u CRC errors, %u resyncs, %u undecodable, "
+	       "%u bytes dropped and %u corrupted by faults, %u answers dropped\n",
+	       end->name, end->parser.stats.frames, end->parser.stats.crc_errors,
+	       end->parser.stats.resyncs, end->undecodable, end->rx.stats.injected_drops,
+	       end->rx.stats.injected_corruptions, end->answers_dropped);
+	mesh_uart_request_stats_log(&end->requester);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"usage: %s [-n frames] [-b baudrate] [-d drop_ppm] [-c corrupt_ppm] "
+		"[-l latency_ms] [-t timeout_ms] [-s seed] [-q] [-v]\n",
+		name);
+	exit(2);
+}
+
+int main(int argc, char **argv)
+{
+	uint32_t seed = 0x2545f491;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "n:b:d:c:l:t:s:qv")) != -1)
+	{
+		switch (opt)
+		{
+		case 'n':
+			frames = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			baudrate = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			faults.drop_ppm = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			faults.corrupt_ppm = strtoul(optarg, NULL, 0);
+			break;
+		case 'l':
+			faults.latency_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			timeout_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			seed = strtoul(optarg, NULL, 0);
+			break;
+		case 'q':
+			log_level = 1;
+			break;
+		case 'v':
+			log_level = 4;
+			break;
+		default:
+			usage(argv[0]);
+		}
+	}
+	if (optind != argc || frames == 0 || baudrate == 0 || seed == 0)
+	{
+		usage(argv[0]);
+	}
+
+	end_init(&ends[0], "A", &ends[1], seed);
+	end_init(&ends[1], "B", &ends[0], seed * 2654435761u | 1);
+
+	printf("%u baud, %u exchanges each way, %u ppm dropped, %u ppm corrupted, %u ms latency\n",
+	       baudrate, frames, faults.drop_ppm, faults.corrupt_ppm, faults.latency_ms);
+
+	for (size_t i = 0; i < ARRAY_SIZE(ends); i++)
+	{
+		for (int j = 0; j < MESH_UART_REQUEST_WINDOW; j++)
+		{
+			exchange_start(&ends[i]);
+		}
+	}
+
+	while (!end_done(&ends[0]) || !end_done(&ends[1]))
+	{
+		if (!step() || sim_now_us > LOOPBACK_TIME_MAX_US)
+		{
+			printf("Link stalled at %u ms\n", k_uptime_get_32());
+			return 1;
+		}
+	}
+
+	bool faultless = !faults.drop_ppm && !faults.corrupt_ppm;
+	int ret = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(ends); i++)
+	{
+		end_report(&ends[i]);
+		if (faultless && ends[i].failed)
+		{
+			ret = 1;
+		}
+	}
+	return ret;
+}
@@ -1,4 +1,5 @@
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
 enum mesh_uart_msg_type
@@ -11,8 +12,39 @@ enum mesh_uart_msg_type
     MOVEMENT_REPORTED=0x05, // Movement report from robot.
     CLEAR_TO_MOVE=0x06, // Robots ready to move.
     MOVEMENT_CONFIG_ACCEPTED=0x07, // Movement configuration accepted by robot.
+    SET_MOVEMENT_CONFIG_BATCH=0x08, // Set movement configuration of several robots.
+    MOVEMENT_CONFIG_ACCEPTED_BATCH=0x09, // Movement configurations accepted by robots.
+    BAUDRATE_SET=0x0A, // Switch to a new baud rate on probation.
+    BAUDRATE_COMMIT=0x0B, // Keep the baud rate that is on probation.
+    LINK_TEST=0x0C, // Link self-test frame.
+    MOVEMENT_REPORTED_BATCH=0x0D, // Movement reports from several robots.
+    ROBOT_STATS_GET=0x0E, // Request the mesh link statistics of every robot.
+    ROBOT_STATS=0x0F, // Mesh link statistics of several robots.
+    GROUP_SET=0x10, // Set the groups a robot belongs to.
+    CLEAR_TO_MOVE_GROUP=0x11, // Robots of a group ready to move.
+    PARAMS_SET=0x12, // Set the movement parameters and script of a robot.
+    MESH_UART_MSG_TYPE_COUNT, // Number of message types, new types go above.
 };
 
+#define MESH_UART_MOVEMENT_CONFIG_BATCH_MAX 20 // Maximum number of configurations in a batch.
+#define MESH_UART_MOVEMENT_REPORTED_BATCH_MAX 16 // Maximum number of movement reports in a batch.
+#define MESH_UART_ROBOT_STATS_BATCH_MAX 7 // Maximum number of robots in a statistics batch.
+#define MESH_UART_GROUP_SET_MAX 4 // Maximum number of groups a robot belongs to.
+#define MESH_UART_SCRIPT_STEPS_MAX 12 // Maximum number of steps in a movement script.
+
+/* Baud rate negotiation.
+ *
+ * Both sides start at the baud rate set in devicetree and report the highest rate they support
+ * in HELLO. The gateway then tries the rates in MESH_UART_BAUDRATES from the top. The nRF52840
+ * answers BAUDRATE_SET at the old rate, switches once the answer is sent, and goes back to the
+ * old rate unless BAUDRATE_COMMIT arrives within MESH_UART_BAUDRATE_PROBATION_MS. In between the
+ * gateway sends a burst of LINK_TEST frames, which must all come back with a good status.
+ */
+#define MESH_UART_BAUDRATES {1000000, 921600, 460800, 230400, 115200}
+#define MESH_UART_BAUDRATE_PROBATION_MS 2000
+#define MESH_UART_LINK_TEST_LEN 64
+#define MESH_UART_LINK_TEST_BYTE(_seed, _i) ((uint8_t)((_seed) * 31 + (_i))) // Covers every byte value, zero included.
+
 struct mesh_uart_status_data
 {
     int16_t status;
@@ -40,15 +72,65 @@ struct mesh_uart_movement_config
     int32_t angle;
 }__packed;
 
+/* Round trip times of movement configurations are counted in bins. Bin i holds the ones shorter
+ * than MESH_UART_ROBOT_STATS_RTT_BIN_MS << i that did not fit in an earlier bin, the last bin
+ * holds the rest.
+ */
+#define MESH_UART_ROBOT_STATS_RTT_BINS 8
+#define MESH_UART_ROBOT_STATS_RTT_BIN_MS 25
+
+struct mesh_uart_robot_stats
+{
+    uint16_t addr; // Mesh network address
+    uint16_t sent; // Movement configurations sent to the robot.
+    uint16_t acked; // Movement configurations the robot acknowledged.
+    uint16_t timeouts; // Movement configurations the robot never acknowledged.
+    uint16_t retries; // Movement configurations sent again.
+    uint16_t rtt_bins[MESH_UART_ROBOT_STATS_RTT_BINS]; // Acknowledged at the first attempt.
+    int8_t rssi; // RSSI of the last message from the robot, 0 if unknown.
+    uint8_t ttl; // TTL of the last message from the robot.
+    uint8_t hops; // Relay hops to the robot.
+    uint32_t last_seen_ms; // Time since the last message from the robot, UINT32_MAX if never.
+}__packed;
+
+/* Protocol versions. Both sides report the versions they speak in HELLO and use the newest one
+ * they have in common. HELLO itself must stay the same in every version. The codec refuses to
+ * send messages that are newer than the version in use, see uart_codec.h.
+ */
+#define MESH_UART_PROTOCOL_VERSION_MIN 1
+#define MESH_UART_PROTOCOL_VERSION 4 // 2: ROBOT_STATS_GET and ROBOT_STATS. 3: GROUP_SET and CLEAR_TO_MOVE_GROUP. 4: PARAMS_SET.
+
+#define MESH_UART_SEQ_NONE 0 // Sequence number of messages that are not part of a request.
+
+/* Requests carry a sequence number that the responder copies into its responses. STATUS and
+ * HELLO end a request, other responses with the same number may come before them.
+ */
 struct mesh_uart_msg_header
 {
-    enum mesh_uart_msg_type type;
+    uint8_t type; // enum mesh_uart_msg_type
+    uint8_t seq;
 }__packed;
 
 struct mesh_uart_hello_msg
 {
     struct mesh_uart_msg_header header;
     uint16_t echo;
+    uint32_t baudrate_max; // Highest baud rate the sender supports.
+    uint8_t version_min; // Oldest protocol version the sender speaks.
+    uint8_t version_max; // Newest protocol version the sender speaks.
+}__packed;
+
+struct mesh_uart_baudrate_msg
+{
+    struct mesh_uart_msg_header header;
+    uint32_t baudrate;
+}__packed;
+
+struct mesh_uart_link_test_msg
+{
+    struct mesh_uart_msg_header header;
+    uint8_t seed;
+    uint8_t pattern[MESH_UART_LINK_TEST_LEN]; // MESH_UART_LINK_TEST_BYTE(seed, i)
 }__packed;
 
 struct mesh_uart_robot_added_msg
@@ -81,11 +163,109 @@ struct mesh_uart_movement_config_accepted_msg
     struct mesh_uart_movement_config data;
 }__packed;
 
+/* Batches are sent with only the used entries, see MESH_UART_MOVEMENT_CONFIG_BATCH_LEN(). */
+struct mesh_uart_movement_config_batch_msg
+{
+    struct mesh_uart_msg_header header;
+    uint8_t count;
+    struct mesh_uart_movement_config configs[MESH_UART_MOVEMENT_CONFIG_BATCH_MAX];
+}__packed;
+
+#define MESH_UART_MOVEMENT_CONFIG_BATCH_LEN(_count) \
+    (offsetof(struct mesh_uart_movement_config_batch_msg, configs) + \
+     (_count) * sizeof(struct mesh_uart_movement_config))
+
+/* Movement reports are not requested, they are sent with MESH_UART_SEQ_NONE as the robots
+ * report in. Only the used entries are sent, see MESH_UART_MOVEMENT_REPORTED_BATCH_LEN().
+ */
+struct mesh_uart_movement_reported_batch_msg
+{
+    struct mesh_uart_msg_header header;
+    uint8_t count;
+    struct mesh_uart_movement_reported_data reports[MESH_UART_MOVEMENT_REPORTED_BATCH_MAX];
+}__packed;
+
+#define MESH_UART_MOVEMENT_REPORTED_BATCH_LEN(_count) \
+    (offsetof(struct mesh_uart_movement_reported_batch_msg, reports) + \
+     (_count) * sizeof(struct mesh_uart_movement_reported_data))
+
 struct mesh_uart_clear_to_move_msg
 {
     struct mesh_uart_msg_header header;
 }__packed;
 
+struct mesh_uart_group
+{
+    uint16_t addr; // Mesh group address
+}__packed;
+
+/* The robot is subscribed to exactly the groups in the message, and unsubscribed from any other.
+ * Only the used entries are sent, see MESH_UART_GROUP_SET_LEN().
+ */
+struct mesh_uart_group_set_msg
+{
+    struct mesh_uart_msg_header header;
+    uint16_t addr; // Mesh network address of the robot.
+    uint8_t count;
+    struct mesh_uart_group groups[MESH_UART_GROUP_SET_MAX];
+}__packed;
+
+#define MESH_UART_GROUP_SET_LEN(_count) \
+    (offsetof(struct mesh_uart_group_set_msg, groups) + \
+     (_count) * sizeof(struct mesh_uart_group))
+
+/* Like CLEAR_TO_MOVE, but only the robots of the group start. */
+struct mesh_uart_clear_to_move_group_msg
+{
+    struct mesh_uart_msg_header header;
+    uint16_t group; // Mesh group address
+}__packed;
+
+struct mesh_uart_script_step
+{
+    uint32_t time; // Drive time in milliseconds.
+    int32_t angle; // Angle to turn in degrees.
+}__packed;
+
+/* Sent to the robot in one acknowledged mesh transaction. Only the used steps are sent, see
+ * MESH_UART_PARAMS_SET_LEN().
+ */
+struct mesh_uart_params_set_msg
+{
+    struct mesh_uart_msg_header header;
+    uint16_t addr; // Mesh network address of the robot.
+    int16_t kp; // PID gains for turning, in thousandths.
+    int16_t ki;
+    int16_t kd;
+    int16_t trim_a; // Thousandths of full power added to motor A.
+    int16_t trim_b; // Thousandths of full power added to motor B.
+    uint8_t count;
+    struct mesh_uart_script_step steps[MESH_UART_SCRIPT_STEPS_MAX];
+}__packed;
+
+#define MESH_UART_PARAMS_SET_LEN(_count) \
+    (offsetof(struct mesh_uart_params_set_msg, steps) + \
+     (_count) * sizeof(struct mesh_uart_script_step))
+
+struct mesh_uart_robot_stats_get_msg
+{
+    struct mesh_uart_msg_header header;
+}__packed;
+
+/* ROBOT_STATS_GET is answered with as many ROBOT_STATS as it takes to hold every robot the
+ * nRF52840 knows of, then STATUS. Only the used entries are sent, see MESH_UART_ROBOT_STATS_LEN().
+ */
+struct mesh_uart_robot_stats_msg
+{
+    struct mesh_uart_msg_header header;
+    uint8_t count;
+    struct mesh_uart_robot_stats robots[MESH_UART_ROBOT_STATS_BATCH_MAX];
+}__packed;
+
+#define MESH_UART_ROBOT_STATS_LEN(_count) \
+    (offsetof(struct mesh_uart_robot_stats_msg, robots) + \
+     (_count) * sizeof(struct mesh_uart_robot_stats))
+
 union mesh_uart_msg
 {
     struct mesh_uart_msg_header header;
@@ -96,4 +276,14 @@ union mesh_uart_msg
     struct mesh_uart_set_movement_config_msg set_movement_config;
     struct mesh_uart_clear_to_move_msg clear_to_move;
     struct mesh_uart_movement_config_accepted_msg movement_config_accepted;
+    struct mesh_uart_movement_config_batch_msg set_movement_config_batch;
+    struct mesh_uart_movement_config_batch_msg movement_config_accepted_batch;
+    struct mesh_uart_baudrate_msg baudrate;
+    struct mesh_uart_link_test_msg link_test;
+    struct mesh_uart_movement_reported_batch_msg movement_reported_batch;
+    struct mesh_uart_robot_stats_get_msg robot_stats_get;
+    struct mesh_uart_robot_stats_msg robot_stats;
+    struct mesh_uart_group_set_msg group_set;
+    struct mesh_uart_clear_to_move_group_msg clear_to_move_group;
+    struct mesh_uart_params_set_msg params_set;
 };
\ No newline at end of file
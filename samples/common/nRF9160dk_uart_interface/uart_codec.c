@@ -0,0 +1,458 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/util.h>
+
+#include "uart_codec.h"
+
+/* A field, or an array of fields, of a message. */
+struct codec_field
+{
+	uint16_t offset;
+	uint8_t width;
+	uint8_t count;
+};
+
+/* A message type. Fixed size messages have no entries. */
+struct codec_msg
+{
+	const char *name;
+	uint8_t version;
+	/* Length of the message, or of the part before the entries. */
+	uint16_t len;
+	const struct codec_field *fields;
+	uint8_t field_count;
+	/* Entries following the fixed part, their number is in the byte at count_offset. */
+	const struct codec_field *entry_fields;
+	uint8_t entry_field_count;
+	uint16_t entry_len;
+	uint8_t entry_max;
+	uint16_t count_offset;
+};
+
+#define FIELD(_type, _member) \
+	{ \
+		.offset = offsetof(_type, _member), \
+		.width = sizeof(((_type *)0)->_member), \
+		.count = 1, \
+	}
+
+#define FIELD_ARRAY(_type, _member) \
+	{ \
+		.offset = offsetof(_type, _member), \
+		.width = sizeof(((_type *)0)->_member[0]), \
+		.count = ARRAY_SIZE(((_type *)0)->_member), \
+	}
+
+#define MSG(_type, _version, _struct, _fields) \
+	[_type] = { \
+		.name = #_type, \
+		.version = _version, \
+		.len = sizeof(_struct), \
+		.fields = _fields, \
+		.field_count = ARRAY_SIZE(_fields), \
+	}
+
+#define MSG_EMPTY(_type, _version, _struct) \
+	[_type] = { \
+		.name = #_type, \
+		.version = _version, \
+		.len = sizeof(_struct), \
+	}
+
+#define MSG_BATCH(_type, _version, _struct, _count, _entries, _fields, _entry_fields) \
+	[_type] = { \
+		.name = #_type, \
+		.version = _version, \
+		.len = offsetof(_struct, _entries), \
+		.fields = _fields, \
+		.field_count = ARRAY_SIZE(_fields), \
+		.entry_fields = _entry_fields, \
+		.entry_field_count = ARRAY_SIZE(_entry_fields), \
+		.entry_len = sizeof(((_struct *)0)->_entries[0]), \
+		.entry_max = ARRAY_SIZE(((_struct *)0)->_entries), \
+		.count_offset = offsetof(_struct, _count), \
+	}
+
+/* Field tables. The message header is the same for every type and is not listed. */
+
+static const struct codec_field hello_fields[] = {
+	FIELD(struct mesh_uart_hello_msg, echo),
+	FIELD(struct mesh_uart_hello_msg, baudrate_max),
+	FIELD(struct mesh_uart_hello_msg, version_min),
+	FIELD(struct mesh_uart_hello_msg, version_max),
+};
+
+static const struct codec_field movement_config_fields[] = {
+	FIELD(struct mesh_uart_set_movement_config_msg, data.addr),
+	FIELD(struct mesh_uart_set_movement_config_msg, data.time),
+	FIELD(struct mesh_uart_set_movement_config_msg, data.angle),
+};
+
+static const struct codec_field robot_added_fields[] = {
+	FIELD(struct mesh_uart_robot_added_msg, data.addr),
+	FIELD_ARRAY(struct mesh_uart_robot_added_msg, data.mac_address),
+	FIELD(struct mesh_uart_robot_added_msg, data.mesh_address),
+};
+
+static const struct codec_field status_fields[] = {
+	FIELD(struct mesh_uart_status_msg, data.status),
+};
+
+static const struct codec_field movement_reported_fields[] = {
+	FIELD(struct mesh_uart_movement_reported_msg, data.addr),
+	FIELD(struct mesh_uart_movement_reported_msg, data.x),
+	FIELD(struct mesh_uart_movement_reported_msg, data.y),
+	FIELD(struct mesh_uart_movement_reported_msg, data.yaw),
+};
+
+static const struct codec_field baudrate_fields[] = {
+	FIELD(struct mesh_uart_baudrate_msg, baudrate),
+};
+
+static const struct codec_field link_test_fields[] = {
+	FIELD(struct mesh_uart_link_test_msg, seed),
+	FIELD_ARRAY(struct mesh_uart_link_test_msg, pattern),
+};
+
+static const struct codec_field movement_config_batch_fields[] = {
+	FIELD(struct mesh_uart_movement_config_batch_msg, count),
+};
+
+static const struct codec_field movement_config_entry_fields[] = {
+	FIELD(struct mesh_uart_movement_config, addr),
+	FIELD(struct mesh_uart_movement_config, time),
+	FIELD(struct mesh_uart_movement_config, angle),
+};
+
+static const struct codec_field movement_reported_batch_fields[] = {
+	FIELD(struct mesh_uart_movement_reported_batch_msg, count),
+};
+
+static const struct codec_field movement_reported_entry_fields[] = {
+	FIELD(struct mesh_uart_movement_reported_data, addr),
+	FIELD(struct mesh_uart_movement_reported_data, x),
+	FIELD(struct mesh_uart_movement_reported_data, y),
+	FIELD(struct mesh_uart_movement_reported_data, yaw),
+};
+
+static const struct codec_field robot_stats_fields[] = {
+	FIELD(struct mesh_uart_robot_stats_msg, count),
+};
+
+static const struct codec_field robot_stats_entry_fields[] = {
+	FIELD(struct mesh_uart_robot_stats, addr),
+	FIELD(struct mesh_uart_robot_stats, sent),
+	FIELD(struct mesh_uart_robot_stats, acked),
+	FIELD(struct mesh_uart_robot_stats, timeouts),
+	FIELD(struct mesh_uart_robot_stats, retries),
+	FIELD_ARRAY(struct mesh_uart_robot_stats, rtt_bins),
+	FIELD(struct mesh_uart_robot_stats, rssi),
+	FIELD(struct mesh_uart_robot_stats, ttl),
+	FIELD(struct mesh_uart_robot_stats, hops),
+	FIELD(struct mesh_uart_robot_stats, last_seen_ms),
+};
+
+static const struct codec_field group_set_fields[] = {
+	FIELD(struct mesh_uart_group_set_msg, addr),
+	FIELD(struct mesh_uart_group_set_msg, count),
+};
+
+static const struct codec_field group_entry_fields[] = {
+	FIELD(struct mesh_uart_group, addr),
+};
+
+static const struct codec_field clear_to_move_group_fields[] = {
+	FIELD(struct mesh_uart_clear_to_move_group_msg, group),
+};
+
+static const struct codec_field params_set_fields[] = {
+	FIELD(struct mesh_uart_params_set_msg, addr),
+	FIELD(struct mesh_uart_params_set_msg, kp),
+	FIELD(struct mesh_uart_params_set_msg, ki),
+	FIELD(struct mesh_uart_params_set_msg, kd),
+	FIELD(struct mesh_uart_params_set_msg, trim_a),
+	FIELD(struct mesh_uart_params_set_msg, trim_b),
+	FIELD(struct mesh_uart_params_set_msg, count),
+};
+
+static const struct codec_field script_step_fields[] = {
+	FIELD(struct mesh_uart_script_step, time),
+	FIELD(struct mesh_uart_script_step, angle),
+};
+
+/* Message table, indexed by type. Types without an entry are unknown. */
+static const struct codec_msg codec_msgs[] = {
+	MSG(HELLO, 1, struct mesh_uart_hello_msg, hello_fields),
+	MSG(SET_MOVEMENT_CONFIG, 1, struct mesh_uart_set_movement_config_msg, movement_config_fields),
+	MSG(ROBOT_ADDED, 1, struct mesh_uart_robot_added_msg, robot_added_fields),
+	MSG(STATUS, 1, struct mesh_uart_status_msg, status_fields),
+	MSG(MOVEMENT_REPORTED, 1, struct mesh_uart_movement_reported_msg, movement_reported_fields),
+	MSG_EMPTY(CLEAR_TO_MOVE, 1, struct mesh_uart_clear_to_move_msg),
+	MSG(MOVEMENT_CONFIG_ACCEPTED, 1, struct mesh_uart_movement_config_accepted_msg,
+	    movement_config_fields),
+	MSG_BATCH(SET_MOVEMENT_CONFIG_BATCH, 1, struct mesh_uart_movement_config_batch_msg,
+		  count, configs, movement_config_batch_fields, movement_config_entry_fields),
+	MSG_BATCH(MOVEMENT_CONFIG_ACCEPTED_BATCH, 1, struct mesh_uart_movement_config_batch_msg,
+		  count, configs, movement_config_batch_fields, movement_config_entry_fields),
+	MSG(BAUDRATE_SET, 1, struct mesh_uart_baudrate_msg, baudrate_fields),
+	MSG(BAUDRATE_COMMIT, 1, struct mesh_uart_baudrate_msg, baudrate_fields),
+	MSG(LINK_TEST, 1, struct mesh_uart_link_test_msg, link_test_fields),
+	MSG_BATCH(MOVEMENT_REPORTED_BATCH, 1, struct mesh_uart_movement_reported_batch_msg,
+		  count, reports, movement_reported_batch_fields, movement_reported_entry_fields),
+	MSG_EMPTY(ROBOT_STATS_GET, 2, struct mesh_uart_robot_stats_get_msg),
+	MSG_BATCH(ROBOT_STATS, 2, struct mesh_uart_robot_stats_msg,
+		  count, robots, robot_stats_fields, robot_stats_entry_fields),
+	MSG_BATCH(GROUP_SET, 3, struct mesh_uart_group_set_msg,
+		  count, groups, group_set_fields, group_entry_fields),
+	MSG(CLEAR_TO_MOVE_GROUP, 3, struct mesh_uart_clear_to_move_group_msg, clear_to_move_group_fields),
+	MSG_BATCH(PARAMS_SET, 4, struct mesh_uart_params_set_msg,
+		  count, steps, params_set_fields, script_step_fields),
+};
+
+BUILD_ASSERT(ARRAY_SIZE(codec_msgs) == MESH_UART_MSG_TYPE_COUNT,
+	     "Every message type needs an entry in the codec table");
+
+/* The movement configuration messages share their field table. */
+BUILD_ASSERT(sizeof(struct mesh_uart_set_movement_config_msg) ==
+	     sizeof(struct mesh_uart_movement_config_accepted_msg));
+
+static const struct codec_msg *codec_msg_get(uint8_t type)
+{
+	if (type >= ARRAY_SIZE(codec_msgs) || codec_msgs[type].name == NULL)
+	{
+		return NULL;
+	}
+	return &codec_msgs[type];
+}
+
+static uint64_t host_get(const uint8_t *src, uint8_t width)
+{
+	switch (width)
+	{
+	case 2:
+	{
+		uint16_t value;
+		memcpy(&value, src, sizeof(value));
+		return value;
+	}
+	case 4:
+	{
+		uint32_t value;
+		memcpy(&value, src, sizeof(value));
+		return value;
+	}
+	case 8:
+	{
+		uint64_t value;
+		memcpy(&value, src, sizeof(value));
+		return value;
+	}
+	default:
+		return *src;
+	}
+}
+
+static void host_put(uint64_t value, uint8_t *dst, uint8_t width)
+{
+	switch (width)
+	{
+	case 2:
+	{
+		uint16_t host = value;
+		memcpy(dst, &host, sizeof(host));
+		break;
+	}
+	case 4:
+	{
+		uint32_t host = value;
+		memcpy(dst, &host, sizeof(host));
+		break;
+	}
+	case 8:
+		memcpy(dst, &value, sizeof(value));
+		break;
+	default:
+		*dst = value;
+		break;
+	}
+}
+
+static uint64_t wire_get(const uint8_t *src, uint8_t width)
+{
+	switch (width)
+	{
+	case 2:
+		return sys_get_le16(src);
+	case 4:
+		return sys_get_le32(src);
+	case 8:
+		return sys_get_le64(src);
+	default:
+		return *src;
+	}
+}
+
+static void wire_put(uint64_t value, uint8_t *dst, uint8_t width)
+{
+	switch (width)
+	{
+	case 2:
+		sys_put_le16(value, dst);
+		break;
+	case 4:
+		sys_put_le32(value, dst);
+		break;
+	case 8:
+		sys_put_le64(value, dst);
+		break;
+	default:
+		*dst = value;
+		break;
+	}
+}
+
+static void fields_encode(const struct codec_field *fields, uint8_t count, const uint8_t *src,
+			  uint8_t *dst)
+{
+	for (uint8_t i = 0; i < count; i++)
+	{
+		const struct codec_field *field = &fields[i];
+
+		for (uint8_t j = 0; j < field->count; j++)
+		{
+			size_t offset = field->offset + j * field->width;
+			wire_put(host_get(&src[offset], field->width), &dst[offset], field->width);
+		}
+	}
+}
+
+static void fields_decode(const struct codec_field *fields, uint8_t count, const uint8_t *src,
+			  uint8_t *dst)
+{
+	for (uint8_t i = 0; i < count; i++)
+	{
+		const struct codec_field *field = &fields[i];
+
+		for (uint8_t j = 0; j < field->count; j++)
+		{
+			size_t offset = field->offset + j * field->width;
+			host_put(wire_get(&src[offset], field->width), &dst[offset], field->width);
+		}
+	}
+}
+
+/* Length of a message of the given type, with the count byte found in data. */
+static int codec_msg_len(const struct codec_msg *desc, const uint8_t *data)
+{
+	if (desc->entry_len == 0)
+	{
+		return desc->len;
+	}
+
+	uint8_t count = data[desc->count_offset];
+	if (count > desc->entry_max)
+	{
+		return -EINVAL;
+	}
+	return desc->len + count * desc->entry_len;
+}
+
+/* Convert the fixed part and the entries of a message. */
+static void codec_msg_convert(const struct codec_msg *desc, const uint8_t *src, uint8_t *dst,
+			      size_t len, bool encode)
+{
+	void (*convert)(const struct codec_field *, uint8_t, const uint8_t *, uint8_t *) =
+		encode ? fields_encode : fields_decode;
+
+	memcpy(dst, src, sizeof(struct mesh_uart_msg_header));
+	convert(desc->fields, desc->field_count, src, dst);
+
+	for (size_t offset = desc->len; offset < len; offset += desc->entry_len)
+	{
+		convert(desc->entry_fields, desc->entry_field_count, &src[offset], &dst[offset]);
+	}
+}
+
+int mesh_uart_msg_encode(const void *msg, size_t len, uint8_t version, uint8_t *buf, size_t size)
+{
+	const uint8_t *data = msg;
+
+	if (len < sizeof(struct mesh_uart_msg_header))
+	{
+		return -EINVAL;
+	}
+
+	const struct codec_msg *desc = codec_msg_get(data[offsetof(struct mesh_uart_msg_header, type)]);
+	if (desc == NULL || desc->version > version)
+	{
+		return -ENOTSUP;
+	}
+	if (len < desc->len || codec_msg_len(desc, data) != (int)len)
+	{
+		return -EINVAL;
+	}
+	if (size < len)
+	{
+		return -ENOMEM;
+	}
+
+	codec_msg_convert(desc, data, buf, len, true);
+	return len;
+}
+
+int mesh_uart_msg_decode(const uint8_t *buf, size_t len, union mesh_uart_msg *msg)
+{
+	if (len < sizeof(struct mesh_uart_msg_header))
+	{
+		return -EBADMSG;
+	}
+
+	const struct codec_msg *desc = codec_msg_get(buf[offsetof(struct mesh_uart_msg_header, type)]);
+	if (desc == NULL)
+	{
+		return -ENOTSUP;
+	}
+	if (len < desc->len || codec_msg_len(desc, buf) != (int)len)
+	{
+		return -EBADMSG;
+	}
+
+	memset(msg, 0, sizeof(*msg));
+	codec_msg_convert(desc, buf, (uint8_t *)msg, len, false);
+	return 0;
+}
+
+int mesh_uart_msg_len(const union mesh_uart_msg *msg)
+{
+	const struct codec_msg *desc = codec_msg_get(msg->header.type);
+	if (desc == NULL)
+	{
+		return -ENOTSUP;
+	}
+	return codec_msg_len(desc, (const uint8_t *)msg);
+}
+
+const char *mesh_uart_msg_name(uint8_t type)
+{
+	const struct codec_msg *desc = codec_msg_get(type);
+
+	return desc ? desc->name : NULL;
+}
+
+uint8_t mesh_uart_version_negotiate(uint8_t peer_min, uint8_t peer_max)
+{
+	uint8_t version = MIN(peer_max, MESH_UART_PROTOCOL_VERSION);
+
+	if (version < MAX(peer_min, MESH_UART_PROTOCOL_VERSION_MIN))
+	{
+		return 0;
+	}
+	return version;
+}
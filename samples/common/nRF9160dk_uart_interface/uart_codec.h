@@ -0,0 +1,77 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+#include "messages.h"
+
+/* Encoding of the messages in messages.h on the nRF9160 <-> nRF52840 UART link.
+ *
+ * On the wire a message has the layout of its packed struct, with every field little endian.
+ * The codec is driven by a table in uart_codec.c that lists the fields of every message type,
+ * the protocol version that introduced it and, for batches, the entries that follow the fixed
+ * part. The table is the one place that knows the length of a message, both sides use it to
+ * check what they send and what they receive.
+ */
+
+/**
+ * @brief Encode a message for the wire.
+ *
+ * @param msg Message to encode, one of the message structs in messages.h.
+ * @param len Length of the message. Must be the length the table gives for its type.
+ * @param version Protocol version in use on the link.
+ * @param buf Buffer for the encoded message.
+ * @param size Size of the buffer.
+ *
+ * @return Length of the encoded message, -EINVAL if the message is malformed, -ENOTSUP if its
+ *         type is unknown or newer than the protocol version, -ENOMEM if the buffer is too small.
+ */
+int mesh_uart_msg_encode(const void *msg, size_t len, uint8_t version, uint8_t *buf, size_t size);
+
+/**
+ * @brief Decode a message received from the wire.
+ *
+ * Messages of every known type are accepted, whatever the protocol version in use.
+ *
+ * @param buf Encoded message.
+ * @param len Length of the encoded message.
+ * @param msg Filled with the decoded message. Bytes after the message are zeroed.
+ *
+ * @return 0 on success, -ENOTSUP if the type is unknown, -EBADMSG if the length does not match
+ *         the type.
+ */
+int mesh_uart_msg_decode(const uint8_t *buf, size_t len, union mesh_uart_msg *msg);
+
+/**
+ * @brief Get the length a message must have.
+ *
+ * @param msg Message. For batches the count must be set.
+ *
+ * @return Length of the message, -ENOTSUP if the type is unknown, -EINVAL if the count of a
+ *         batch is too large.
+ */
+int mesh_uart_msg_len(const union mesh_uart_msg *msg);
+
+/**
+ * @brief Get the name of a message type.
+ *
+ * @param type Message type.
+ *
+ * @return Name of the type, or NULL if the type is unknown.
+ */
+const char *mesh_uart_msg_name(uint8_t type);
+
+/**
+ * @brief Pick the protocol version to use with a peer.
+ *
+ * @param peer_min Oldest version the peer speaks.
+ * @param peer_max Newest version the peer speaks.
+ *
+ * @return Newest version both sides speak, or 0 if there is none.
+ */
+uint8_t mesh_uart_version_negotiate(uint8_t peer_min, uint8_t peer_max);
@@ -0,0 +1,234 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/kernel.h>
+
+#include "uart_codec.h"
+#include "uart_codec_bench.h"
+#include "uart_frame.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(mesh_uart_codec_bench, CONFIG_MESH_UART_CODEC_BENCH_LOG_LEVEL);
+
+struct bench_ctx
+{
+	union mesh_uart_msg decoded;
+	uint32_t frames;
+	int err;
+};
+
+static union mesh_uart_msg bench_msg;
+static uint8_t bench_payload[sizeof(union mesh_uart_msg)];
+static uint8_t bench_frame[MESH_UART_FRAME_ENCODED_SIZE(sizeof(union mesh_uart_msg))];
+static struct mesh_uart_frame_parser bench_parser;
+
+static void bench_frame_handler(const uint8_t *payload, size_t len, void *user_data)
+{
+	struct bench_ctx *ctx = user_data;
+
+	ctx->frames++;
+	ctx->err = mesh_uart_msg_decode(payload, len, &ctx->decoded);
+}
+
+/* Deterministic, so a failing input can be found again from the iteration it failed in. */
+static uint32_t xorshift32(uint32_t *state)
+{
+	uint32_t x = *state;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	*state = x;
+	return x;
+}
+
+static void sample_fill(uint8_t type)
+{
+	memset(&bench_msg, 0, sizeof(bench_msg));
+	bench_msg.header.type = type;
+	bench_msg.header.seq = 1;
+
+	switch (type)
+	{
+	case HELLO:
+		bench_msg.hello.echo = 0x1010;
+		bench_msg.hello.baudrate_max = 1000000;
+		bench_msg.hello.version_min = MESH_UART_PROTOCOL_VERSION_MIN;
+		bench_msg.hello.version_max = MESH_UART_PROTOCOL_VERSION;
+		break;
+	case SET_MOVEMENT_CONFIG:
+		bench_msg.set_movement_config.data.addr = 0x0102;
+		bench_msg.set_movement_config.data.time = 1500;
+		bench_msg.set_movement_config.data.angle = -90;
+		break;
+	case SET_MOVEMENT_CONFIG_BATCH:
+		bench_msg.set_movement_config_batch.count = MESH_UART_MOVEMENT_CONFIG_BATCH_MAX;
+		for (int i = 0; i < MESH_UART_MOVEMENT_CONFIG_BATCH_MAX; i++)
+		{
+			bench_msg.set_movement_config_batch.configs[i].addr = 0x0100 + i;
+			bench_msg.set_movement_config_batch.configs[i].time = 1000 + i;
+			bench_msg.set_movement_config_batch.configs[i].angle = -i;
+		}
+		break;
+	case MOVEMENT_REPORTED_BATCH:
+		bench_msg.movement_reported_batch.count = MESH_UART_MOVEMENT_REPORTED_BATCH_MAX;
+		for (int i = 0; i < MESH_UART_MOVEMENT_REPORTED_BATCH_MAX; i++)
+		{
+			bench_msg.movement_reported_batch.reports[i].addr = 0x0100 + i;
+			bench_msg.movement_reported_batch.reports[i].x = i;
+			bench_msg.movement_reported_batch.reports[i].y = -i;
+			bench_msg.movement_reported_batch.reports[i].yaw = 360 * i;
+		}
+		break;
+	case ROBOT_STATS:
+		bench_msg.robot_stats.count = MESH_UART_ROBOT_STATS_BATCH_MAX;
+		for (int i = 0; i < MESH_UART_ROBOT_STATS_BATCH_MAX; i++)
+		{
+			bench_msg.robot_stats.robots[i].addr = 0x0100 + i;
+			bench_msg.robot_stats.robots[i].sent = 100 + i;
+			bench_msg.robot_stats.robots[i].acked = 90 + i;
+			bench_msg.robot_stats.robots[i].rtt_bins[i] = 90 + i;
+			bench_msg.robot_stats.robots[i].rssi = -60 - i;
+			bench_msg.robot_stats.robots[i].last_seen_ms = 1000 * i;
+		}
+		break;
+	case PARAMS_SET:
+		bench_msg.params_set.addr = 0x0102;
+		bench_msg.params_set.kp = 1200;
+		bench_msg.params_set.ki = 50;
+		bench_msg.params_set.kd = -300;
+		bench_msg.params_set.trim_a = 15;
+		bench_msg.params_set.trim_b = -15;
+		bench_msg.params_set.count = MESH_UART_SCRIPT_STEPS_MAX;
+		for (int i = 0; i < MESH_UART_SCRIPT_STEPS_MAX; i++)
+		{
+			bench_msg.params_set.steps[i].time = 500 + i;
+			bench_msg.params_set.steps[i].angle = i % 2 ? 90 : -90;
+		}
+		break;
+	case LINK_TEST:
+		for (int i = 0; i < MESH_UART_LINK_TEST_LEN; i++)
+		{
+			bench_msg.link_test.pattern[i] = MESH_UART_LINK_TEST_BYTE(0, i);
+		}
+		break;
+	default:
+		break;
+	}
+}
+
+static int bench_type(uint8_t type, uint32_t iterations)
+{
+	struct bench_ctx ctx = {0};
+	uint32_t encode_cycles = 0;
+	uint32_t decode_cycles = 0;
+	int len;
+	int frame_len = 0;
+
+	sample_fill(type);
+	len = mesh_uart_msg_len(&bench_msg);
+	mesh_uart_frame_parser_init(&bench_parser, bench_frame_handler, &ctx);
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		uint32_t start = k_cycle_get_32();
+		int payload_len = mesh_uart_msg_encode(&bench_msg, len, MESH_UART_PROTOCOL_VERSION,
+						       bench_payload, sizeof(bench_payload));
+		frame_len = mesh_uart_frame_encode(bench_payload, payload_len, bench_frame,
+						   sizeof(bench_frame));
+		encode_cycles += k_cycle_get_32() - start;
+
+		if (payload_len < 0 || frame_len < 0)
+		{
+			LOG_ERR("%s: encoding failed", mesh_uart_msg_name(type));
+			return -EIO;
+		}
+
+		start = k_cycle_get_32();
+		mesh_uart_frame_parse(&bench_parser, bench_frame, frame_len);
+		decode_cycles += k_cycle_get_32() - start;
+	}
+
+	if (ctx.frames != iterations || ctx.err || memcmp(&ctx.decoded, &bench_msg, len))
+	{
+		LOG_ERR("%s: %u of %u frames came back, error %d", mesh_uart_msg_name(type),
+			ctx.frames, iterations, ctx.err);
+		return -EIO;
+	}
+
+	LOG_INF("%s: %d B message, %d B frame, encode %u cycles, decode %u cycles",
+		mesh_uart_msg_name(type), len, frame_len, encode_cycles / iterations,
+		decode_cycles / iterations);
+	return 0;
+}
+
+/* Decode random input. Whatever is accepted must encode back to the input. */
+static int fuzz(uint32_t iterations)
+{
+	uint32_t state = 0x2545f491;
+	uint32_t accepted = 0;
+
+	for (uint32_t i = 0; i < iterations; i++)
+	{
+		size_t len = xorshift32(&state) % (sizeof(bench_payload) + 1);
+
+		for (size_t j = 0; j < len; j++)
+		{
+			bench_payload[j] = xorshift32(&state);
+		}
+		/* Mostly known types, or almost everything would be turned away by type alone. */
+		if (len > 0 && (xorshift32(&state) & 1))
+		{
+			bench_payload[0] %= PARAMS_SET + 1;
+		}
+		if (len > 2 && (xorshift32(&state) & 1))
+		{
+			bench_payload[2] %= MESH_UART_MOVEMENT_CONFIG_BATCH_MAX + 1;
+		}
+
+		if (mesh_uart_msg_decode(bench_payload, len, &bench_msg))
+		{
+			continue;
+		}
+		accepted++;
+
+		int encoded = mesh_uart_msg_encode(&bench_msg, len, MESH_UART_PROTOCOL_VERSION,
+						   bench_frame, sizeof(bench_frame));
+		if (encoded != (int)len || memcmp(bench_frame, bench_payload, len))
+		{
+			LOG_ERR("Input %u of length %u does not encode back: %d", i, (uint32_t)len, encoded);
+			return -EIO;
+		}
+	}
+
+	LOG_INF("%u random inputs decoded, %u accepted", iterations, accepted);
+	return 0;
+}
+
+int mesh_uart_codec_bench_run(uint32_t iterations)
+{
+	static const uint8_t types[] = {
+		HELLO,
+		CLEAR_TO_MOVE,
+		SET_MOVEMENT_CONFIG,
+		SET_MOVEMENT_CONFIG_BATCH,
+		MOVEMENT_REPORTED_BATCH,
+		ROBOT_STATS,
+		PARAMS_SET,
+		LINK_TEST,
+	};
+	int err = 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(types); i++)
+	{
+		err |= bench_type(types[i], iterations);
+	}
+	err |= fuzz(iterations);
+
+	return err ? -EIO : 0;
+}
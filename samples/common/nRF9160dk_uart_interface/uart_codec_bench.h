@@ -0,0 +1,22 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+#include <stdint.h>
+
+/**
+ * @brief Benchmark and check the UART codec on target.
+ *
+ * Encodes and frames a set of representative messages, parses and decodes them again and logs
+ * the cycles spent per frame in each direction. Then decodes random input, and checks that
+ * whatever the codec accepts encodes back to the same bytes. Takes a while, only meant for
+ * development builds.
+ *
+ * @param iterations Round trips per message, and number of random inputs.
+ *
+ * @return 0 if every check passed, -EIO otherwise.
+ */
+int mesh_uart_codec_bench_run(uint32_t iterations);
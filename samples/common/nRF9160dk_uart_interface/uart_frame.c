@@ -0,0 +1,201 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
+#include <zephyr/sys/util.h>
+
+#include "messages.h"
+#include "uart_frame.h"
+
+BUILD_ASSERT(sizeof(union mesh_uart_msg) <= MESH_UART_FRAME_PAYLOAD_MAX,
+	     "UART messages do not fit in a frame");
+
+#define FRAME_DELIMITER 0x00
+#define CRC_SEED 0xffff
+
+static void parser_reset(struct mesh_uart_frame_parser *parser)
+{
+	parser->len = 0;
+	parser->code = 0;
+	parser->code_left = 0;
+	parser->discard = false;
+}
+
+/* Drop the current frame and skip input until the next delimiter. */
+static void parser_resync(struct mesh_uart_frame_parser *parser)
+{
+	parser->stats.resyncs++;
+	parser->discard = true;
+}
+
+static void parser_frame_end(struct mesh_uart_frame_parser *parser)
+{
+	if (parser->discard)
+	{
+		parser_reset(parser);
+		return;
+	}
+
+	/* Back to back delimiters, or line noise with no more than the start of a COBS block. The
+	 * block state is cleared as well, or the next frame would be decoded from the middle of it.
+	 */
+	if (parser->len == 0)
+	{
+		if (parser->code != 0)
+		{
+			parser->stats.resyncs++;
+		}
+		parser_reset(parser);
+		return;
+	}
+
+	/* The last COBS block must be complete. Its implicit zero is not part of the frame. */
+	if (parser->code_left != 0 || parser->len < MESH_UART_FRAME_OVERHEAD)
+	{
+		parser->stats.resyncs++;
+		parser_reset(parser);
+		return;
+	}
+
+	uint16_t payload_len = sys_get_le16(parser->buf);
+	if (payload_len != parser->len - MESH_UART_FRAME_OVERHEAD)
+	{
+		parser->stats.resyncs++;
+		parser_reset(parser);
+		return;
+	}
+
+	uint16_t crc = sys_get_le16(&parser->buf[parser->len - 2]);
+	if (crc != crc16_ccitt(CRC_SEED, parser->buf, parser->len - 2))
+	{
+		parser->stats.crc_errors++;
+		parser_reset(parser);
+		return;
+	}
+
+	parser->stats.frames++;
+	parser->handler(&parser->buf[2], payload_len, parser->user_data);
+	parser_reset(parser);
+}
+
+static void parser_put(struct mesh_uart_frame_parser *parser, uint8_t byte)
+{
+	if (parser->len >= sizeof(parser->buf))
+	{
+		parser_resync(parser);
+		return;
+	}
+	parser->buf[parser->len++] = byte;
+}
+
+void mesh_uart_frame_parser_init(struct mesh_uart_frame_parser *parser,
+				 mesh_uart_frame_handler_t handler, void *user_data)
+{
+	memset(parser, 0, sizeof(*parser));
+	parser->handler = handler;
+	parser->user_data = user_data;
+}
+
+/* Every byte but a delimiter either starts a COBS block with a non-zero code or is part of one. */
+bool mesh_uart_frame_parser_in_frame(const struct mesh_uart_frame_parser *parser)
+{
+	return parser->code != 0;
+}
+
+void mesh_uart_frame_parse(struct mesh_uart_frame_parser *parser, const uint8_t *data, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+	{
+		uint8_t byte = data[i];
+
+		if (byte == FRAME_DELIMITER)
+		{
+			parser_frame_end(parser);
+			continue;
+		}
+
+		if (parser->discard)
+		{
+			continue;
+		}
+
+		if (parser->code_left == 0)
+		{
+			/* Start of a COBS block. All but the first block, and blocks following a
+			 * full 254 byte block, stand in for a zero byte.
+			 */
+			if (parser->code != 0 && parser->code != 0xff)
+			{
+				parser_put(parser, 0x00);
+			}
+			parser->code = byte;
+			parser->code_left = byte - 1;
+			continue;
+		}
+
+		parser_put(parser, byte);
+		parser->code_left--;
+	}
+}
+
+int mesh_uart_frame_encode(const void *payload, size_t len, uint8_t *out, size_t out_size)
+{
+	if (len > MESH_UART_FRAME_PAYLOAD_MAX)
+	{
+		return -EMSGSIZE;
+	}
+
+	if (out_size < MESH_UART_FRAME_ENCODED_SIZE(len))
+	{
+		return -ENOMEM;
+	}
+
+	uint8_t header[2];
+	uint8_t trailer[2];
+	uint16_t crc;
+
+	sys_put_le16(len, header);
+	crc = crc16_ccitt(CRC_SEED, header, sizeof(header));
+	crc = crc16_ccitt(crc, payload, len);
+	sys_put_le16(crc, trailer);
+
+	const uint8_t *parts[] = {header, payload, trailer};
+	const size_t part_lens[] = {sizeof(header), len, sizeof(trailer)};
+
+	size_t pos = 0;
+	out[pos++] = FRAME_DELIMITER;
+
+	size_t code_pos = pos++;
+	uint8_t code = 1;
+
+	for (size_t p = 0; p < ARRAY_SIZE(parts); p++)
+	{
+		for (size_t i = 0; i < part_lens[p]; i++)
+		{
+			uint8_t byte = parts[p][i];
+
+			if (byte != 0x00)
+			{
+				out[pos++] = byte;
+				code++;
+			}
+
+			if (byte == 0x00 || code == 0xff)
+			{
+				out[code_pos] = code;
+				code_pos = pos++;
+				code = 1;
+			}
+		}
+	}
+	out[code_pos] = code;
+	out[pos++] = FRAME_DELIMITER;
+
+	return pos;
+}
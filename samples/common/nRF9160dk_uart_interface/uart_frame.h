@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+/* Framing of messages on the nRF9160 <-> nRF52840 UART link.
+ *
+ * A frame carries one message from messages.h:
+ *
+ *   | 16 bit length | message | CRC-16/CCITT of length and message |
+ *
+ * Both 16 bit fields are little endian. The frame is COBS encoded, so that it contains no zero
+ * bytes, and every frame is preceded and followed by a zero byte delimiter. A receiver that
+ * loses or corrupts a byte drops at most the frame it is in and is back in sync at the next
+ * delimiter.
+ */
+
+/** Largest message that fits in a frame. */
+#ifndef MESH_UART_FRAME_PAYLOAD_MAX
+#define MESH_UART_FRAME_PAYLOAD_MAX 256
+#endif
+
+/** Length and CRC fields around the message. */
+#define MESH_UART_FRAME_OVERHEAD 4
+
+/** Size of a decoded frame holding the largest message. */
+#define MESH_UART_FRAME_DECODED_MAX (MESH_UART_FRAME_PAYLOAD_MAX + MESH_UART_FRAME_OVERHEAD)
+
+/** Size of an encoded frame, including both delimiters, holding a message of _len bytes. */
+#define MESH_UART_FRAME_ENCODED_SIZE(_len) \
+	((_len) + MESH_UART_FRAME_OVERHEAD + ((_len) + MESH_UART_FRAME_OVERHEAD) / 254 + 1 + 2)
+
+/** Size of an encoded frame holding the largest message. */
+#define MESH_UART_FRAME_ENCODED_MAX MESH_UART_FRAME_ENCODED_SIZE(MESH_UART_FRAME_PAYLOAD_MAX)
+
+struct mesh_uart_frame_stats
+{
+	/* Frames received with a valid length and CRC. */
+	uint32_t frames;
+	/* Frames dropped because the CRC did not match. */
+	uint32_t crc_errors;
+	/* Times the parser dropped a partial or malformed frame and waited for the next delimiter. */
+	uint32_t resyncs;
+};
+
+/**
+ * @brief Called for every valid frame.
+ *
+ * @param payload Message carried by the frame. Only valid during the call.
+ * @param len Length of the message.
+ * @param user_data User data given to mesh_uart_frame_parser_init().
+ */
+typedef void (*mesh_uart_frame_handler_t)(const uint8_t *payload, size_t len, void *user_data);
+
+struct mesh_uart_frame_parser
+{
+	mesh_uart_frame_handler_t handler;
+	void *user_data;
+	/* Decoded bytes of the current frame. */
+	uint8_t buf[MESH_UART_FRAME_DECODED_MAX];
+	size_t len;
+	/* COBS block state. */
+	uint8_t code;
+	uint8_t code_left;
+	/* Set while skipping the rest of a bad frame. */
+	bool discard;
+	struct mesh_uart_frame_stats stats;
+};
+
+/**
+ * @brief Initialize a frame parser.
+ *
+ * @param parser Parser to initialize.
+ * @param handler Handler called for every valid frame.
+ * @param user_data Passed to the handler.
+ */
+void mesh_uart_frame_parser_init(struct mesh_uart_frame_parser *parser,
+				 mesh_uart_frame_handler_t handler, void *user_data);
+
+/**
+ * @brief Feed received bytes to a frame parser.
+ *
+ * The bytes may hold any part of one or more frames. The handler is called from this function
+ * for every complete and valid frame.
+ *
+ * @param parser Parser to feed.
+ * @param data Received bytes.
+ * @param len Number of received bytes.
+ */
+void mesh_uart_frame_parse(struct mesh_uart_frame_parser *parser, const uint8_t *data, size_t len);
+
+/**
+ * @brief Check if part of a frame has been received.
+ *
+ * @param parser Parser to check.
+ *
+ * @return true if bytes other than a delimiter were received since the last delimiter.
+ */
+bool mesh_uart_frame_parser_in_frame(const struct mesh_uart_frame_parser *parser);
+
+/**
+ * @brief Encode a message into a frame.
+ *
+ * @param payload Message to encode.
+ * @param len Length of the message.
+ * @param out Buffer for the frame.
+ * @param out_size Size of the buffer, see MESH_UART_FRAME_ENCODED_SIZE().
+ *
+ * @return Length of the frame, or a negative error code.
+ */
+int mesh_uart_frame_encode(const void *payload, size_t len, uint8_t *out, size_t out_size);
@@ -0,0 +1,375 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "uart_request.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(mesh_uart_request, CONFIG_MESH_UART_REQUEST_LOG_LEVEL);
+
+struct request_completion
+{
+	mesh_uart_response_cb_t cb;
+	void *user_data;
+	int err;
+};
+
+static struct mesh_uart_request_stats *stats_get(struct mesh_uart_requester *requester,
+						  const struct mesh_uart_request *request)
+{
+	enum mesh_uart_msg_type type = request->msg.header.type;
+
+	return type < MESH_UART_REQUEST_TYPE_COUNT ? &requester->stats[type] : NULL;
+}
+
+static bool is_final_response(enum mesh_uart_msg_type type)
+{
+	return type == STATUS || type == HELLO;
+}
+
+static uint8_t seq_next(struct mesh_uart_requester *requester)
+{
+	requester->next_seq++;
+	if (requester->next_seq == MESH_UART_SEQ_NONE)
+	{
+		requester->next_seq++;
+	}
+	return requester->next_seq;
+}
+
+/* Arm the timeout work to run no later than delay_ms from now. */
+static void timeout_schedule(struct mesh_uart_requester *requester, uint32_t delay_ms)
+{
+	if (k_work_delayable_is_pending(&requester->timeout_work) &&
+	    k_ticks_to_ms_ceil32(k_work_delayable_remaining_get(&requester->timeout_work)) <= delay_ms)
+	{
+		return;
+	}
+	k_work_reschedule(&requester->timeout_work, K_MSEC(delay_ms));
+}
+
+/* Mark the request in a window slot for transmission by window_transmit(). Must be called with
+ * the lock held.
+ */
+static void request_transmit(struct mesh_uart_requester *requester, struct mesh_uart_request *request)
+{
+	request->last_sent = k_uptime_get_32();
+	request->tx_due = true;
+	timeout_schedule(requester, request->timeout_ms);
+}
+
+/* Give the request a sequence number and send it. Must be called with the lock held. */
+static void request_start(struct mesh_uart_requester *requester, struct mesh_uart_request *request)
+{
+	request->msg.header.seq = seq_next(requester);
+	request->first_sent = k_uptime_get_32();
+	request->retries = 0;
+	request->in_use = true;
+	request_transmit(requester, request);
+}
+
+/* Move requests from the backlog into free window slots. Must be called with the lock held. */
+static void window_fill(struct mesh_uart_requester *requester)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(requester->window) && requester->backlog_count; i++)
+	{
+		if (requester->window[i].in_use || requester->window[i].tx_busy)
+		{
+			continue;
+		}
+
+		requester->window[i] = requester->backlog[requester->backlog_head];
+		requester->backlog_head = (requester->backlog_head + 1) % MESH_UART_REQUEST_BACKLOG;
+		requester->backlog_count--;
+		request_start(requester, &requester->window[i]);
+	}
+}
+
+/* Release a window slot. Must be called with the lock held. */
+static struct request_completion request_finish(struct mesh_uart_request *request, int err)
+{
+	struct request_completion completion = {
+		.cb = request->cb,
+		.user_data = request->user_data,
+		.err = err,
+	};
+
+	request->in_use = false;
+	return completion;
+}
+
+/* Queue the requests that are due for transmission. Framing the message and starting the UART is
+ * done with the lock released. A request that cannot be queued is left in the window and goes out
+ * as a retransmission.
+ */
+static void window_transmit(struct mesh_uart_requester *requester)
+{
+	for (size_t i = 0; i < ARRAY_SIZE(requester->window); i++)
+	{
+		struct mesh_uart_request *request = &requester->window[i];
+		k_spinlock_key_t key = k_spin_lock(&requester->lock);
+
+		if (!request->tx_due || request->tx_busy)
+		{
+			k_spin_unlock(&requester->lock, key);
+			continue;
+		}
+		request->tx_due = false;
+		request->tx_busy = true;
+		k_spin_unlock(&requester->lock, key);
+
+		uint8_t seq = request->msg.header.seq;
+		int err = mesh_uart_tx_queue_send(requester->tx_queue, &request->msg, request->len,
+						  NULL, NULL);
+
+		key = k_spin_lock(&requester->lock);
+		request->tx_busy = false;
+		if (!request->in_use)
+		{
+			/* Answered while it was being queued. The slot may now take the backlog. */
+			window_fill(requester);
+		}
+		if (request->tx_due)
+		{
+			/* Due again meanwhile. */
+			i--;
+		}
+		k_spin_unlock(&requester->lock, key);
+
+		if (err)
+		{
+			LOG_WRN("Request %d could not be queued: %d", seq, err);
+		}
+	}
+}
+
+static void timeout_work_fn(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+	struct mesh_uart_requester *requester = CONTAINER_OF(dwork, struct mesh_uart_requester, timeout_work);
+	struct request_completion completions[MESH_UART_REQUEST_WINDOW] = {0};
+	struct mesh_uart_msg_header timed_out[MESH_UART_REQUEST_WINDOW] = {0};
+	uint32_t next = UINT32_MAX;
+	k_spinlock_key_t key = k_spin_lock(&requester->lock);
+	uint32_t now = k_uptime_get_32();
+
+	for (size_t i = 0; i < ARRAY_SIZE(requester->window); i++)
+	{
+		struct mesh_uart_request *request = &requester->window[i];
+		struct mesh_uart_request_stats *stats = stats_get(requester, request);
+
+		if (!request->in_use)
+		{
+			continue;
+		}
+
+		uint32_t elapsed = now - request->last_sent;
+		if (elapsed < request->timeout_ms)
+		{
+			next = MIN(next, request->timeout_ms - elapsed);
+			continue;
+		}
+
+		if (request->retries < requester->max_retries)
+		{
+			request->retries++;
+			if (stats)
+			{
+				stats->retransmits++;
+			}
+			request_transmit(requester, request);
+			next = MIN(next, request->timeout_ms);
+			continue;
+		}
+
+		if (stats)
+		{
+			stats->timeouts++;
+		}
+		timed_out[i] = request->msg.header;
+		completions[i] = request_finish(request, -ETIMEDOUT);
+	}
+
+	window_fill(requester);
+	if (next != UINT32_MAX)
+	{
+		timeout_schedule(requester, next);
+	}
+	k_spin_unlock(&requester->lock, key);
+
+	window_transmit(requester);
+
+	for (size_t i = 0; i < ARRAY_SIZE(completions); i++)
+	{
+		if (completions[i].err)
+		{
+			LOG_WRN("Request %d of type %d timed out", timed_out[i].seq, timed_out[i].type);
+		}
+		if (completions[i].cb)
+		{
+			completions[i].cb(completions[i].err, NULL, completions[i].user_data);
+		}
+	}
+}
+
+void mesh_uart_requester_init(struct mesh_uart_requester *requester,
+			      struct mesh_uart_tx_queue *tx_queue, uint8_t max_retries)
+{
+	memset(requester, 0, sizeof(*requester));
+	requester->tx_queue = tx_queue;
+	requester->max_retries = max_retries;
+	k_work_init_delayable(&requester->timeout_work, timeout_work_fn);
+}
+
+int mesh_uart_request_send(struct mesh_uart_requester *requester, const void *msg, size_t len,
+			   uint32_t timeout_ms, mesh_uart_response_cb_t cb, void *user_data)
+{
+	struct mesh_uart_request *request = NULL;
+
+	if (len < sizeof(struct mesh_uart_msg_header) || len > sizeof(union mesh_uart_msg))
+	{
+		return -EMSGSIZE;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&requester->lock);
+
+	if (requester->backlog_count == 0)
+	{
+		for (size_t i = 0; i < ARRAY_SIZE(requester->window); i++)
+		{
+			if (!requester->window[i].in_use && !requester->window[i].tx_busy)
+			{
+				request = &requester->window[i];
+				break;
+			}
+		}
+	}
+
+	if (request == NULL)
+	{
+		if (requester->backlog_count == MESH_UART_REQUEST_BACKLOG)
+		{
+			k_spin_unlock(&requester->lock, key);
+			return -ENOMEM;
+		}
+		request = &requester->backlog[(requester->backlog_head + requester->backlog_count) %
+					      MESH_UART_REQUEST_BACKLOG];
+	}
+
+	memcpy(&request->msg, msg, len);
+	request->len = len;
+	request->timeout_ms = timeout_ms;
+	request->cb = cb;
+	request->user_data = user_data;
+
+	struct mesh_uart_request_stats *stats = stats_get(requester, request);
+	if (stats)
+	{
+		stats->requests++;
+	}
+
+	if (request >= requester->window && request < &requester->window[MESH_UART_REQUEST_WINDOW])
+	{
+		request_start(requester, request);
+	}
+	else
+	{
+		requester->backlog_count++;
+	}
+
+	k_spin_unlock(&requester->lock, key);
+
+	window_transmit(requester);
+	return 0;
+}
+
+bool mesh_uart_request_on_response(struct mesh_uart_requester *requester,
+				   const union mesh_uart_msg *msg)
+{
+	struct request_completion completion = {0};
+	bool matched = false;
+
+	if (msg->header.seq == MESH_UART_SEQ_NONE || !is_final_response(msg->header.type))
+	{
+		return false;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&requester->lock);
+
+	for (size_t i = 0; i < ARRAY_SIZE(requester->window); i++)
+	{
+		struct mesh_uart_request *request = &requester->window[i];
+
+		if (!request->in_use || request->msg.header.seq != msg->header.seq)
+		{
+			continue;
+		}
+
+		struct mesh_uart_request_stats *stats = stats_get(requester, request);
+		if (stats)
+		{
+			uint32_t latency = k_uptime_get_32() - request->first_sent;
+
+			stats->latency_min = stats->responses ? MIN(stats->latency_min, latency) : latency;
+			stats->latency_max = MAX(stats->latency_max, latency);
+			stats->latency_sum += latency;
+			stats->responses++;
+		}
+
+		completion = request_finish(request, 0);
+		matched = true;
+		window_fill(requester);
+		break;
+	}
+
+	k_spin_unlock(&requester->lock, key);
+
+	window_transmit(requester);
+
+	if (completion.cb)
+	{
+		completion.cb(0, msg, completion.user_data);
+	}
+	return matched;
+}
+
+bool mesh_uart_request_idle(struct mesh_uart_requester *requester)
+{
+	k_spinlock_key_t key = k_spin_lock(&requester->lock);
+	bool idle = requester->backlog_count == 0;
+
+	for (size_t i = 0; i < ARRAY_SIZE(requester->window) && idle; i++)
+	{
+		idle = !requester->window[i].in_use && !requester->window[i].tx_busy;
+	}
+	k_spin_unlock(&requester->lock, key);
+	return idle;
+}
+
+void mesh_uart_request_stats_log(struct mesh_uart_requester *requester)
+{
+	for (size_t type = 0; type < ARRAY_SIZE(requester->stats); type++)
+	{
+		struct mesh_uart_request_stats stats;
+		k_spinlock_key_t key = k_spin_lock(&requester->lock);
+
+		stats = requester->stats[type];
+		k_spin_unlock(&requester->lock, key);
+
+		if (stats.requests == 0)
+		{
+			continue;
+		}
+
+		LOG_INF("Type %zu: %u requests, %u responses, %u retransmits, %u timeouts, "
+			"latency min/avg/max %u/%u/%u ms",
+			type, stats.requests, stats.responses, stats.retransmits, stats.timeouts,
+			stats.latency_min, stats.responses ? stats.latency_sum / stats.responses : 0,
+			stats.latency_max);
+	}
+}
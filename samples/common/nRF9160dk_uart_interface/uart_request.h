@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+#include <zephyr/kernel.h>
+
+#include "messages.h"
+#include "uart_tx_queue.h"
+
+/* Request tracking for the nRF9160 <-> nRF52840 UART link.
+ *
+ * Every request gets a sequence number that the responder copies into its responses. Up to
+ * MESH_UART_REQUEST_WINDOW requests are in flight at once, later requests wait in a backlog
+ * until a slot frees up. A request that is not answered in time is sent again with the same
+ * sequence number, so the responder can tell it from a new request.
+ */
+
+/** Requests in flight at once. The responder must be able to queue this many. */
+#define MESH_UART_REQUEST_WINDOW 4
+
+/** Requests waiting for a slot in the window. */
+#ifndef MESH_UART_REQUEST_BACKLOG
+#define MESH_UART_REQUEST_BACKLOG 8
+#endif
+
+/** Message types that statistics are kept for, all of them. */
+#define MESH_UART_REQUEST_TYPE_COUNT MESH_UART_MSG_TYPE_COUNT
+
+/**
+ * @brief Called when a request has been answered or has timed out.
+ *
+ * Called from the context that received the response, or from the system work queue on
+ * timeout.
+ *
+ * @param err 0 if answered, -ETIMEDOUT if all retransmissions timed out, otherwise the error
+ *            from queuing the request.
+ * @param rsp Final response, or NULL if err is set.
+ * @param user_data User data given to mesh_uart_request_send().
+ */
+typedef void (*mesh_uart_response_cb_t)(int err, const union mesh_uart_msg *rsp, void *user_data);
+
+struct mesh_uart_request_stats
+{
+	uint32_t requests;
+	uint32_t responses;
+	uint32_t retransmits;
+	uint32_t timeouts;
+	/* Time from the first transmission to the final response, in milliseconds. */
+	uint32_t latency_min;
+	uint32_t latency_max;
+	uint32_t latency_sum;
+};
+
+struct mesh_uart_request
+{
+	union mesh_uart_msg msg;
+	size_t len;
+	uint32_t timeout_ms;
+	mesh_uart_response_cb_t cb;
+	void *user_data;
+	uint32_t first_sent;
+	uint32_t last_sent;
+	uint8_t retries;
+	bool in_use;
+	/* Set when the request is due to be queued for transmission, and while it is. The slot is
+	 * not reused while tx_busy is set.
+	 */
+	bool tx_due;
+	bool tx_busy;
+};
+
+struct mesh_uart_requester
+{
+	struct mesh_uart_tx_queue *tx_queue;
+	uint8_t max_retries;
+	struct k_spinlock lock;
+	struct mesh_uart_request window[MESH_UART_REQUEST_WINDOW];
+	struct mesh_uart_request backlog[MESH_UART_REQUEST_BACKLOG];
+	uint8_t backlog_head;
+	uint8_t backlog_count;
+	uint8_t next_seq;
+	struct k_work_delayable timeout_work;
+	struct mesh_uart_request_stats stats[MESH_UART_REQUEST_TYPE_COUNT];
+};
+
+/**
+ * @brief Initialize a requester.
+ *
+ * @param requester Requester to initialize.
+ * @param tx_queue Queue requests are sent on.
+ * @param max_retries Retransmissions before a request times out.
+ */
+void mesh_uart_requester_init(struct mesh_uart_requester *requester,
+			      struct mesh_uart_tx_queue *tx_queue, uint8_t max_retries);
+
+/**
+ * @brief Send a request. Does not block.
+ *
+ * The sequence number in the message header is filled in.
+ *
+ * @param requester Requester to send on.
+ * @param msg Request. Copied before the function returns.
+ * @param len Length of the request.
+ * @param timeout_ms Time to wait for the final response before retransmitting.
+ * @param cb Called with the final response. Optional.
+ * @param user_data Passed to the callback.
+ *
+ * @return 0 if the request was sent or put in the backlog, -ENOMEM if the backlog is full.
+ */
+int mesh_uart_request_send(struct mesh_uart_requester *requester, const void *msg, size_t len,
+			   uint32_t timeout_ms, mesh_uart_response_cb_t cb, void *user_data);
+
+/**
+ * @brief Match a received message against the requests in flight.
+ *
+ * @param requester Requester the message was received for.
+ * @param msg Received message.
+ *
+ * @return true if the message ended a request in flight.
+ */
+bool mesh_uart_request_on_response(struct mesh_uart_requester *requester,
+				   const union mesh_uart_msg *msg);
+
+/**
+ * @brief Check if the requester has nothing in flight and nothing in the backlog.
+ *
+ * @param requester Requester to check.
+ *
+ * @return true if every request has been completed.
+ */
+bool mesh_uart_request_idle(struct mesh_uart_requester *requester);
+
+/**
+ * @brief Log request statistics per message type.
+ *
+ * @param requester Requester to log statistics of.
+ */
+void mesh_uart_request_stats_log(struct mesh_uart_requester *requester);
@@ -0,0 +1,379 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <string.h>
+
+#include "uart_rx.h"
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(mesh_uart_rx, CONFIG_MESH_UART_RX_LOG_LEVEL);
+
+static void adapt_timer_fn(struct k_timer *timer);
+
+void mesh_uart_rx_init(struct mesh_uart_rx *rx, struct mesh_uart_frame_parser *parser,
+		       uint8_t *buf, size_t size, bool parse_in_isr)
+{
+	rx->parser = parser;
+	rx->parse_in_isr = parse_in_isr;
+	memset(&rx->faults, 0, sizeof(rx->faults));
+	memset(&rx->stats, 0, sizeof(rx->stats));
+	rx->fault_rand = 0x2545f491;
+	atomic_set(&rx->frame_active, false);
+	ring_buf_init(&rx->ring, size, buf);
+	k_sem_init(&rx->data_sem, 0, 1);
+	k_timer_init(&rx->adapt_timer, adapt_timer_fn, NULL);
+}
+
+void mesh_uart_rx_on_data(struct mesh_uart_rx *rx, const uint8_t *data, size_t len)
+{
+	uint32_t start = k_cycle_get_32();
+
+	if (rx->parse_in_isr)
+	{
+		mesh_uart_frame_parse(rx->parser, data, len);
+		atomic_set(&rx->frame_active, mesh_uart_frame_parser_in_frame(rx->parser));
+	}
+	else
+	{
+		uint32_t written = ring_buf_put(&rx->ring, data, len);
+
+		/* Lost bytes cost the frames they belong to, the parser resynchronizes. */
+		rx->stats.dropped += len - written;
+		rx->stats.ring_peak = MAX(rx->stats.ring_peak, ring_buf_size_get(&rx->ring));
+		k_sem_give(&rx->data_sem);
+	}
+
+	uint32_t cycles = k_cycle_get_32() - start;
+	rx->stats.isr_calls++;
+	rx->stats.isr_cycles_total += cycles;
+	rx->stats.isr_cycles_max = MAX(rx->stats.isr_cycles_max, cycles);
+}
+
+/* Bytes take ten bit times with start and stop bits. */
+void mesh_uart_rx_baudrate_set(struct mesh_uart_rx *rx, uint32_t baudrate)
+{
+	rx->byte_ns = baudrate ? 10 * NSEC_PER_SEC / baudrate : 0;
+}
+
+int mesh_uart_rx_enable(struct mesh_uart_rx *rx, const struct device *dev,
+			const struct mesh_uart_rx_buf_config *config)
+{
+	struct uart_config uart_cfg;
+	void *buf;
+	int err;
+
+	rx->dev = dev;
+	rx->buf_config = *config;
+	rx->stats.timeout_us = config->timeout_us;
+	rx->last_rdy_cycles = 0;
+	rx->adapt_count = 0;
+	rx->adapt_near = 0;
+	rx->adapt_pending_us = 0;
+
+	err = uart_config_get(dev, &uart_cfg);
+	mesh_uart_rx_baudrate_set(rx, err ? 0 : uart_cfg.baudrate);
+
+	err = k_mem_slab_alloc(config->slab, &buf, K_NO_WAIT);
+	if (err)
+	{
+		LOG_ERR("Failed to allocate RX buffer, error: %d", err);
+		return err;
+	}
+	rx->stats.bufs_used = 1;
+	rx->stats.bufs_peak = MAX(rx->stats.bufs_peak, 1);
+
+	err = uart_rx_enable(dev, buf, config->buf_size, rx->stats.timeout_us);
+	if (err)
+	{
+		LOG_ERR("Failed to enable UART RX, error: %d", err);
+		k_mem_slab_free(config->slab, &buf);
+		rx->stats.bufs_used = 0;
+	}
+	return err;
+}
+
+static void fragment_record(struct mesh_uart_rx *rx, size_t len)
+{
+	uint8_t class = 0;
+
+	while (class < MESH_UART_RX_FRAGMENT_CLASSES - 1 && len > (8u << class))
+	{
+		class++;
+	}
+	rx->stats.fragments++;
+	rx->stats.fragment_classes[class]++;
+	rx->stats.fragment_max = MAX(rx->stats.fragment_max, len);
+}
+
+/* Every fragment ends in a gap of at least the timeout. Gaps close to it mean bursts are split. */
+static void timeout_adapt(struct mesh_uart_rx *rx, size_t len)
+{
+	const struct mesh_uart_rx_buf_config *config = &rx->buf_config;
+	uint32_t now = k_cycle_get_32();
+	uint32_t timeout_us = rx->stats.timeout_us;
+
+	if (config->timeout_min_us >= config->timeout_us || !rx->byte_ns)
+	{
+		return;
+	}
+
+	if (rx->last_rdy_cycles)
+	{
+		uint64_t elapsed_ns = k_cyc_to_ns_floor64(now - rx->last_rdy_cycles);
+		uint64_t busy_ns = (uint64_t)len * rx->byte_ns;
+		uint64_t gap_us = elapsed_ns > busy_ns ? (elapsed_ns - busy_ns) / NSEC_PER_USEC : 0;
+
+		if (gap_us < 2 * timeout_us)
+		{
+			rx->adapt_near++;
+		}
+		rx->adapt_count++;
+	}
+	rx->last_rdy_cycles = now;
+
+	if (rx->adapt_count < MESH_UART_RX_ADAPT_WINDOW)
+	{
+		return;
+	}
+
+	if (rx->adapt_near > MESH_UART_RX_ADAPT_WINDOW / 4)
+	{
+		timeout_us = MIN(2 * timeout_us, config->timeout_us);
+	}
+	else if (rx->adapt_near == 0)
+	{
+		/* Never below a few bytes, or every byte would be a fragment of its own. */
+		uint32_t floor_us = MAX(config->timeout_min_us, 4 * rx->byte_ns / NSEC_PER_USEC);
+
+		timeout_us = MAX(timeout_us / 2, floor_us);
+	}
+	rx->adapt_count = 0;
+	rx->adapt_near = 0;
+
+	/* Applied by adapt_timer_fn() once the line is quiet. */
+	rx->adapt_pending_us = timeout_us != rx->stats.timeout_us ? timeout_us : 0;
+}
+
+/* Nothing was received for MESH_UART_RX_ADAPT_IDLE_MS. Restart reception with the new timeout
+ * unless a frame is still partly received.
+ */
+static void adapt_timer_fn(struct k_timer *timer)
+{
+	struct mesh_uart_rx *rx = CONTAINER_OF(timer, struct mesh_uart_rx, adapt_timer);
+
+	if (!rx->adapt_pending_us)
+	{
+		return;
+	}
+	if (!ring_buf_is_empty(&rx->ring) || atomic_get(&rx->frame_active))
+	{
+		k_timer_start(&rx->adapt_timer, K_MSEC(MESH_UART_RX_ADAPT_IDLE_MS), K_NO_WAIT);
+		return;
+	}
+
+	rx->stats.timeout_us = rx->adapt_pending_us;
+	rx->stats.timeout_changes++;
+	rx->adapt_pending_us = 0;
+	/* Enabled again with the new timeout on UART_RX_DISABLED. */
+	uart_rx_disable(rx->dev);
+}
+
+static void rx_restart(struct mesh_uart_rx *rx)
+{
+	void *buf;
+	int err;
+
+	err = k_mem_slab_alloc(rx->buf_config.slab, &buf, K_NO_WAIT);
+	if (err)
+	{
+		LOG_ERR("No RX buffer to restart UART RX");
+		rx->stats.starved++;
+		return;
+	}
+	rx->stats.bufs_used++;
+	rx->stats.bufs_peak = MAX(rx->stats.bufs_peak, rx->stats.bufs_used);
+
+	err = uart_rx_enable(rx->dev, buf, rx->buf_config.buf_size, rx->stats.timeout_us);
+	if (err)
+	{
+		LOG_ERR("Failed to restart UART RX, error: %d", err);
+		k_mem_slab_free(rx->buf_config.slab, &buf);
+		rx->stats.bufs_used--;
+		return;
+	}
+	rx->stats.restarts++;
+	rx->last_rdy_cycles = 0;
+}
+
+void mesh_uart_rx_on_event(struct mesh_uart_rx *rx, const struct uart_event *evt)
+{
+	switch (evt->type)
+	{
+	case UART_RX_RDY:
+		mesh_uart_rx_on_data(rx, &evt->data.rx.buf[evt->data.rx.offset], evt->data.rx.len);
+		fragment_record(rx, evt->data.rx.len);
+		timeout_adapt(rx, evt->data.rx.len);
+		if (rx->adapt_pending_us)
+		{
+			k_timer_start(&rx->adapt_timer, K_MSEC(MESH_UART_RX_ADAPT_IDLE_MS), K_NO_WAIT);
+		}
+		break;
+
+	case UART_RX_BUF_REQUEST:
+	{
+		void *buf;
+		int err = k_mem_slab_alloc(rx->buf_config.slab, &buf, K_NO_WAIT);
+
+		if (err)
+		{
+			/* Reception stops when the current buffer is full, and is restarted. */
+			rx->stats.starved++;
+			break;
+		}
+		err = uart_rx_buf_rsp(rx->dev, buf, rx->buf_config.buf_size);
+		if (err)
+		{
+			k_mem_slab_free(rx->buf_config.slab, &buf);
+			break;
+		}
+		rx->stats.bufs_used++;
+		rx->stats.bufs_peak = MAX(rx->stats.bufs_peak, rx->stats.bufs_used);
+		break;
+	}
+
+	case UART_RX_BUF_RELEASED:
+	{
+		void *buf = evt->data.rx_buf.buf;
+
+		k_mem_slab_free(rx->buf_config.slab, &buf);
+		rx->stats.bufs_used--;
+		break;
+	}
+
+	case UART_RX_DISABLED:
+		LOG_DBG("UART_RX_DISABLED");
+		rx_restart(rx);
+		break;
+
+	case UART_RX_STOPPED:
+		LOG_WRN("UART_RX_STOPPED: Reason: %d", evt->data.rx_stop.reason);
+		break;
+
+	default:
+		break;
+	}
+}
+
+void mesh_uart_rx_faults_set(struct mesh_uart_rx *rx, const struct mesh_uart_rx_faults *faults)
+{
+	rx->faults = *faults;
+}
+
+/* Deterministic, so a run can be repeated with the same faults. */
+static uint32_t fault_rand_next(struct mesh_uart_rx *rx)
+{
+	uint32_t x = rx->fault_rand;
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	rx->fault_rand = x;
+	return x;
+}
+
+/* Returns true with the given probability in parts per million. */
+static bool fault_hit(struct mesh_uart_rx *rx, uint32_t ppm)
+{
+	return ppm && fault_rand_next(rx) % 1000000 < ppm;
+}
+
+/* Drop and corrupt bytes in place. Returns the number of bytes left. */
+static uint32_t faults_inject(struct mesh_uart_rx *rx, uint8_t *data, uint32_t len)
+{
+	uint32_t kept = 0;
+
+	for (uint32_t i = 0; i < len; i++)
+	{
+		if (fault_hit(rx, rx->faults.drop_ppm))
+		{
+			rx->stats.injected_drops++;
+			continue;
+		}
+		data[kept] = data[i];
+		if (fault_hit(rx, rx->faults.corrupt_ppm))
+		{
+			rx->stats.injected_corruptions++;
+			data[kept] ^= BIT(fault_rand_next(rx) % 8);
+		}
+		kept++;
+	}
+	return kept;
+}
+
+void mesh_uart_rx_process(struct mesh_uart_rx *rx)
+{
+	uint8_t *data;
+	uint32_t len;
+
+	while ((len = ring_buf_get_claim(&rx->ring, &data, UINT32_MAX)) > 0)
+	{
+		uint32_t parse_len = len;
+
+		if (rx->faults.drop_ppm || rx->faults.corrupt_ppm)
+		{
+			parse_len = faults_inject(rx, data, len);
+		}
+		mesh_uart_frame_parse(rx->parser, data, parse_len);
+		/* Before the bytes leave the ring, so that an empty ring never comes with a stale
+		 * flag.
+		 */
+		atomic_set(&rx->frame_active, mesh_uart_frame_parser_in_frame(rx->parser));
+		ring_buf_get_finish(&rx->ring, len);
+	}
+}
+
+void mesh_uart_rx_thread_run(struct mesh_uart_rx *rx)
+{
+	while (true)
+	{
+		k_sem_take(&rx->data_sem, K_FOREVER);
+
+		if (rx->faults.latency_ms)
+		{
+			k_sleep(K_MSEC(rx->faults.latency_ms));
+		}
+
+		mesh_uart_rx_process(rx);
+	}
+}
+
+void mesh_uart_rx_stats_log(struct mesh_uart_rx *rx)
+{
+	struct mesh_uart_rx_stats stats = rx->stats;
+	uint32_t avg_ns = stats.isr_calls ?
+		k_cyc_to_ns_floor64(stats.isr_cycles_total / stats.isr_calls) : 0;
+
+	LOG_INF("UART rx %s: %u events, ISR time avg %u ns, max %u ns, ring peak %u B, %u B dropped",
+		rx->parse_in_isr ? "parsed in ISR" : "ring buffered",
+		stats.isr_calls, avg_ns, (uint32_t)k_cyc_to_ns_floor64(stats.isr_cycles_max),
+		stats.ring_peak, stats.dropped);
+	LOG_INF("UART rx buffers: %u fragments, max %u B, peak %u of %u buffers in use, "
+		"%u starved, %u restarts",
+		stats.fragments, stats.fragment_max, stats.bufs_peak,
+		rx->buf_config.slab ? k_mem_slab_num_used_get(rx->buf_config.slab) +
+					      k_mem_slab_num_free_get(rx->buf_config.slab) : 0,
+		stats.starved,
+		stats.restarts);
+	LOG_INF("UART rx fragments <=8: %u, <=16: %u, <=32: %u, <=64: %u, <=128: %u, >128: %u",
+		stats.fragment_classes[0], stats.fragment_classes[1], stats.fragment_classes[2],
+		stats.fragment_classes[3], stats.fragment_classes[4], stats.fragment_classes[5]);
+	LOG_INF("UART rx timeout %u us, %u changes", stats.timeout_us, stats.timeout_changes);
+	if (stats.injected_drops || stats.injected_corruptions)
+	{
+		LOG_INF("UART rx faults injected: %u bytes dropped, %u bytes corrupted",
+			stats.injected_drops, stats.injected_corruptions);
+	}
+}
@@ -0,0 +1,205 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+#include <zephyr/sys/ring_buffer.h>
+
+#include "uart_frame.h"
+
+/* Receive path for the nRF9160 <-> nRF52840 UART link.
+ *
+ * The UART interrupt only appends the received bytes to a ring buffer and wakes the parser
+ * thread, which runs the frame parser and with it the frame handler. The interrupt is the single
+ * producer and the parser thread the single consumer, so the ring needs no lock.
+ *
+ * The time spent handling UART_RX_RDY in the interrupt is measured. For comparison the frames can
+ * still be parsed in the interrupt, see mesh_uart_rx_init().
+ *
+ * The receive path also owns the UART receive buffers, which it takes from a memory slab, and
+ * keeps statistics of their use. If the UART ever runs out of buffers and disables reception,
+ * reception is enabled again.
+ *
+ * The inactivity timeout after which the UART hands over a partly filled buffer can adapt to the
+ * traffic. Only gaps longer than the timeout are seen, as each of them ends a UART_RX_RDY
+ * fragment. When many gaps are only a little longer than the timeout, bursts are being split
+ * into several fragments and the timeout is doubled. When none are, the timeout is halved to
+ * hand over frames sooner. A change takes effect when reception is restarted, which loses the
+ * bytes that arrive while it is. It is only applied once the line has been quiet for
+ * MESH_UART_RX_ADAPT_IDLE_MS and no frame is partly received, as frames without a sequence
+ * number are not retransmitted. The timer that applies it does not read the parser, which is
+ * only touched where the frames are parsed, but a flag set there after every parse.
+ */
+
+/** Fragments between two adjustments of an adaptive timeout. */
+#define MESH_UART_RX_ADAPT_WINDOW 32
+
+/** Quiet time on the line before a new timeout is applied. */
+#define MESH_UART_RX_ADAPT_IDLE_MS 10
+
+/** Size classes of UART_RX_RDY fragments: up to 8, 16, 32, 64, 128 bytes, and longer. */
+#define MESH_UART_RX_FRAGMENT_CLASSES 6
+
+struct mesh_uart_rx_buf_config
+{
+	/* Receive buffers, every block is one buffer. */
+	struct k_mem_slab *slab;
+	size_t buf_size;
+	/* Inactivity timeout. The upper bound if the timeout adapts. */
+	uint32_t timeout_us;
+	/* Lower bound of an adaptive timeout. Equal to timeout_us for a fixed timeout. */
+	uint32_t timeout_min_us;
+};
+
+/* Faults injected into the received bytes before they are parsed, to see how the link copes.
+ * Rates are per million bytes.
+ */
+struct mesh_uart_rx_faults
+{
+	uint32_t drop_ppm;
+	uint32_t corrupt_ppm;
+	/* Delay before received bytes are parsed. */
+	uint32_t latency_ms;
+};
+
+struct mesh_uart_rx_stats
+{
+	/* Bytes dropped because the ring was full. */
+	uint32_t dropped;
+	/* Highest number of bytes waiting in the ring. */
+	uint32_t ring_peak;
+	/* UART_RX_RDY events handled in the interrupt, and the time spent on them. */
+	uint32_t isr_calls;
+	uint32_t isr_cycles_max;
+	uint64_t isr_cycles_total;
+	/* Injected faults. */
+	uint32_t injected_drops;
+	uint32_t injected_corruptions;
+	/* UART_RX_RDY fragments, per size class, and the longest one. */
+	uint32_t fragments;
+	uint32_t fragment_classes[MESH_UART_RX_FRAGMENT_CLASSES];
+	uint32_t fragment_max;
+	/* Receive buffers in use now and at most. */
+	uint32_t bufs_used;
+	uint32_t bufs_peak;
+	/* Buffer requests that could not be met, and restarts of reception. */
+	uint32_t starved;
+	uint32_t restarts;
+	/* Inactivity timeout in use, and the number of times it changed. */
+	uint32_t timeout_us;
+	uint32_t timeout_changes;
+};
+
+struct mesh_uart_rx
+{
+	struct mesh_uart_frame_parser *parser;
+	struct ring_buf ring;
+	struct k_sem data_sem;
+	bool parse_in_isr;
+	/* Set while a frame is partly received. Written where the frames are parsed, read by the
+	 * adapt timer.
+	 */
+	atomic_t frame_active;
+	struct mesh_uart_rx_faults faults;
+	uint32_t fault_rand;
+	const struct device *dev;
+	struct mesh_uart_rx_buf_config buf_config;
+	uint32_t byte_ns;
+	uint32_t last_rdy_cycles;
+	uint8_t adapt_count;
+	uint8_t adapt_near;
+	/* Timeout waiting for the line to be quiet, 0 if none. */
+	uint32_t adapt_pending_us;
+	struct k_timer adapt_timer;
+	struct mesh_uart_rx_stats stats;
+};
+
+/**
+ * @brief Initialize a receive path.
+ *
+ * @param rx Receive path to initialize.
+ * @param parser Frame parser fed by the receive path.
+ * @param buf Storage for the ring buffer.
+ * @param size Size of the storage.
+ * @param parse_in_isr Parse frames in the interrupt instead of the parser thread.
+ */
+void mesh_uart_rx_init(struct mesh_uart_rx *rx, struct mesh_uart_frame_parser *parser,
+		       uint8_t *buf, size_t size, bool parse_in_isr);
+
+/**
+ * @brief Start receiving.
+ *
+ * @param rx Receive path.
+ * @param dev UART to receive on. Its callback must pass receive events to
+ *            mesh_uart_rx_on_event().
+ * @param config Receive buffers and inactivity timeout.
+ *
+ * @return 0 on success, otherwise a negative error code.
+ */
+int mesh_uart_rx_enable(struct mesh_uart_rx *rx, const struct device *dev,
+			const struct mesh_uart_rx_buf_config *config);
+
+/**
+ * @brief Handle a receive event. Called from the UART callback.
+ *
+ * Handles UART_RX_RDY, UART_RX_BUF_REQUEST, UART_RX_BUF_RELEASED, UART_RX_DISABLED and
+ * UART_RX_STOPPED.
+ *
+ * @param rx Receive path.
+ * @param evt UART event.
+ */
+void mesh_uart_rx_on_event(struct mesh_uart_rx *rx, const struct uart_event *evt);
+
+/**
+ * @brief Tell the receive path that the baud rate changed.
+ *
+ * @param rx Receive path.
+ * @param baudrate New baud rate.
+ */
+void mesh_uart_rx_baudrate_set(struct mesh_uart_rx *rx, uint32_t baudrate);
+
+/**
+ * @brief Hand over received bytes. Called from the UART callback on UART_RX_RDY.
+ *
+ * @param rx Receive path.
+ * @param data Received bytes.
+ * @param len Number of received bytes.
+ */
+void mesh_uart_rx_on_data(struct mesh_uart_rx *rx, const uint8_t *data, size_t len);
+
+/**
+ * @brief Set the faults to inject. Only applies to bytes parsed in the parser thread.
+ *
+ * @param rx Receive path.
+ * @param faults Faults to inject, all zero to stop injecting.
+ */
+void mesh_uart_rx_faults_set(struct mesh_uart_rx *rx, const struct mesh_uart_rx_faults *faults);
+
+/**
+ * @brief Parse the received bytes waiting in the ring, with the faults injected.
+ *
+ * Called by the parser thread. A host that simulates the link calls it instead of running the
+ * thread, after the latency fault.
+ *
+ * @param rx Receive path.
+ */
+void mesh_uart_rx_process(struct mesh_uart_rx *rx);
+
+/**
+ * @brief Parse received bytes until the end of time. Run by the parser thread.
+ *
+ * @param rx Receive path.
+ */
+void mesh_uart_rx_thread_run(struct mesh_uart_rx *rx);
+
+/**
+ * @brief Log receive path statistics.
+ *
+ * @param rx Receive path.
+ */
+void mesh_uart_rx_stats_log(struct mesh_uart_rx *rx);
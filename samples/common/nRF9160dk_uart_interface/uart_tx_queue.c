@@ -0,0 +1,236 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#include <errno.h>
+#include <string.h>
+
+#include "uart_codec.h"
+#include "uart_tx_queue.h"
+
+#define STATS_WINDOW_MS 1000
+
+struct tx_completion
+{
+	mesh_uart_tx_done_cb_t cb;
+	void *user_data;
+	int err;
+};
+
+static void stats_update(struct mesh_uart_tx_queue *queue, size_t len, int err)
+{
+	if (err)
+	{
+		queue->stats.failed++;
+		return;
+	}
+
+	queue->stats.frames++;
+	queue->stats.bytes += len;
+	queue->window_bytes += len;
+
+	uint32_t elapsed = k_uptime_get_32() - queue->window_start;
+	if (elapsed >= STATS_WINDOW_MS)
+	{
+		queue->stats.bytes_per_sec = (uint64_t)queue->window_bytes * MSEC_PER_SEC / elapsed;
+		queue->window_bytes = 0;
+		queue->window_start += elapsed;
+	}
+}
+
+/* Release the buffer at head. Must be called with the lock held. */
+static void head_release(struct mesh_uart_tx_queue *queue)
+{
+	queue->bufs[queue->head].ready = false;
+	queue->head = (queue->head + 1) % MESH_UART_TX_QUEUE_LEN;
+	queue->count--;
+	queue->stats.depth = queue->count;
+	queue->busy = false;
+}
+
+/* Release the frame at head. Must be called with the lock held. */
+static struct tx_completion head_complete(struct mesh_uart_tx_queue *queue, int err)
+{
+	struct mesh_uart_tx_buf *buf = &queue->bufs[queue->head];
+	struct tx_completion completion = {
+		.cb = buf->cb,
+		.user_data = buf->user_data,
+		.err = err,
+	};
+
+	stats_update(queue, buf->len, err);
+	head_release(queue);
+
+	return completion;
+}
+
+/* Claim the frame at head for the driver, if it is framed and the driver is free. Buffers that
+ * could not be framed are released on the way. Must be called with the lock held.
+ */
+static struct mesh_uart_tx_buf *head_claim(struct mesh_uart_tx_queue *queue)
+{
+	while (!queue->busy && queue->count > 0 && queue->bufs[queue->head].ready)
+	{
+		struct mesh_uart_tx_buf *buf = &queue->bufs[queue->head];
+
+		if (buf->len == 0)
+		{
+			head_release(queue);
+			continue;
+		}
+
+		queue->busy = true;
+		queue->starting = true;
+		return buf;
+	}
+	return NULL;
+}
+
+static void completion_report(const struct tx_completion *completion)
+{
+	if (completion->cb)
+	{
+		completion->cb(completion->err, completion->user_data);
+	}
+}
+
+/* Start the next frame. Frames that fail to start are reported and skipped. */
+static void queue_kick(struct mesh_uart_tx_queue *queue)
+{
+	while (true)
+	{
+		k_spinlock_key_t key = k_spin_lock(&queue->lock);
+		struct mesh_uart_tx_buf *buf = head_claim(queue);
+		k_spin_unlock(&queue->lock, key);
+
+		if (buf == NULL)
+		{
+			return;
+		}
+
+		int err = uart_tx(queue->dev, buf->data, buf->len, SYS_FOREVER_US);
+		struct tx_completion completion = {0};
+
+		key = k_spin_lock(&queue->lock);
+		queue->starting = false;
+		if (err)
+		{
+			completion = head_complete(queue, err);
+		}
+		k_spin_unlock(&queue->lock, key);
+
+		if (!err)
+		{
+			return;
+		}
+		completion_report(&completion);
+	}
+}
+
+void mesh_uart_tx_queue_init(struct mesh_uart_tx_queue *queue, const struct device *dev)
+{
+	memset(queue, 0, sizeof(*queue));
+	queue->dev = dev;
+	queue->version = MESH_UART_PROTOCOL_VERSION_MIN;
+	queue->window_start = k_uptime_get_32();
+}
+
+void mesh_uart_tx_queue_version_set(struct mesh_uart_tx_queue *queue, uint8_t version)
+{
+	queue->version = version;
+}
+
+int mesh_uart_tx_queue_send(struct mesh_uart_tx_queue *queue, const void *msg, size_t len,
+			    mesh_uart_tx_done_cb_t cb, void *user_data)
+{
+	uint8_t payload[sizeof(union mesh_uart_msg)];
+	int payload_len = mesh_uart_msg_encode(msg, len, queue->version, payload, sizeof(payload));
+	if (payload_len < 0)
+	{
+		return payload_len;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&queue->lock);
+
+	if (queue->count == MESH_UART_TX_QUEUE_LEN)
+	{
+		queue->stats.dropped++;
+		k_spin_unlock(&queue->lock, key);
+		return -ENOMEM;
+	}
+
+	struct mesh_uart_tx_buf *buf = &queue->bufs[(queue->head + queue->count) % MESH_UART_TX_QUEUE_LEN];
+
+	queue->count++;
+	queue->stats.depth = queue->count;
+	queue->stats.depth_max = MAX(queue->stats.depth_max, queue->count);
+	k_spin_unlock(&queue->lock, key);
+
+	/* The buffer is reserved, and is not sent or reused until it is marked ready. */
+	int frame_len = mesh_uart_frame_encode(payload, payload_len, buf->data, sizeof(buf->data));
+
+	buf->len = MAX(frame_len, 0);
+	buf->cb = cb;
+	buf->user_data = user_data;
+
+	key = k_spin_lock(&queue->lock);
+	buf->ready = true;
+	k_spin_unlock(&queue->lock, key);
+
+	queue_kick(queue);
+	return MIN(frame_len, 0);
+}
+
+void mesh_uart_tx_queue_on_event(struct mesh_uart_tx_queue *queue, const struct uart_event *evt)
+{
+	struct tx_completion completion;
+	k_spinlock_key_t key = k_spin_lock(&queue->lock);
+
+	if (!queue->busy)
+	{
+		k_spin_unlock(&queue->lock, key);
+		return;
+	}
+
+	completion = head_complete(queue, evt->type == UART_TX_DONE ? 0 : -ECANCELED);
+	k_spin_unlock(&queue->lock, key);
+
+	completion_report(&completion);
+	queue_kick(queue);
+}
+
+void mesh_uart_tx_queue_abort(struct mesh_uart_tx_queue *queue)
+{
+	int err = uart_tx_abort(queue->dev);
+
+	if (err != -EFAULT)
+	{
+		/* The driver reports UART_TX_ABORTED, which completes the frame. */
+		return;
+	}
+
+	/* No transfer in the driver. If the queue still has one in flight its end was lost, unless
+	 * it is only being handed to the driver.
+	 */
+	struct tx_completion completion = {0};
+	k_spinlock_key_t key = k_spin_lock(&queue->lock);
+
+	if (queue->busy && !queue->starting)
+	{
+		completion = head_complete(queue, -ECANCELED);
+	}
+	k_spin_unlock(&queue->lock, key);
+
+	completion_report(&completion);
+	queue_kick(queue);
+}
+
+void mesh_uart_tx_queue_stats_get(struct mesh_uart_tx_queue *queue, struct mesh_uart_tx_stats *stats)
+{
+	k_spinlock_key_t key = k_spin_lock(&queue->lock);
+
+	*stats = queue->stats;
+	k_spin_unlock(&queue->lock, key);
+}
@@ -0,0 +1,149 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+#pragma once
+#include <zephyr/kernel.h>
+#include <zephyr/device.h>
+#include <zephyr/drivers/uart.h>
+
+#include "messages.h"
+#include "uart_frame.h"
+
+/* Transmit queue for the nRF9160 <-> nRF52840 UART link.
+ *
+ * Messages are encoded and framed into buffers owned by the queue as soon as they are sent, so the caller
+ * may reuse its message right away. The buffers form a ring that is drained by chaining the
+ * next uart_tx() from the UART_TX_DONE event of the previous one. Sending never blocks.
+ *
+ * The lock only guards the ring indices. A sender reserves a buffer, frames the message into it
+ * with the lock released, and then marks it ready. uart_tx() is called with the lock released
+ * too, so that neither adds to the time interrupts are off.
+ */
+
+/** Number of frames that can be waiting for, or in, transmission. */
+#ifndef MESH_UART_TX_QUEUE_LEN
+#define MESH_UART_TX_QUEUE_LEN 8
+#endif
+
+/** Size of a queued frame buffer, large enough for any message in messages.h. */
+#define MESH_UART_TX_FRAME_SIZE MESH_UART_FRAME_ENCODED_SIZE(sizeof(union mesh_uart_msg))
+
+/**
+ * @brief Called when a frame has left the UART, or failed to.
+ *
+ * Called from the UART interrupt, or from the sender if the transfer could not be started.
+ *
+ * @param err 0 if the frame was sent, -ECANCELED if it was aborted, otherwise an error from
+ *            uart_tx().
+ * @param user_data User data given to mesh_uart_tx_queue_send().
+ */
+typedef void (*mesh_uart_tx_done_cb_t)(int err, void *user_data);
+
+struct mesh_uart_tx_stats
+{
+	/* Frames and bytes sent. */
+	uint32_t frames;
+	uint32_t bytes;
+	/* Frames refused because the queue was full. */
+	uint32_t dropped;
+	/* Frames aborted or failed in the driver. */
+	uint32_t failed;
+	/* Current and highest number of queued frames. */
+	uint8_t depth;
+	uint8_t depth_max;
+	/* Throughput over the last completed measurement window. */
+	uint32_t bytes_per_sec;
+};
+
+struct mesh_uart_tx_buf
+{
+	uint8_t data[MESH_UART_TX_FRAME_SIZE];
+	/* 0 if the message could not be framed, the buffer is then skipped. */
+	size_t len;
+	mesh_uart_tx_done_cb_t cb;
+	void *user_data;
+	/* Set once the frame is in the buffer. */
+	bool ready;
+};
+
+struct mesh_uart_tx_queue
+{
+	const struct device *dev;
+	struct k_spinlock lock;
+	struct mesh_uart_tx_buf bufs[MESH_UART_TX_QUEUE_LEN];
+	uint8_t head;
+	uint8_t count;
+	/* Set while the frame at head is owned by the driver. */
+	bool busy;
+	/* Set while the frame at head is being handed to the driver. */
+	bool starting;
+	struct mesh_uart_tx_stats stats;
+	/* Protocol version messages are encoded for. */
+	uint8_t version;
+	uint32_t window_start;
+	uint32_t window_bytes;
+};
+
+/**
+ * @brief Initialize a transmit queue.
+ *
+ * @param queue Queue to initialize.
+ * @param dev UART the queue transmits on.
+ */
+void mesh_uart_tx_queue_init(struct mesh_uart_tx_queue *queue, const struct device *dev);
+
+/**
+ * @brief Set the protocol version messages are encoded for.
+ *
+ * The queue starts out at MESH_UART_PROTOCOL_VERSION_MIN.
+ *
+ * @param queue Queue to set the version of.
+ * @param version Protocol version agreed with the peer.
+ */
+void mesh_uart_tx_queue_version_set(struct mesh_uart_tx_queue *queue, uint8_t version);
+
+/**
+ * @brief Encode and frame a message and queue it for transmission. Does not block.
+ *
+ * @param queue Queue to send on.
+ * @param msg Message to send. Copied before the function returns.
+ * @param len Length of the message.
+ * @param cb Called when the frame has been sent. Optional.
+ * @param user_data Passed to the callback.
+ *
+ * @return 0 if the frame was queued, -ENOMEM if the queue is full, otherwise a negative error
+ *         code from encoding or framing the message.
+ */
+int mesh_uart_tx_queue_send(struct mesh_uart_tx_queue *queue, const void *msg, size_t len,
+			    mesh_uart_tx_done_cb_t cb, void *user_data);
+
+/**
+ * @brief Complete the frame in transmission and start the next.
+ *
+ * Must be called from the UART callback for UART_TX_DONE and UART_TX_ABORTED.
+ *
+ * @param queue Queue the event belongs to.
+ * @param evt UART event.
+ */
+void mesh_uart_tx_queue_on_event(struct mesh_uart_tx_queue *queue, const struct uart_event *evt);
+
+/**
+ * @brief Abort the frame in transmission.
+ *
+ * Used to get a queue going again when the driver never reported the end of a transfer. The
+ * frame is completed with -ECANCELED and the next one is started.
+ *
+ * @param queue Queue to abort the transfer of.
+ */
+void mesh_uart_tx_queue_abort(struct mesh_uart_tx_queue *queue);
+
+/**
+ * @brief Get a snapshot of the queue statistics.
+ *
+ * @param queue Queue to get statistics of.
+ * @param stats Filled with the statistics.
+ */
+void mesh_uart_tx_queue_stats_get(struct mesh_uart_tx_queue *queue, struct mesh_uart_tx_stats *stats);
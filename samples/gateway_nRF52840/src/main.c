@@ -19,11 +19,18 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_APPLICATION_MODULE_LOG_LEVEL);
 #include "uart_handler.h"
 #include "model_handler.h"
 #include "robot_movement_cli.h"
+#include "provisioner.h"
 
 static const struct device *mesh_uart = DEVICE_DT_GET(DT_NODELABEL(uart1));
 
 static struct bt_mesh_robot_config_cli *config_client;
 
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+static const struct provisioner_handlers provisioner_handlers = {
+	.robot_added = uart_robot_added,
+};
+#endif
+
 static int setup_mesh()
 {
 	int err;
@@ -34,7 +41,11 @@ static int setup_mesh()
 		return err;
 	}
 	LOG_DBG("Bluetooth initialized");
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+	err = bt_mesh_init(provisioner_prov_init(), model_handler_init(&config_client));
+#else
 	err = bt_mesh_init(bt_mesh_dk_prov_init(), model_handler_init(&config_client));
+#endif
 	if (err)
 	{
 		LOG_ERR("Failed to initialize mesh: Error %d", err);
@@ -50,12 +61,14 @@ static int setup_mesh()
 		}
 	}
 
+#if !defined(CONFIG_GATEWAY_PROVISIONER)
 	err = bt_mesh_prov_enable(BT_MESH_PROV_ADV | BT_MESH_PROV_GATT);
 	if (err == -EALREADY)
 	{
 		LOG_DBG("Device already provisioned");
 		LOG_DBG("Mesh initialized");
 	}
+#endif
 
 	return 0;
 }
@@ -76,4 +89,14 @@ void main(void)
 		LOG_ERR("Could not initialize UART: Error %d", err);
 		return;
 	}
+
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+	/* Started once the UART is up, robots are reported over it. */
+	err = provisioner_start(&provisioner_handlers);
+	if (err)
+	{
+		LOG_ERR("Failed to start provisioner: Error %d", err);
+		return;
+	}
+#endif
 }
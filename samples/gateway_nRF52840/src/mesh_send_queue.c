@@ -0,0 +1,329 @@
+
+#include <string.h>
+#include <zephyr.h>
+#include <zephyr/bluetooth/mesh.h>
+#include "./mesh_send_queue.h"
+
+#define MODULE mesh_send_queue
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE, CONFIG_MESH_SEND_QUEUE_LOG_LEVEL);
+
+BUILD_ASSERT(CONFIG_MESH_SEND_QUEUE_ADV_BUFS < CONFIG_BT_MESH_ADV_BUF_COUNT,
+             "Advertising buffers must be left for relaying and for answers");
+BUILD_ASSERT(CONFIG_MESH_SEND_QUEUE_ADV_BUFS - CONFIG_MESH_SEND_QUEUE_CONTROL_BUFS >= CONFIG_BT_MESH_TX_SEG_MAX,
+             "The longest message would never fit in the advertising buffers");
+
+/* A queued message. It stays taken from when it is queued until its end callback. */
+struct mesh_send_entry
+{
+    sys_snode_t node;
+    struct bt_mesh_model *model;
+    struct bt_mesh_msg_ctx ctx;
+    const struct bt_mesh_send_cb *cb;
+    void *cb_data;
+    int64_t queued_ms;
+    int64_t expires_ms;
+    enum mesh_send_class class;
+    uint16_t len;
+    uint8_t pdus;
+    bool used;
+    bool deferred;
+    uint8_t data[BT_MESH_TX_SDU_MAX - BT_MESH_MIC_SHORT];
+};
+
+static struct mesh_send_entry entries[CONFIG_MESH_SEND_QUEUE_SIZE];
+static sys_slist_t queues[MESH_SEND_CLASS_COUNT];
+static struct mesh_send_class_stats stats[MESH_SEND_CLASS_COUNT];
+static struct k_spinlock lock;
+/* Advertising buffers taken by messages that were sent and have not ended yet. */
+static uint32_t adv_bufs_used;
+
+static void send_work_fn(struct k_work *work);
+static K_WORK_DELAYABLE_DEFINE(send_work, send_work_fn);
+
+uint32_t mesh_send_queue_pdus(size_t len)
+{
+    if (len <= 11)
+    {
+        return 1;
+    }
+    return DIV_ROUND_UP(len + BT_MESH_MIC_SHORT, 12);
+}
+
+/* Frees an entry that is not queued, and calls its end callback if it never got to be sent. */
+static void entry_release(struct mesh_send_entry *entry, bool sent, int err)
+{
+    const struct bt_mesh_send_cb *cb = entry->cb;
+    void *cb_data = entry->cb_data;
+    k_spinlock_key_t key = k_spin_lock(&lock);
+
+    if (sent)
+    {
+        adv_bufs_used -= entry->pdus;
+    }
+    entry->used = false;
+    k_spin_unlock(&lock, key);
+
+    /* The freed buffers may let the next message go. */
+    k_work_reschedule(&send_work, K_NO_WAIT);
+    if (err && cb != NULL && cb->end != NULL)
+    {
+        cb->end(err, cb_data);
+    }
+}
+
+static void entry_send_start(uint16_t duration, int err, void *cb_data)
+{
+    struct mesh_send_entry *entry = cb_data;
+    const struct bt_mesh_send_cb *cb = entry->cb;
+    void *user_data = entry->cb_data;
+
+    /* The stack does not end an unsegmented message that failed to start. A segmented one is
+     * ended by the transport, which releases the entry then.
+     */
+    if (err && entry->pdus == 1)
+    {
+        entry_release(entry, true, 0);
+    }
+    if (cb != NULL && cb->start != NULL)
+    {
+        cb->start(duration, err, user_data);
+    }
+}
+
+static void entry_send_end(int err, void *cb_data)
+{
+    struct mesh_send_entry *entry = cb_data;
+    const struct bt_mesh_send_cb *cb = entry->cb;
+    void *user_data = entry->cb_data;
+
+    entry_release(entry, true, 0);
+    if (cb != NULL && cb->end != NULL)
+    {
+        cb->end(err, user_data);
+    }
+}
+
+static const struct bt_mesh_send_cb entry_send_cb = {
+    .start = entry_send_start,
+    .end = entry_send_end,
+};
+
+/* The first message of the most urgent class that has any. Expired messages on the way are taken
+ * from the queue and returned through expired. Called with the lock held.
+ */
+static struct mesh_send_entry *entry_next(int64_t now, struct mesh_send_entry **expired)
+{
+    *expired = NULL;
+    for (int i = 0; i < MESH_SEND_CLASS_COUNT; i++)
+    {
+        sys_snode_t *node = sys_slist_peek_head(&queues[i]);
+
+        if (node == NULL)
+        {
+            continue;
+        }
+
+        struct mesh_send_entry *entry = CONTAINER_OF(node, struct mesh_send_entry, node);
+
+        if (entry->expires_ms != 0 && now > entry->expires_ms)
+        {
+            sys_slist_get(&queues[i]);
+            stats[i].dropped++;
+            *expired = entry;
+            return NULL;
+        }
+        return entry;
+    }
+    return NULL;
+}
+
+static void send_work_fn(struct k_work *work)
+{
+    while (true)
+    {
+        struct mesh_send_entry *expired;
+        k_spinlock_key_t key = k_spin_lock(&lock);
+        struct mesh_send_entry *entry = entry_next(k_uptime_get(), &expired);
+
+        if (expired != NULL)
+        {
+            k_spin_unlock(&lock, key);
+            LOG_DBG("Message to 0x%04x expired in the queue", expired->ctx.addr);
+            entry_release(expired, false, -ETIME);
+            continue;
+        }
+        if (entry == NULL)
+        {
+            k_spin_unlock(&lock, key);
+            return;
+        }
+        /* Less urgent messages wait as well, or they would keep taking the buffers the first
+         * one needs. The end of a message in flight picks up from here. Only a clear to move
+         * takes the buffers kept for it.
+         */
+        uint32_t adv_bufs = CONFIG_MESH_SEND_QUEUE_ADV_BUFS;
+
+        if (entry->class != MESH_SEND_CLASS_CONTROL)
+        {
+            adv_bufs -= CONFIG_MESH_SEND_QUEUE_CONTROL_BUFS;
+        }
+        if (adv_bufs_used + entry->pdus > adv_bufs)
+        {
+            stats[entry->class].deferred += !entry->deferred;
+            entry->deferred = true;
+            k_spin_unlock(&lock, key);
+            return;
+        }
+        /* The entry may end and be taken again as soon as it is sent, so keep what is needed
+         * afterwards.
+         */
+        enum mesh_send_class class = entry->class;
+        uint32_t wait_ms = k_uptime_get() - entry->queued_ms;
+
+        sys_slist_get(&queues[class]);
+        adv_bufs_used += entry->pdus;
+        k_spin_unlock(&lock, key);
+
+        NET_BUF_SIMPLE_DEFINE(buf, BT_MESH_TX_SDU_MAX);
+        net_buf_simple_add_mem(&buf, entry->data, entry->len);
+        int err = bt_mesh_model_send(entry->model, &entry->ctx, &buf, &entry_send_cb, entry);
+
+        key = k_spin_lock(&lock);
+        if (err == -ENOBUFS || err == -EBUSY)
+        {
+            /* Others took the buffers, such as relays, or every segmented message context of
+             * the transport is taken. Back to the front of the queue.
+             */
+            adv_bufs_used -= entry->pdus;
+            sys_slist_prepend(&queues[class], &entry->node);
+            stats[class].deferred += !entry->deferred;
+            entry->deferred = true;
+            k_spin_unlock(&lock, key);
+            k_work_reschedule(&send_work, K_MSEC(CONFIG_MESH_SEND_QUEUE_RETRY_MS));
+            return;
+        }
+        if (err)
+        {
+            stats[class].dropped++;
+            k_spin_unlock(&lock, key);
+            LOG_WRN("Failed to send to 0x%04x (err %d)", entry->ctx.addr, err);
+            entry_release(entry, true, err);
+            continue;
+        }
+
+        stats[class].sent++;
+        stats[class].wait_max_ms = MAX(stats[class].wait_max_ms, wait_ms);
+        k_spin_unlock(&lock, key);
+    }
+}
+
+/* A free entry, or else the newest queued one of the least urgent class that is less urgent than
+ * the given one, which is taken from its queue. Called with the lock held.
+ */
+static struct mesh_send_entry *entry_alloc(enum mesh_send_class class, bool *evicted)
+{
+    *evicted = false;
+    for (int i = 0; i < ARRAY_SIZE(entries); i++)
+    {
+        if (!entries[i].used)
+        {
+            return &entries[i];
+        }
+    }
+
+    for (int i = MESH_SEND_CLASS_COUNT - 1; i > class; i--)
+    {
+        sys_snode_t *node = sys_slist_peek_tail(&queues[i]);
+
+        if (node != NULL)
+        {
+            sys_slist_find_and_remove(&queues[i], node);
+            stats[i].dropped++;
+            *evicted = true;
+            return CONTAINER_OF(node, struct mesh_send_entry, node);
+        }
+    }
+    return NULL;
+}
+
+int mesh_send_queue_submit(struct bt_mesh_model *model, const struct bt_mesh_msg_ctx *ctx,
+                           const struct net_buf_simple *buf, const struct bt_mesh_send_cb *cb, void *cb_data,
+                           enum mesh_send_class class, int64_t expires_ms)
+{
+    struct mesh_send_entry *entry;
+    const struct bt_mesh_send_cb *evicted_cb = NULL;
+    void *evicted_cb_data = NULL;
+    uint16_t evicted_addr = BT_MESH_ADDR_UNASSIGNED;
+    bool evicted;
+
+    if (buf->len > sizeof(entry->data))
+    {
+        return -EMSGSIZE;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    entry = entry_alloc(class, &evicted);
+    if (entry == NULL)
+    {
+        stats[class].dropped++;
+        k_spin_unlock(&lock, key);
+        LOG_WRN("Send queue full, message to 0x%04x dropped", ctx->addr);
+        return -ENOMEM;
+    }
+    if (evicted)
+    {
+        /* The end callback of the message that gave way is called once the lock is released. */
+        evicted_cb = entry->cb;
+        evicted_cb_data = entry->cb_data;
+        evicted_addr = entry->ctx.addr;
+    }
+
+    entry->used = true;
+    entry->deferred = false;
+    entry->model = model;
+    entry->ctx = *ctx;
+    entry->cb = cb;
+    entry->cb_data = cb_data;
+    entry->class = class;
+    entry->queued_ms = k_uptime_get();
+    entry->expires_ms = expires_ms;
+    entry->len = buf->len;
+    entry->pdus = mesh_send_queue_pdus(buf->len);
+    memcpy(entry->data, buf->data, buf->len);
+    sys_slist_append(&queues[class], &entry->node);
+    stats[class].queued++;
+    k_spin_unlock(&lock, key);
+
+    if (evicted)
+    {
+        LOG_DBG("Message to 0x%04x dropped for a more urgent one", evicted_addr);
+        if (evicted_cb != NULL && evicted_cb->end != NULL)
+        {
+            evicted_cb->end(-ECANCELED, evicted_cb_data);
+        }
+    }
+
+    k_work_reschedule(&send_work, K_NO_WAIT);
+    return 0;
+}
+
+void mesh_send_queue_stats_log(void)
+{
+    static const char *const class_names[] = {"Control", "Config", "Bulk"};
+    struct mesh_send_class_stats class_stats[MESH_SEND_CLASS_COUNT];
+    k_spinlock_key_t key = k_spin_lock(&lock);
+    uint32_t used = adv_bufs_used;
+
+    memcpy(class_stats, stats, sizeof(class_stats));
+    k_spin_unlock(&lock, key);
+
+    LOG_DBG("Send queue: %u of %u advertising buffers in use", used, CONFIG_MESH_SEND_QUEUE_ADV_BUFS);
+    for (int i = 0; i < MESH_SEND_CLASS_COUNT; i++)
+    {
+        LOG_DBG("%s: %u queued, %u sent, %u deferred, %u dropped, longest wait %u ms",
+                class_names[i], class_stats[i].queued, class_stats[i].sent, class_stats[i].deferred,
+                class_stats[i].dropped, class_stats[i].wait_max_ms);
+    }
+}
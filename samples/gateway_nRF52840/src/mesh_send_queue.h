@@ -0,0 +1,72 @@
+#pragma once
+
+#include <zephyr/bluetooth/mesh.h>
+
+/* Classes of mesh messages sent by the gateway, from the most urgent. Messages of a class are only
+ * sent when no message of a more urgent class is waiting.
+ */
+enum mesh_send_class
+{
+    /* Clear to move, timed against the start of a round. */
+    MESH_SEND_CLASS_CONTROL,
+    /* Movement configuration and time beacons. */
+    MESH_SEND_CLASS_CONFIG,
+    /* Parameter sets, which take many segments each. */
+    MESH_SEND_CLASS_BULK,
+    MESH_SEND_CLASS_COUNT,
+};
+
+/* Messages of a class that were queued, sent, kept waiting for advertising buffers, and dropped
+ * because the queue was full, they expired or sending failed.
+ */
+struct mesh_send_class_stats
+{
+    uint32_t queued;
+    uint32_t sent;
+    uint32_t deferred;
+    uint32_t dropped;
+    uint32_t wait_max_ms;
+};
+
+/**
+ * @brief Get the network PDUs an access message takes.
+ *
+ * Messages of up to 11 bytes go unsegmented, longer ones in segments of 12 bytes including the
+ * transport MIC.
+ *
+ * @param len Length of the access message, opcode included.
+ * @return Number of network PDUs.
+ */
+uint32_t mesh_send_queue_pdus(size_t len);
+
+/**
+ * @brief Queue an access message to be sent with bt_mesh_model_send().
+ *
+ * The message is copied. It is sent once every message of a more urgent class and every earlier
+ * message of its own class has been sent, and the advertising buffers it takes are free. Only
+ * CONFIG_MESH_SEND_QUEUE_ADV_BUFS advertising buffers are taken at once, the rest is left for
+ * relaying and for answers. Messages of classes other than MESH_SEND_CLASS_CONTROL leave
+ * CONFIG_MESH_SEND_QUEUE_CONTROL_BUFS of them free. When the queue is full, the newest message
+ * of a less urgent class gives way.
+ *
+ * The end callback is also called with a negative error code if the message is dropped after it
+ * was queued. The start callback is only called for messages that were sent.
+ *
+ * @param model Model to send from.
+ * @param ctx Message context.
+ * @param buf Access message, opcode included.
+ * @param cb Send callbacks, or NULL.
+ * @param cb_data Passed to the callbacks.
+ * @param class Class of the message.
+ * @param expires_ms Uptime after which the message is dropped unsent, 0 if it does not expire.
+ * @return 0 if the message was queued, -ENOMEM if the queue is full of messages at least as
+ *         urgent, -EMSGSIZE if the message is too long to send.
+ */
+int mesh_send_queue_submit(struct bt_mesh_model *model, const struct bt_mesh_msg_ctx *ctx,
+                           const struct net_buf_simple *buf, const struct bt_mesh_send_cb *cb, void *cb_data,
+                           enum mesh_send_class class, int64_t expires_ms);
+
+/**
+ * @brief Log the queued, sent, deferred and dropped messages of every class.
+ */
+void mesh_send_queue_stats_log(void);
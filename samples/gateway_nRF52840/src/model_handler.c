@@ -4,6 +4,7 @@
 #include "../../common/mesh_model_defines/robot_movement_cli.h"
 #include "model_handler.h"
 #include "robot_movement_cli.h"
+#include "time_sync_srv.h"
 
 /* SIG models */
 
@@ -28,17 +29,27 @@ static struct bt_mesh_health_srv health_srv = {
 
 BT_MESH_HEALTH_PUB_DEFINE(health_pub, 0);
 
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+/* Configures the robots, and the gateway itself. */
+static struct bt_mesh_cfg_cli cfg_cli = {};
+#endif
+
 static struct bt_mesh_model sig_models[] = {
     BT_MESH_MODEL_CFG_SRV,
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+    BT_MESH_MODEL_CFG_CLI(&cfg_cli),
+#endif
     BT_MESH_MODEL_HEALTH_SRV(&health_srv, &health_pub),
 };
 
 /* Vendor models */
 
 struct bt_mesh_robot_config_cli robot_conf_cli;
+static struct bt_mesh_time_sync_srv time_sync_srv;
 
 static struct bt_mesh_model vendor_models[] = {
     BT_MESH_MODEL_VND_ROBOT_CONFIG_CLI(&robot_conf_cli),
+    BT_MESH_MODEL_VND_TIME_SYNC_SRV(&time_sync_srv),
 };
 
 /* Composition */
@@ -56,6 +67,5 @@ const struct bt_mesh_comp *model_handler_init(struct bt_mesh_robot_config_cli **
 {
     *config_client = &robot_conf_cli;
     (*config_client)->model = &vendor_models[0];
-    bt_mesh_msg_ack_ctx_init(&(*config_client)->ack_ctx);
     return &comp;
 }
@@ -0,0 +1,629 @@
+
+#include <string.h>
+#include <zephyr.h>
+#include <zephyr/bluetooth/crypto.h>
+#include <zephyr/bluetooth/mesh.h>
+#include <zephyr/drivers/hwinfo.h>
+#include "./provisioner.h"
+#include "../../common/mesh_model_defines/robot_movement_srv.h"
+#include "../../common/mesh_model_defines/robot_movement_cli.h"
+#include "../../common/mesh_model_defines/time_sync.h"
+
+#define MODULE provisioner
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE, CONFIG_PROVISIONER_LOG_LEVEL);
+
+#define NET_IDX BT_MESH_NET_PRIMARY
+#define APP_IDX 0
+
+/* The stack gives up on a provisioning link after 60 s, and closes it. */
+#define LINK_CLOSE_TIMEOUT K_SECONDS(65)
+
+/* A robot keeps sending beacons for a little while after it was provisioned. Beacons from it
+ * after this long mean it was reset, and is provisioned again.
+ */
+#define PROVISIONED_BEACON_IGNORE_MS 10000
+
+static const struct provisioner_handlers *provisioner_handlers;
+
+/* Vendor models bound to the application key. */
+static const uint16_t robot_models[] = {ROBOT_MOVEMENT_SRV_MODEL_ID, TIME_SYNC_CLI_MODEL_ID};
+static const uint16_t gateway_models[] = {ROBOT_MOVEMENT_CLI_MODEL_ID, TIME_SYNC_SRV_MODEL_ID};
+
+/* Onboarding of a robot, from its first beacon until it is configured. */
+struct onboarding
+{
+    uint8_t uuid[16];
+    int64_t discovered_ms;
+    int64_t link_opened_ms;
+    int64_t provisioned_ms;
+    uint16_t addr;
+    /* Provisioned before a restart, without times. */
+    bool restored;
+};
+
+static struct
+{
+    uint32_t onboarded;
+    uint32_t prov_failed;
+    uint32_t config_failed;
+    uint32_t wait_ms_total;
+    uint32_t prov_ms_total;
+    uint32_t config_ms_total;
+    uint32_t total_ms_max;
+    int64_t first_discovered_ms;
+    int64_t last_onboarded_ms;
+} stats;
+
+/* Candidates */
+
+enum candidate_state
+{
+    CANDIDATE_FREE,
+    CANDIDATE_QUEUED,
+    CANDIDATE_LINK,
+    CANDIDATE_PROVISIONED,
+};
+
+/* A robot whose beacon was seen, provisioned in the order the robots were queued. */
+struct candidate
+{
+    struct onboarding onboarding;
+    int64_t queued_ms;
+    uint8_t attempts;
+    enum candidate_state state;
+};
+
+static struct k_spinlock candidates_lock;
+static struct candidate candidates[CONFIG_GATEWAY_PROVISIONER_CANDIDATES];
+static K_SEM_DEFINE(candidate_sem, 0, 1);
+
+/* Called for every unprovisioned beacon, many times for each robot. */
+static void candidate_add(const uint8_t uuid[16])
+{
+    struct candidate *slot = NULL;
+    int64_t now = k_uptime_get();
+    k_spinlock_key_t key = k_spin_lock(&candidates_lock);
+
+    for (int i = 0; i < ARRAY_SIZE(candidates); i++)
+    {
+        struct candidate *candidate = &candidates[i];
+
+        if (candidate->state == CANDIDATE_PROVISIONED && now - candidate->queued_ms > PROVISIONED_BEACON_IGNORE_MS)
+        {
+            candidate->state = CANDIDATE_FREE;
+        }
+        if (candidate->state != CANDIDATE_FREE && !memcmp(candidate->onboarding.uuid, uuid, 16))
+        {
+            k_spin_unlock(&candidates_lock, key);
+            return;
+        }
+        if (candidate->state == CANDIDATE_FREE && slot == NULL)
+        {
+            slot = candidate;
+        }
+    }
+    if (slot == NULL)
+    {
+        /* The robot is seen again at its next beacon. */
+        k_spin_unlock(&candidates_lock, key);
+        return;
+    }
+    memset(slot, 0, sizeof(*slot));
+    memcpy(slot->onboarding.uuid, uuid, 16);
+    slot->onboarding.discovered_ms = now;
+    slot->queued_ms = now;
+    slot->state = CANDIDATE_QUEUED;
+    k_spin_unlock(&candidates_lock, key);
+
+    k_sem_give(&candidate_sem);
+}
+
+/* The candidate that has been queued the longest. */
+static struct candidate *candidate_next(void)
+{
+    struct candidate *next = NULL;
+    k_spinlock_key_t key = k_spin_lock(&candidates_lock);
+
+    for (int i = 0; i < ARRAY_SIZE(candidates); i++)
+    {
+        if (candidates[i].state == CANDIDATE_QUEUED && (next == NULL || candidates[i].queued_ms < next->queued_ms))
+        {
+            next = &candidates[i];
+        }
+    }
+    if (next != NULL)
+    {
+        next->state = CANDIDATE_LINK;
+    }
+    k_spin_unlock(&candidates_lock, key);
+    return next;
+}
+
+/* Failed candidates go to the back of the queue, and are dropped after too many attempts. */
+static void candidate_done(struct candidate *candidate, int err)
+{
+    k_spinlock_key_t key = k_spin_lock(&candidates_lock);
+
+    candidate->queued_ms = k_uptime_get();
+    if (!err)
+    {
+        candidate->state = CANDIDATE_PROVISIONED;
+    }
+    else if (++candidate->attempts < CONFIG_GATEWAY_PROVISIONER_RETRIES)
+    {
+        candidate->state = CANDIDATE_QUEUED;
+    }
+    else
+    {
+        candidate->state = CANDIDATE_FREE;
+    }
+    k_spin_unlock(&candidates_lock, key);
+}
+
+/* Provisioning */
+
+static uint8_t dev_uuid[16];
+static uint16_t provisioned_addr;
+static K_SEM_DEFINE(link_closed_sem, 0, 1);
+
+static void unprovisioned_beacon(uint8_t uuid[16], bt_mesh_prov_oob_info_t oob_info, uint32_t *uri_hash)
+{
+    candidate_add(uuid);
+}
+
+static void node_added(uint16_t net_idx, uint8_t uuid[16], uint16_t addr, uint8_t num_elem)
+{
+    provisioned_addr = addr;
+}
+
+static void link_close(bt_mesh_prov_bearer_t bearer)
+{
+    k_sem_give(&link_closed_sem);
+}
+
+static const struct bt_mesh_prov prov = {
+    .uuid = dev_uuid,
+    .unprovisioned_beacon = unprovisioned_beacon,
+    .node_added = node_added,
+    .link_close = link_close,
+};
+
+const struct bt_mesh_prov *provisioner_prov_init(void)
+{
+    hwinfo_get_device_id(dev_uuid, sizeof(dev_uuid));
+    return &prov;
+}
+
+static uint8_t node_stale_del(struct bt_mesh_cdb_node *node, void *user_data)
+{
+    if (!memcmp(node->uuid, user_data, 16))
+    {
+        LOG_INF("Robot at 0x%04x was reset, removing it", node->addr);
+        bt_mesh_cdb_node_del(node, true);
+    }
+    return BT_MESH_CDB_ITER_CONTINUE;
+}
+
+static int robot_provision(struct onboarding *onboarding)
+{
+    bt_mesh_cdb_node_foreach(node_stale_del, onboarding->uuid);
+
+    provisioned_addr = BT_MESH_ADDR_UNASSIGNED;
+    k_sem_reset(&link_closed_sem);
+    onboarding->link_opened_ms = k_uptime_get();
+    /* No attention timer, nobody looks at the robots to pick them out. */
+    int err = bt_mesh_provision_adv(onboarding->uuid, NET_IDX, BT_MESH_ADDR_UNASSIGNED, 0);
+    if (err)
+    {
+        return err;
+    }
+    if (k_sem_take(&link_closed_sem, LINK_CLOSE_TIMEOUT))
+    {
+        return -ETIMEDOUT;
+    }
+    if (provisioned_addr == BT_MESH_ADDR_UNASSIGNED)
+    {
+        return -ECONNABORTED;
+    }
+    onboarding->addr = provisioned_addr;
+    onboarding->provisioned_ms = k_uptime_get();
+    return 0;
+}
+
+/* Provisioned robots waiting to be configured. A robot is configured while the next one is
+ * provisioned, only one provisioning link can be open at a time.
+ */
+K_MSGQ_DEFINE(config_queue, sizeof(struct onboarding), CONFIG_GATEWAY_PROVISIONER_CANDIDATES, 4);
+
+static void provision_thread_fn(void)
+{
+    while (true)
+    {
+        struct candidate *candidate = candidate_next();
+        if (candidate == NULL)
+        {
+            k_sem_take(&candidate_sem, K_FOREVER);
+            continue;
+        }
+
+        struct onboarding onboarding = candidate->onboarding;
+        int err = robot_provision(&onboarding);
+        candidate_done(candidate, err);
+        if (err)
+        {
+            LOG_WRN("Failed to provision robot: Error %d", err);
+            stats.prov_failed++;
+            continue;
+        }
+        LOG_DBG("Robot provisioned at 0x%04x", onboarding.addr);
+        k_msgq_put(&config_queue, &onboarding, K_FOREVER);
+    }
+}
+
+K_THREAD_DEFINE(provision_thread, CONFIG_GATEWAY_PROVISIONER_THREAD_STACK_SIZE, provision_thread_fn, NULL, NULL, NULL, CONFIG_GATEWAY_PROVISIONER_THREAD_PRIORITY, 0, SYS_FOREVER_MS);
+
+/* Configuration */
+
+/* The configuration client runs one request at a time, for the configuration thread and for
+ * group changes from the UART thread.
+ */
+static K_MUTEX_DEFINE(config_mutex);
+
+/* Adds the application key in step 0, and binds a model to it in every step after. */
+static int config_step(uint16_t addr, const uint16_t *models, int step)
+{
+    struct bt_mesh_cdb_app_key *key = bt_mesh_cdb_app_key_get(APP_IDX);
+    uint8_t status;
+    int err;
+
+    if (key == NULL)
+    {
+        return -ENOENT;
+    }
+    if (step == 0)
+    {
+        err = bt_mesh_cfg_app_key_add(NET_IDX, addr, NET_IDX, APP_IDX, key->keys[0].app_key, &status);
+    }
+    else
+    {
+        err = bt_mesh_cfg_mod_app_bind_vnd(NET_IDX, addr, addr, APP_IDX, models[step - 1], CONFIG_BT_COMPANY_ID,
+                                           &status);
+    }
+    if (!err && status)
+    {
+        LOG_WRN("Configuration of 0x%04x failed in step %d with status %u", addr, step, status);
+        return -EIO;
+    }
+    return err;
+}
+
+/* The models are known, so the composition data is not asked for, which saves a round trip. */
+static int node_configure(uint16_t addr, const uint16_t *models, size_t count)
+{
+    for (int step = 0; step <= count; step++)
+    {
+        int err;
+        int attempt = 0;
+
+        k_mutex_lock(&config_mutex, K_FOREVER);
+        do
+        {
+            err = config_step(addr, models, step);
+        } while (err && attempt++ < CONFIG_GATEWAY_PROVISIONER_CONFIG_RETRIES);
+        k_mutex_unlock(&config_mutex);
+        if (err)
+        {
+            return err;
+        }
+    }
+
+    struct bt_mesh_cdb_node *node = bt_mesh_cdb_node_get(addr);
+    if (node != NULL)
+    {
+        atomic_set_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED);
+        if (IS_ENABLED(CONFIG_BT_SETTINGS))
+        {
+            bt_mesh_cdb_node_store(node);
+        }
+    }
+    return 0;
+}
+
+/* Groups */
+
+static bool group_find(const uint16_t *groups, size_t count, uint16_t group)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (groups[i] == group)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Subscribes the movement server of the robot to the group, or unsubscribes it. */
+static int group_step(uint16_t addr, uint16_t group, bool add)
+{
+    uint8_t status;
+    int err;
+    int attempt = 0;
+
+    do
+    {
+        if (add)
+        {
+            err = bt_mesh_cfg_mod_sub_add_vnd(NET_IDX, addr, addr, group, ROBOT_MOVEMENT_SRV_MODEL_ID,
+                                              CONFIG_BT_COMPANY_ID, &status);
+        }
+        else
+        {
+            err = bt_mesh_cfg_mod_sub_del_vnd(NET_IDX, addr, addr, group, ROBOT_MOVEMENT_SRV_MODEL_ID,
+                                              CONFIG_BT_COMPANY_ID, &status);
+        }
+    } while (err && attempt++ < CONFIG_GATEWAY_PROVISIONER_CONFIG_RETRIES);
+
+    if (!err && status)
+    {
+        LOG_WRN("Robot 0x%04x failed to %s group 0x%04x with status %u", addr, add ? "join" : "leave", group,
+                status);
+        return -EIO;
+    }
+    return err;
+}
+
+int provisioner_robot_groups_set(uint16_t addr, const uint16_t *groups, size_t count)
+{
+    uint16_t subs[ROBOT_MOVEMENT_SRV_GROUPS_MAX];
+    size_t sub_count = ARRAY_SIZE(subs);
+    uint8_t status;
+    int err;
+    int attempt = 0;
+
+    if (count > ROBOT_MOVEMENT_SRV_GROUPS_MAX)
+    {
+        return -EINVAL;
+    }
+
+    k_mutex_lock(&config_mutex, K_FOREVER);
+    do
+    {
+        err = bt_mesh_cfg_mod_sub_get_vnd(NET_IDX, addr, addr, ROBOT_MOVEMENT_SRV_MODEL_ID, CONFIG_BT_COMPANY_ID,
+                                          &status, subs, &sub_count);
+    } while (err && attempt++ < CONFIG_GATEWAY_PROVISIONER_CONFIG_RETRIES);
+    if (!err && status)
+    {
+        err = -EIO;
+    }
+
+    /* Only the difference is sent, groups are left before new ones are joined to make room. */
+    for (size_t i = 0; i < sub_count && !err; i++)
+    {
+        if (!group_find(groups, count, subs[i]))
+        {
+            err = group_step(addr, subs[i], false);
+        }
+    }
+    for (size_t i = 0; i < count && !err; i++)
+    {
+        if (!group_find(subs, sub_count, groups[i]))
+        {
+            err = group_step(addr, groups[i], true);
+        }
+    }
+    k_mutex_unlock(&config_mutex);
+
+    if (err)
+    {
+        LOG_ERR("Failed to set the groups of robot 0x%04x: Error %d", addr, err);
+        return err;
+    }
+    LOG_INF("Robot 0x%04x is in %zu groups", addr, count);
+    return 0;
+}
+
+static void onboarding_record(const struct onboarding *onboarding)
+{
+    if (onboarding->restored)
+    {
+        LOG_INF("Robot 0x%04x configured", onboarding->addr);
+        return;
+    }
+
+    int64_t now = k_uptime_get();
+    uint32_t wait_ms = onboarding->link_opened_ms - onboarding->discovered_ms;
+    uint32_t prov_ms = onboarding->provisioned_ms - onboarding->link_opened_ms;
+    uint32_t config_ms = now - onboarding->provisioned_ms;
+    uint32_t total_ms = now - onboarding->discovered_ms;
+
+    if (stats.onboarded == 0 || onboarding->discovered_ms < stats.first_discovered_ms)
+    {
+        stats.first_discovered_ms = onboarding->discovered_ms;
+    }
+    stats.onboarded++;
+    stats.wait_ms_total += wait_ms;
+    stats.prov_ms_total += prov_ms;
+    stats.config_ms_total += config_ms;
+    stats.total_ms_max = MAX(stats.total_ms_max, total_ms);
+    stats.last_onboarded_ms = now;
+
+    LOG_INF("Robot 0x%04x onboarded in %u ms: %u ms waiting, %u ms provisioning, %u ms configuring",
+            onboarding->addr, total_ms, wait_ms, prov_ms, config_ms);
+}
+
+static void config_thread_fn(void)
+{
+    struct onboarding onboarding;
+
+    while (true)
+    {
+        k_msgq_get(&config_queue, &onboarding, K_FOREVER);
+
+        int err = node_configure(onboarding.addr, robot_models, ARRAY_SIZE(robot_models));
+        if (err)
+        {
+            /* Left unconfigured in the database, and tried again after a restart. */
+            LOG_ERR("Failed to configure robot 0x%04x: Error %d", onboarding.addr, err);
+            stats.config_failed++;
+            continue;
+        }
+        onboarding_record(&onboarding);
+        if (provisioner_handlers->robot_added != NULL)
+        {
+            provisioner_handlers->robot_added(onboarding.addr, onboarding.uuid);
+        }
+    }
+}
+
+K_THREAD_DEFINE(config_thread, CONFIG_GATEWAY_PROVISIONER_THREAD_STACK_SIZE, config_thread_fn, NULL, NULL, NULL, CONFIG_GATEWAY_PROVISIONER_THREAD_PRIORITY, 0, SYS_FOREVER_MS);
+
+/* Setup */
+
+static int network_create(void)
+{
+    uint8_t net_key[16];
+
+    bt_rand(net_key, sizeof(net_key));
+    int err = bt_mesh_cdb_create(net_key);
+    if (err == -EALREADY)
+    {
+        LOG_DBG("Using stored network");
+        return 0;
+    }
+    if (err)
+    {
+        return err;
+    }
+
+    struct bt_mesh_cdb_app_key *key = bt_mesh_cdb_app_key_alloc(NET_IDX, APP_IDX);
+    if (key == NULL)
+    {
+        return -ENOMEM;
+    }
+    bt_rand(key->keys[0].app_key, 16);
+    if (IS_ENABLED(CONFIG_BT_SETTINGS))
+    {
+        bt_mesh_cdb_app_key_store(key);
+    }
+    LOG_INF("Created a new network");
+    return 0;
+}
+
+static uint8_t node_restore(struct bt_mesh_cdb_node *node, void *user_data)
+{
+    if (node->addr != CONFIG_GATEWAY_PROVISIONER_ADDR && !atomic_test_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED))
+    {
+        struct onboarding onboarding = {
+            .addr = node->addr,
+            .restored = true,
+        };
+
+        memcpy(onboarding.uuid, node->uuid, 16);
+        if (k_msgq_put(&config_queue, &onboarding, K_NO_WAIT))
+        {
+            return BT_MESH_CDB_ITER_STOP;
+        }
+    }
+    return BT_MESH_CDB_ITER_CONTINUE;
+}
+
+int provisioner_start(const struct provisioner_handlers *handlers)
+{
+    uint8_t dev_key[16];
+    int err;
+
+    provisioner_handlers = handlers;
+
+    err = network_create();
+    if (err)
+    {
+        LOG_ERR("Failed to create network: Error %d", err);
+        return err;
+    }
+
+    struct bt_mesh_cdb_subnet *subnet = bt_mesh_cdb_subnet_get(NET_IDX);
+    if (subnet == NULL)
+    {
+        return -ENOENT;
+    }
+    bt_rand(dev_key, sizeof(dev_key));
+    err = bt_mesh_provision(subnet->keys[0].net_key, NET_IDX, 0, 0, CONFIG_GATEWAY_PROVISIONER_ADDR, dev_key);
+    if (err && err != -EALREADY)
+    {
+        LOG_ERR("Failed to provision the gateway: Error %d", err);
+        return err;
+    }
+    bt_mesh_cfg_cli_timeout_set(CONFIG_GATEWAY_PROVISIONER_CONFIG_TIMEOUT_MS);
+
+    struct bt_mesh_cdb_node *self = bt_mesh_cdb_node_get(CONFIG_GATEWAY_PROVISIONER_ADDR);
+    if (self != NULL && !atomic_test_bit(self->flags, BT_MESH_CDB_NODE_CONFIGURED))
+    {
+        err = node_configure(self->addr, gateway_models, ARRAY_SIZE(gateway_models));
+        if (err)
+        {
+            LOG_ERR("Failed to configure the gateway: Error %d", err);
+            return err;
+        }
+    }
+
+    bt_mesh_cdb_node_foreach(node_restore, NULL);
+    k_thread_start(provision_thread);
+    k_thread_start(config_thread);
+    return 0;
+}
+
+struct robot_next_ctx
+{
+    uint16_t after;
+    struct bt_mesh_cdb_node *node;
+};
+
+static uint8_t robot_next(struct bt_mesh_cdb_node *node, void *user_data)
+{
+    struct robot_next_ctx *ctx = user_data;
+
+    if (node->addr != CONFIG_GATEWAY_PROVISIONER_ADDR && node->addr > ctx->after &&
+        atomic_test_bit(node->flags, BT_MESH_CDB_NODE_CONFIGURED) &&
+        (ctx->node == NULL || node->addr < ctx->node->addr))
+    {
+        ctx->node = node;
+    }
+    return BT_MESH_CDB_ITER_CONTINUE;
+}
+
+int provisioner_robot_next(uint16_t *addr, uint8_t uuid[16])
+{
+    struct robot_next_ctx ctx = {
+        .after = *addr,
+    };
+
+    bt_mesh_cdb_node_foreach(robot_next, &ctx);
+    if (ctx.node == NULL)
+    {
+        return -ENOENT;
+    }
+    *addr = ctx.node->addr;
+    memcpy(uuid, ctx.node->uuid, 16);
+    return 0;
+}
+
+void provisioner_stats_log(void)
+{
+    uint32_t onboarded = stats.onboarded;
+    uint32_t span_ms = stats.last_onboarded_ms - stats.first_discovered_ms;
+
+    LOG_INF("Robots onboarded: %u, %u failed provisioning, %u failed configuration",
+            onboarded, stats.prov_failed, stats.config_failed);
+    if (onboarded == 0)
+    {
+        return;
+    }
+    LOG_INF("Onboarding avg %u ms (%u ms waiting, %u ms provisioning, %u ms configuring), max %u ms, "
+            "%u robots per minute",
+            (stats.wait_ms_total + stats.prov_ms_total + stats.config_ms_total) / onboarded,
+            stats.wait_ms_total / onboarded, stats.prov_ms_total / onboarded, stats.config_ms_total / onboarded,
+            stats.total_ms_max, span_ms ? (uint32_t)(onboarded * 60000ULL / span_ms) : 0);
+}
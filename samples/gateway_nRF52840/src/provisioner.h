@@ -0,0 +1,60 @@
+#pragma once
+
+#include <zephyr/bluetooth/mesh.h>
+
+struct provisioner_handlers
+{
+    /** Called from the provisioner thread when a robot is provisioned and configured. */
+    void (*robot_added)(uint16_t addr, const uint8_t uuid[16]);
+};
+
+/**
+ * @brief Get the provisioning properties of the gateway, to pass to bt_mesh_init().
+ *
+ * @return Provisioning properties that look for unprovisioned robots.
+ */
+const struct bt_mesh_prov *provisioner_prov_init(void);
+
+/**
+ * @brief Provision the gateway itself, if it is not already, and start provisioning robots.
+ *
+ * Must be called after bt_mesh_init() and settings_load(). The first time, a new network and
+ * application key are created. Every robot whose unprovisioned beacon is seen is provisioned,
+ * given the application key and has its vendor models bound to it, then reported through the
+ * handlers. Robots that were provisioned but not configured before a restart are configured now.
+ *
+ * @param handlers Handlers to report robots to.
+ * @return 0 on success, negative error code otherwise.
+ */
+int provisioner_start(const struct provisioner_handlers *handlers);
+
+/**
+ * @brief Set the groups the movement server of a robot is subscribed to.
+ *
+ * The robot is subscribed to exactly the given groups. Blocks until the robot answered every
+ * configuration message, or the retries are spent.
+ *
+ * @param addr Address of the robot.
+ * @param groups Group addresses.
+ * @param count Number of groups, at most ROBOT_MOVEMENT_SRV_GROUPS_MAX.
+ * @return 0 on success, -EIO if the robot refused a group, other negative error codes otherwise.
+ */
+int provisioner_robot_groups_set(uint16_t addr, const uint16_t *groups, size_t count);
+
+/**
+ * @brief Get the configured robot with the lowest address above the given one.
+ *
+ * Walks the robots that are already configured one at a time, so that they can be reported at
+ * the pace the reports can be sent at.
+ *
+ * @param addr Address to start after, BT_MESH_ADDR_UNASSIGNED for the first robot. Set to the
+ *             address of the robot found.
+ * @param uuid Set to the UUID of the robot found.
+ * @return 0 if a robot was found, -ENOENT if there are no more.
+ */
+int provisioner_robot_next(uint16_t *addr, uint8_t uuid[16]);
+
+/**
+ * @brief Log how long robots took to be onboarded, and how many were onboarded per minute.
+ */
+void provisioner_stats_log(void);
@@ -1,7 +1,11 @@
 
+#include <string.h>
 #include <zephyr.h>
 #include <zephyr/bluetooth/mesh.h>
+#include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
 #include "./robot_movement_cli.h"
+#include "./mesh_send_queue.h"
 #include "../../common/mesh_model_defines/robot_movement_cli.h"
 
 #define MODULE robot_config_client
@@ -9,68 +13,904 @@
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_ROBOT_CONFIG_CLIENT_LOG_LEVEL);
 
+/* Airtime */
+
+/* Estimate from a full 29 byte network PDU in an advertising packet on the 1M PHY, sent on three
+ * channels for every network transmission. Relaying, advertising delays and retransmissions of
+ * lost segments are not included.
+ */
+#define ADV_PDU_AIRTIME_US ((1 + 4 + 2 + 6 + 2 + 29 + 3) * 8)
+
+static uint32_t airtime_ms(uint32_t pdus)
+{
+    return pdus * ADV_PDU_AIRTIME_US * 3 * (CONFIG_BT_MESH_NETWORK_TRANSMIT_COUNT + 1) / 1000;
+}
+
+void robot_config_cli_airtime_log(struct bt_mesh_robot_config_cli *config_client)
+{
+    struct bt_mesh_robot_config_cli_airtime airtime = config_client->airtime;
+
+    LOG_INF("Movement config sent: unicast %u msgs, %u PDUs (est. %u ms airtime), multicast %u msgs, %u PDUs (est. %u ms airtime), "
+            "%u status PDUs received",
+            airtime.unicast_msgs, airtime.unicast_pdus, airtime_ms(airtime.unicast_pdus),
+            airtime.multicast_msgs, airtime.multicast_pdus, airtime_ms(airtime.multicast_pdus),
+            airtime.status_pdus);
+
+    static const char *const class_names[] = {"Unicast config", "Multicast config", "Clear to move",
+                                              "Parameter set"};
+
+    for (int i = 0; i < ROBOT_CONFIG_CLI_CLASS_COUNT; i++)
+    {
+        struct bt_mesh_robot_config_cli_class_stats stats = config_client->stats[i];
+
+        LOG_INF("%s: %u msgs, %u resent, %u with reduced TTL, relay radius %u of %u hops, "
+                "%u delivered, latency avg %u ms, max %u ms",
+                class_names[i], stats.msgs, stats.retransmits, stats.reduced_ttl, stats.relay_radius,
+                stats.relay_radius_default, stats.delivered,
+                stats.delivered ? stats.latency_total_ms / stats.delivered : 0, stats.latency_max_ms);
+    }
+
+    struct bt_mesh_robot_config_cli_params_stats params_stats = config_client->params_stats;
+
+    LOG_INF("Parameter sets delivered: %u bytes in %u segments, transfer %u ms (%u B/s), %u CRC mismatches",
+            params_stats.bytes, params_stats.segments, params_stats.transfer_ms,
+            params_stats.transfer_ms ? params_stats.bytes * 1000 / params_stats.transfer_ms : 0,
+            params_stats.crc_mismatches);
+}
+
+#if defined(CONFIG_ROBOT_CONFIG_CLIENT_AIRTIME_COMPARE)
+/* Estimated airtime of configuring a round with unicast and with multicast, answers included,
+ * computed with the same message lengths as the messages that are sent. Nothing is measured.
+ */
+static void airtime_compare_log(void)
+{
+    static const uint8_t robot_counts[] = {10, 30, 60};
+    const size_t set_len = 3 + sizeof(struct robot_movement_set_msg);
+    const size_t status_len = 3 + sizeof(struct robot_movement_set_status_msg);
+    const size_t multi_status_len = 3 + sizeof(struct robot_movement_set_multi_status_msg);
+
+    for (int i = 0; i < ARRAY_SIZE(robot_counts); i++)
+    {
+        uint32_t robots = robot_counts[i];
+        uint32_t unicast = robots * (mesh_send_queue_pdus(set_len) + mesh_send_queue_pdus(status_len));
+        uint32_t multicast = robots * mesh_send_queue_pdus(multi_status_len);
+
+        for (uint32_t left = robots; left > 0;)
+        {
+            uint32_t entries = MIN(left, ROBOT_MOVEMENT_SET_MULTI_MAX);
+
+            multicast += mesh_send_queue_pdus(3 + 1 + entries * ROBOT_MOVEMENT_SET_MULTI_ENTRY_LEN);
+            left -= entries;
+        }
+        LOG_INF("%u robots: unicast %u PDUs (est. %u ms airtime), multicast %u PDUs (est. %u ms airtime)",
+                robots, unicast, airtime_ms(unicast), multicast, airtime_ms(multicast));
+    }
+}
+#endif
+
+/* Robots */
+
+/* Answers to messages that were not relayed are sent with TTL 0 and arrive with it. Other
+ * messages from the robots start at the default TTL, which all nodes get from the provisioner.
+ */
+static uint8_t hops_from_ttl(uint8_t recv_ttl)
+{
+    uint8_t ttl = bt_mesh_default_ttl_get();
+
+    return recv_ttl == 0 || recv_ttl > ttl ? 0 : ttl - recv_ttl;
+}
+
+static bool hops_fresh(const struct bt_mesh_robot_config_cli_robot *robot, int64_t now)
+{
+    return robot->seen_ms != 0 && now - robot->seen_ms < CONFIG_ROBOT_CONFIG_CLIENT_HOP_MAX_AGE_MS;
+}
+
+/* The robot's entry, or else the one that was used the longest ago, which is cleared for the
+ * robot. Called with the transaction lock held.
+ */
+static struct bt_mesh_robot_config_cli_robot *robot_get(struct bt_mesh_robot_config_cli *config_client,
+                                                        uint16_t addr)
+{
+    struct bt_mesh_robot_config_cli_robot *robot = &config_client->robots[0];
+
+    for (int i = 0; i < ARRAY_SIZE(config_client->robots); i++)
+    {
+        if (config_client->robots[i].addr == addr)
+        {
+            robot = &config_client->robots[i];
+            robot->used_ms = k_uptime_get();
+            return robot;
+        }
+        if (config_client->robots[i].used_ms < robot->used_ms)
+        {
+            robot = &config_client->robots[i];
+        }
+    }
+    config_client->robots_forgotten |= robot->addr != BT_MESH_ADDR_UNASSIGNED;
+    memset(robot, 0, sizeof(*robot));
+    robot->addr = addr;
+    robot->used_ms = k_uptime_get();
+    return robot;
+}
+
+static void robot_heard(struct bt_mesh_robot_config_cli *config_client, const struct bt_mesh_msg_ctx *ctx)
+{
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+    struct bt_mesh_robot_config_cli_robot *robot = robot_get(config_client, ctx->addr);
+
+    robot->hops = hops_from_ttl(ctx->recv_ttl);
+    robot->ttl = ctx->recv_ttl;
+    robot->rssi = ctx->recv_rssi;
+    robot->seen_ms = robot->used_ms;
+    k_spin_unlock(&config_client->tx_lock, key);
+}
+
+static void robot_sent(struct bt_mesh_robot_config_cli *config_client, uint16_t addr, bool retransmit)
+{
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+    struct bt_mesh_robot_config_cli_robot *robot = robot_get(config_client, addr);
+
+    if (retransmit)
+    {
+        robot->retries++;
+    }
+    else
+    {
+        robot->sent++;
+    }
+    k_spin_unlock(&config_client->tx_lock, key);
+}
+
+static uint8_t rtt_bin(uint32_t rtt_ms)
+{
+    for (uint8_t i = 0; i < ROBOT_CONFIG_CLI_RTT_BINS - 1; i++)
+    {
+        if (rtt_ms < (ROBOT_CONFIG_CLI_RTT_BIN_MS << i))
+        {
+            return i;
+        }
+    }
+    return ROBOT_CONFIG_CLI_RTT_BINS - 1;
+}
+
+/* A movement configuration completed. The round trip time is negative if it is not known. */
+static void robot_done(struct bt_mesh_robot_config_cli *config_client, uint16_t addr, bool acked, int64_t rtt_ms)
+{
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+    struct bt_mesh_robot_config_cli_robot *robot = robot_get(config_client, addr);
+
+    if (!acked)
+    {
+        robot->timeouts++;
+    }
+    else
+    {
+        robot->acked++;
+        if (rtt_ms >= 0)
+        {
+            robot->rtt_bins[rtt_bin(rtt_ms)]++;
+        }
+    }
+    k_spin_unlock(&config_client->tx_lock, key);
+}
+
+size_t robot_config_cli_robots_get(struct bt_mesh_robot_config_cli *config_client,
+                                   struct bt_mesh_robot_config_cli_robot *robots, size_t max)
+{
+    size_t count = 0;
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+
+    for (int i = 0; i < ARRAY_SIZE(config_client->robots) && count < max; i++)
+    {
+        if (config_client->robots[i].addr != BT_MESH_ADDR_UNASSIGNED)
+        {
+            robots[count++] = config_client->robots[i];
+        }
+    }
+    k_spin_unlock(&config_client->tx_lock, key);
+    return count;
+}
+
+/* TTL that lets a message take the given relay hops. TTL 1 is not allowed to be sent. */
+static uint8_t ttl_for_hops(uint8_t hops)
+{
+    return hops == 0 ? 0 : hops + 1;
+}
+
+/* The smallest TTL that reaches the address, going by the hops learned. A group address is
+ * reached when the farthest robot is, so it only gets a smaller TTL while every robot the client
+ * knows of answered recently and none was forgotten. Unknown robots get the default TTL.
+ */
+static uint8_t ttl_get(struct bt_mesh_robot_config_cli *config_client, uint16_t addr)
+{
+    uint8_t ttl = bt_mesh_default_ttl_get();
+
+    if (!IS_ENABLED(CONFIG_ROBOT_CONFIG_CLIENT_ADAPTIVE_TTL))
+    {
+        return ttl;
+    }
+
+    int64_t now = k_uptime_get();
+    bool unicast = BT_MESH_ADDR_IS_UNICAST(addr);
+    bool found = false;
+    bool stale = !unicast && config_client->robots_forgotten;
+    uint8_t hops = 0;
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+
+    for (int i = 0; i < ARRAY_SIZE(config_client->robots) && !stale; i++)
+    {
+        const struct bt_mesh_robot_config_cli_robot *robot = &config_client->robots[i];
+
+        if (robot->addr == BT_MESH_ADDR_UNASSIGNED || (unicast && robot->addr != addr))
+        {
+            continue;
+        }
+        if (!hops_fresh(robot, now))
+        {
+            stale = !unicast;
+            continue;
+        }
+        hops = MAX(hops, robot->hops);
+        found = true;
+    }
+    k_spin_unlock(&config_client->tx_lock, key);
+
+    if (!found || stale)
+    {
+        return ttl;
+    }
+    return MIN(ttl_for_hops(hops + CONFIG_ROBOT_CONFIG_CLIENT_TTL_MARGIN), ttl);
+}
+
+static void class_sent(struct bt_mesh_robot_config_cli *config_client, enum bt_mesh_robot_config_cli_class class,
+                       uint8_t ttl, bool retransmit)
+{
+    struct bt_mesh_robot_config_cli_class_stats *stats = &config_client->stats[class];
+    uint8_t ttl_default = bt_mesh_default_ttl_get();
+
+    stats->msgs++;
+    stats->retransmits += retransmit;
+    stats->reduced_ttl += ttl < ttl_default;
+    stats->relay_radius += ttl ? ttl - 1 : 0;
+    stats->relay_radius_default += ttl_default ? ttl_default - 1 : 0;
+}
+
+static void class_delivered(struct bt_mesh_robot_config_cli *config_client, enum bt_mesh_robot_config_cli_class class,
+                            int64_t start_ms)
+{
+    struct bt_mesh_robot_config_cli_class_stats *stats = &config_client->stats[class];
+    uint32_t latency_ms = k_uptime_get() - start_ms;
+
+    stats->delivered++;
+    stats->latency_total_ms += latency_ms;
+    stats->latency_max_ms = MAX(stats->latency_max_ms, latency_ms);
+}
+
 /* Sent commands */
 
-int configure_robot_movement(struct bt_mesh_robot_config_cli *config_client, uint16_t address, struct robot_movement_set_msg msg)
+static int movement_set_send(struct bt_mesh_robot_config_cli_tx *tx)
+{
+    bool retransmit = tx->attempts > 0;
+    uint8_t ttl = retransmit ? bt_mesh_default_ttl_get() : ttl_get(tx->config_client, tx->addr);
+    struct bt_mesh_msg_ctx ctx =
+        {
+            .addr = tx->addr,
+            .app_idx = tx->config_client->model->keys[0],
+            .send_ttl = ttl,
+            .send_rel = false,
+        };
+
+    BT_MESH_MODEL_BUF_DEFINE(buf, OP_VND_ROBOT_MOVEMENT_SET, sizeof(struct robot_movement_set_msg));
+    bt_mesh_model_msg_init(&buf, OP_VND_ROBOT_MOVEMENT_SET);
+    net_buf_simple_add_be32(&buf, tx->msg.time);
+    net_buf_simple_add_be32(&buf, tx->msg.angle);
+    tx->attempts++;
+    int err = mesh_send_queue_submit(tx->config_client->model, &ctx, &buf, NULL, NULL, MESH_SEND_CLASS_CONFIG, 0);
+    if (!err)
+    {
+        tx->config_client->airtime.unicast_msgs++;
+        tx->config_client->airtime.unicast_pdus += mesh_send_queue_pdus(buf.len);
+        class_sent(tx->config_client, ROBOT_CONFIG_CLI_CLASS_CONFIG, ttl, retransmit);
+    }
+    return err;
+}
+
+static struct bt_mesh_robot_config_cli_tx *tx_find(struct bt_mesh_robot_config_cli *config_client,
+                                                   uint16_t addr, uint32_t status_op)
+{
+    for (int i = 0; i < ARRAY_SIZE(config_client->txs); i++)
+    {
+        struct bt_mesh_robot_config_cli_tx *tx = &config_client->txs[i];
+
+        if (tx->busy && tx->addr == addr && tx->status_op == status_op)
+        {
+            return tx;
+        }
+    }
+    return NULL;
+}
+
+/* Frees the transaction and calls its callback, unless someone else got there first. */
+static void tx_complete(struct bt_mesh_robot_config_cli_tx *tx, int err)
+{
+    struct bt_mesh_robot_config_cli *config_client = tx->config_client;
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+
+    if (!tx->busy)
+    {
+        k_spin_unlock(&config_client->tx_lock, key);
+        return;
+    }
+    bt_mesh_robot_config_cli_tx_cb_t cb = tx->cb;
+    void *user_data = tx->user_data;
+    uint16_t addr = tx->addr;
+
+    k_work_cancel_delayable(&tx->timeout);
+    tx->busy = false;
+    k_spin_unlock(&config_client->tx_lock, key);
+
+    if (cb != NULL)
+    {
+        cb(config_client, addr, err, user_data);
+    }
+}
+
+static void tx_timeout(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct bt_mesh_robot_config_cli_tx *tx = CONTAINER_OF(dwork, struct bt_mesh_robot_config_cli_tx, timeout);
+
+    if (!tx->busy)
+    {
+        return;
+    }
+    if (tx->attempts > CONFIG_ROBOT_CONFIG_CLIENT_TX_RETRIES)
+    {
+        LOG_WRN("Robot 0x%04x did not acknowledge its movement configuration", tx->addr);
+        robot_done(tx->config_client, tx->addr, false, -1);
+        tx_complete(tx, -ETIMEDOUT);
+        return;
+    }
+
+    /* A failed send, typically a full send queue, also waits for the next attempt. */
+    robot_sent(tx->config_client, tx->addr, true);
+    int err = movement_set_send(tx);
+    if (err)
+    {
+        LOG_DBG("Failed to resend to 0x%04x (err %d)", tx->addr, err);
+    }
+    k_work_reschedule(&tx->timeout, K_MSEC(CONFIG_ROBOT_CONFIG_CLIENT_TX_TIMEOUT_MS));
+}
+
+int configure_robot_movement_async(struct bt_mesh_robot_config_cli *config_client, uint16_t address,
+                                   struct robot_movement_set_msg msg, bt_mesh_robot_config_cli_tx_cb_t cb,
+                                   void *user_data)
 {
     if (!bt_mesh_is_provisioned())
     {
         LOG_ERR("Device not provisioned");
         return -EAGAIN;
     }
+
+    struct bt_mesh_robot_config_cli_tx *tx = NULL;
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+
+    if (tx_find(config_client, address, OP_VND_ROBOT_MOVEMENT_SET_STATUS) != NULL)
+    {
+        k_spin_unlock(&config_client->tx_lock, key);
+        return -EALREADY;
+    }
+    for (int i = 0; i < ARRAY_SIZE(config_client->txs); i++)
+    {
+        if (!config_client->txs[i].busy)
+        {
+            tx = &config_client->txs[i];
+            break;
+        }
+    }
+    if (tx == NULL)
+    {
+        k_spin_unlock(&config_client->tx_lock, key);
+        LOG_ERR("No free transaction for robot 0x%04x", address);
+        return -ENOMEM;
+    }
+    tx->busy = true;
+    tx->addr = address;
+    tx->status_op = OP_VND_ROBOT_MOVEMENT_SET_STATUS;
+    tx->msg = msg;
+    tx->cb = cb;
+    tx->user_data = user_data;
+    tx->attempts = 0;
+    tx->start_ms = k_uptime_get();
+    k_spin_unlock(&config_client->tx_lock, key);
+
+    robot_sent(config_client, address, false);
+    int err = movement_set_send(tx);
+    if (err && err != -ENOMEM)
+    {
+        LOG_ERR("Failed to send message (err %d)", err);
+        tx->busy = false;
+        return err;
+    }
+    k_work_reschedule(&tx->timeout, K_MSEC(CONFIG_ROBOT_CONFIG_CLIENT_TX_TIMEOUT_MS));
+    return 0;
+}
+
+struct movement_set_wait
+{
+    struct k_sem done;
+    int err;
+};
+
+static void movement_set_wait_done(struct bt_mesh_robot_config_cli *config_client, uint16_t addr, int err,
+                                   void *user_data)
+{
+    struct movement_set_wait *wait = user_data;
+
+    wait->err = err;
+    k_sem_give(&wait->done);
+}
+
+int configure_robot_movement(struct bt_mesh_robot_config_cli *config_client, uint16_t address, struct robot_movement_set_msg msg)
+{
+    struct movement_set_wait wait;
+
+    k_sem_init(&wait.done, 0, 1);
+    int err = configure_robot_movement_async(config_client, address, msg, movement_set_wait_done, &wait);
+    if (err)
+    {
+        return err;
+    }
+    k_sem_take(&wait.done, K_FOREVER);
+    return wait.err;
+}
+
+/* The messages of a full transaction are segmented and go out back to back. */
+BUILD_ASSERT(DIV_ROUND_UP(CONFIG_ROBOT_CONFIG_CLIENT_TX_COUNT, ROBOT_MOVEMENT_SET_MULTI_MAX) <
+                 CONFIG_BT_MESH_TX_SEG_MSG_COUNT,
+             "Segmented multicast movement configurations would be refused with -EBUSY");
+
+/* Sends the entries that were not acknowledged yet, as few messages as they fit in. */
+static int multi_send(struct bt_mesh_robot_config_cli *config_client)
+{
+    struct bt_mesh_robot_config_cli_multi *multi = &config_client->multi;
+    bool retransmit = multi->attempts > 0;
+    uint8_t ttl = 0;
+
+    /* Far enough for every robot in the message, the robots that are left on retransmits. */
+    for (uint8_t i = 0; i < multi->count; i++)
+    {
+        if (!atomic_test_bit(multi->acked, i))
+        {
+            ttl = MAX(ttl, retransmit ? bt_mesh_default_ttl_get() : ttl_get(config_client, multi->entries[i].addr));
+        }
+    }
+
     struct bt_mesh_msg_ctx ctx =
         {
-            .addr = address,
+            .addr = multi->dst,
             .app_idx = config_client->model->keys[0],
-            .send_ttl = BT_MESH_TTL_DEFAULT,
+            .send_ttl = ttl,
             .send_rel = false,
         };
+    BT_MESH_MODEL_BUF_DEFINE(buf, OP_VND_ROBOT_MOVEMENT_SET_MULTI,
+                             1 + ROBOT_MOVEMENT_SET_MULTI_MAX * ROBOT_MOVEMENT_SET_MULTI_ENTRY_LEN);
+    uint8_t i = 0;
 
-    if (bt_mesh_msg_ack_ctx_prepare(&config_client->ack_ctx, OP_VND_ROBOT_MOVEMENT_SET_STATUS, address, NULL)){
-        LOG_ERR("Failed to prepare ack ctx");
-        return -EALREADY;
+    multi->attempts++;
+    while (i < multi->count)
+    {
+        uint8_t packed = 0;
+
+        bt_mesh_model_msg_init(&buf, OP_VND_ROBOT_MOVEMENT_SET_MULTI);
+        net_buf_simple_add_u8(&buf, multi->tid);
+        for (; i < multi->count && packed < ROBOT_MOVEMENT_SET_MULTI_MAX; i++)
+        {
+            if (atomic_test_bit(multi->acked, i))
+            {
+                continue;
+            }
+            net_buf_simple_add_be16(&buf, multi->entries[i].addr);
+            net_buf_simple_add_be32(&buf, multi->entries[i].config.time);
+            net_buf_simple_add_be32(&buf, multi->entries[i].config.angle);
+            packed++;
+        }
+        if (packed == 0)
+        {
+            break;
+        }
+
+        int err = mesh_send_queue_submit(config_client->model, &ctx, &buf, NULL, NULL, MESH_SEND_CLASS_CONFIG, 0);
+        if (err)
+        {
+            return err;
+        }
+        config_client->airtime.multicast_msgs++;
+        config_client->airtime.multicast_pdus += mesh_send_queue_pdus(buf.len);
+        class_sent(config_client, ROBOT_CONFIG_CLI_CLASS_MULTI, ttl, retransmit);
     }
+    return 0;
+}
 
-    BT_MESH_MODEL_BUF_DEFINE(buf, OP_VND_ROBOT_MOVEMENT_SET, sizeof(struct robot_movement_set_msg));
-    bt_mesh_model_msg_init(&buf, OP_VND_ROBOT_MOVEMENT_SET);
-    net_buf_simple_add_be32(&buf, msg.time);
-    net_buf_simple_add_be32(&buf, msg.angle);
-    int err = bt_mesh_model_send(config_client->model, &ctx, &buf, NULL, NULL);
+static void multi_complete(struct bt_mesh_robot_config_cli *config_client)
+{
+    struct bt_mesh_robot_config_cli_multi *multi = &config_client->multi;
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+
+    if (!multi->busy)
+    {
+        k_spin_unlock(&config_client->tx_lock, key);
+        return;
+    }
+    k_work_cancel_delayable(&multi->timeout);
+    multi->busy = false;
+    k_spin_unlock(&config_client->tx_lock, key);
+
+    for (uint8_t i = 0; i < multi->count; i++)
+    {
+        if (!atomic_test_bit(multi->acked, i))
+        {
+            robot_done(config_client, multi->entries[i].addr, false, -1);
+        }
+    }
+
+    /* The entries stay as they are until the next transaction is started. */
+    if (multi->cb != NULL)
+    {
+        multi->cb(config_client, multi->entries, multi->count, multi->acked, multi->user_data);
+    }
+}
+
+static void multi_timeout(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct bt_mesh_robot_config_cli_multi *multi = CONTAINER_OF(dwork, struct bt_mesh_robot_config_cli_multi, timeout);
+    struct bt_mesh_robot_config_cli *config_client = CONTAINER_OF(multi, struct bt_mesh_robot_config_cli, multi);
+
+    if (!multi->busy)
+    {
+        return;
+    }
+    if (multi->attempts > CONFIG_ROBOT_CONFIG_CLIENT_MULTI_RETRIES)
+    {
+        LOG_WRN("Not every robot acknowledged the multicast movement configuration");
+        multi_complete(config_client);
+        return;
+    }
+
+    for (uint8_t i = 0; i < multi->count; i++)
+    {
+        if (!atomic_test_bit(multi->acked, i))
+        {
+            robot_sent(config_client, multi->entries[i].addr, true);
+        }
+    }
+    int err = multi_send(config_client);
     if (err)
+    {
+        LOG_DBG("Failed to resend multicast movement configuration (err %d)", err);
+    }
+    k_work_reschedule(&multi->timeout, K_MSEC(CONFIG_ROBOT_CONFIG_CLIENT_TX_TIMEOUT_MS));
+}
+
+int configure_robot_movement_multi(struct bt_mesh_robot_config_cli *config_client, uint16_t dst,
+                                   const struct robot_movement_set_multi_entry *entries, uint8_t count,
+                                   bt_mesh_robot_config_cli_multi_cb_t cb, void *user_data)
+{
+    struct bt_mesh_robot_config_cli_multi *multi = &config_client->multi;
+
+    if (!bt_mesh_is_provisioned())
+    {
+        LOG_ERR("Device not provisioned");
+        return -EAGAIN;
+    }
+    if (count == 0 || count > ARRAY_SIZE(multi->entries))
+    {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+    if (multi->busy)
+    {
+        k_spin_unlock(&config_client->tx_lock, key);
+        return -EBUSY;
+    }
+    /* Answers to the previous transaction no longer match. */
+    multi->tid++;
+    multi->busy = true;
+    k_spin_unlock(&config_client->tx_lock, key);
+
+    memcpy(multi->entries, entries, count * sizeof(entries[0]));
+    memset(multi->acked, 0, sizeof(multi->acked));
+    multi->count = count;
+    multi->dst = dst;
+    multi->cb = cb;
+    multi->user_data = user_data;
+    multi->attempts = 0;
+    multi->start_ms = k_uptime_get();
+
+    for (uint8_t i = 0; i < count; i++)
+    {
+        robot_sent(config_client, entries[i].addr, false);
+    }
+    int err = multi_send(config_client);
+    if (err && err != -ENOMEM)
     {
         LOG_ERR("Failed to send message (err %d)", err);
-        bt_mesh_msg_ack_ctx_clear(&config_client->ack_ctx);
+        multi->busy = false;
         return err;
     }
+    k_work_reschedule(&multi->timeout, K_MSEC(CONFIG_ROBOT_CONFIG_CLIENT_TX_TIMEOUT_MS));
+    return 0;
+}
+
+/* Sends the clear to move with the time left until its start, or returns -ETIME if it passed. */
+static int clear_to_move_send(struct bt_mesh_robot_config_cli *config_client, bool repeat)
+{
+    struct bt_mesh_robot_config_cli_start *start = &config_client->start;
+    int32_t delay_ms = (int32_t)(start->start_ms - k_uptime_get_32());
+    uint8_t ttl = ttl_get(config_client, start->addr);
+    struct bt_mesh_msg_ctx ctx =
+        {
+            .addr = start->addr,
+            .app_idx = config_client->model->keys[0],
+            .send_ttl = ttl,
+            .send_rel = false,
+        };
+
+    if (delay_ms <= 0)
+    {
+        return -ETIME;
+    }
 
-    return bt_mesh_msg_ack_ctx_wait(&config_client->ack_ctx, K_MSEC((CONFIG_BT_MESH_MOD_ACKD_TIMEOUT_BASE + 256 * CONFIG_BT_MESH_MOD_ACKD_TIMEOUT_PER_HOP)));
+    BT_MESH_MODEL_BUF_DEFINE(buf, OP_VND_ROBOT_CLEAR_TO_MOVE, ROBOT_CLEAR_TO_MOVE_MSG_LEN);
+    bt_mesh_model_msg_init(&buf, OP_VND_ROBOT_CLEAR_TO_MOVE);
+    net_buf_simple_add_be32(&buf, start->start_ms);
+    net_buf_simple_add_be16(&buf, delay_ms);
+    net_buf_simple_add_u8(&buf, ttl);
+    /* Dropped rather than sent late, when the delay it carries would have passed. */
+    int err = mesh_send_queue_submit(config_client->model, &ctx, &buf, NULL, NULL, MESH_SEND_CLASS_CONTROL,
+                                     k_uptime_get() + delay_ms);
+    if (!err)
+    {
+        class_sent(config_client, ROBOT_CONFIG_CLI_CLASS_START, ttl, repeat);
+    }
+    return err;
+}
+
+static void clear_to_move_repeat(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct bt_mesh_robot_config_cli_start *start = CONTAINER_OF(dwork, struct bt_mesh_robot_config_cli_start, repeat);
+    struct bt_mesh_robot_config_cli *config_client = CONTAINER_OF(start, struct bt_mesh_robot_config_cli, start);
+
+    int err = clear_to_move_send(config_client, true);
+    if (err)
+    {
+        LOG_WRN("Failed to repeat clear to move (err %d)", err);
+    }
+    if (--start->repeats_left > 0)
+    {
+        k_work_schedule(&start->repeat, K_MSEC(CONFIG_ROBOT_CONFIG_CLIENT_START_INTERVAL_MS));
+    }
 }
 
 int send_clear_to_move(struct bt_mesh_robot_config_cli *config_client, uint16_t address)
 {
+    struct bt_mesh_robot_config_cli_start *start = &config_client->start;
+
     if (!bt_mesh_is_provisioned())
     {
         LOG_ERR("Device not provisioned");
         return -EAGAIN;
     }
+
+    /* A new start replaces one still being repeated. */
+    k_work_cancel_delayable(&start->repeat);
+    start->addr = address;
+    start->start_ms = k_uptime_get_32() + CONFIG_ROBOT_CONFIG_CLIENT_START_DELAY_MS;
+    start->repeats_left = CONFIG_ROBOT_CONFIG_CLIENT_START_REPEATS - 1;
+
+    int err = clear_to_move_send(config_client, false);
+    if (start->repeats_left > 0)
+    {
+        k_work_schedule(&start->repeat, K_MSEC(CONFIG_ROBOT_CONFIG_CLIENT_START_INTERVAL_MS));
+    }
+    return err;
+}
+
+BUILD_ASSERT(3 + ROBOT_PARAMS_SET_MSG_LEN(ROBOT_PARAMS_STEPS_MAX) + BT_MESH_MIC_SHORT <= BT_MESH_TX_SDU_MAX,
+             "The longest parameter set takes more segments than CONFIG_BT_MESH_TX_SEG_MAX");
+
+/* Called when the send queue hands the parameter set to the mesh stack. */
+static void params_send_start(uint16_t duration, int err, void *cb_data)
+{
+    struct bt_mesh_robot_config_cli_params *params = cb_data;
+
+    params->sent_ms = k_uptime_get();
+}
+
+/* Called when every segment of a parameter set was acknowledged by the robot, or sending failed. */
+static void params_sent(int err, void *cb_data)
+{
+    struct bt_mesh_robot_config_cli_params *params = cb_data;
+
+    params->transfer_ms = err ? -1 : k_uptime_get() - params->sent_ms;
+}
+
+static const struct bt_mesh_send_cb params_send_cb = {
+    .start = params_send_start,
+    .end = params_sent,
+};
+
+static int params_send(struct bt_mesh_robot_config_cli *config_client)
+{
+    struct bt_mesh_robot_config_cli_params *params = &config_client->params;
+    bool retransmit = params->attempts > 0;
+    uint8_t ttl = retransmit ? bt_mesh_default_ttl_get() : ttl_get(config_client, params->addr);
     struct bt_mesh_msg_ctx ctx =
         {
-            .addr = address,
+            .addr = params->addr,
             .app_idx = config_client->model->keys[0],
-            .send_ttl = BT_MESH_TTL_DEFAULT,
+            .send_ttl = ttl,
             .send_rel = false,
         };
 
-    BT_MESH_MODEL_BUF_DEFINE(buf, OP_VND_ROBOT_CLEAR_TO_MOVE, 0);
-    bt_mesh_model_msg_init(&buf, OP_VND_ROBOT_CLEAR_TO_MOVE);
+    BT_MESH_MODEL_BUF_DEFINE(buf, OP_VND_ROBOT_PARAMS_SET, ROBOT_PARAMS_SET_MSG_LEN(ROBOT_PARAMS_STEPS_MAX));
+    bt_mesh_model_msg_init(&buf, OP_VND_ROBOT_PARAMS_SET);
+    net_buf_simple_add_u8(&buf, params->tid);
+    uint8_t *crc = net_buf_simple_add(&buf, sizeof(uint32_t));
+    size_t protected = buf.len;
+
+    net_buf_simple_add_be16(&buf, params->params.kp);
+    net_buf_simple_add_be16(&buf, params->params.ki);
+    net_buf_simple_add_be16(&buf, params->params.kd);
+    net_buf_simple_add_be16(&buf, params->params.trim_a);
+    net_buf_simple_add_be16(&buf, params->params.trim_b);
+    net_buf_simple_add_u8(&buf, params->params.step_count);
+    for (uint8_t i = 0; i < params->params.step_count; i++)
+    {
+        net_buf_simple_add_be32(&buf, params->params.steps[i].time);
+        net_buf_simple_add_be32(&buf, params->params.steps[i].angle);
+    }
+    sys_put_be32(crc32_ieee(&buf.data[protected], buf.len - protected), crc);
+
+    params->attempts++;
+    params->sent_ms = k_uptime_get();
+    params->transfer_ms = -1;
+    int err = mesh_send_queue_submit(config_client->model, &ctx, &buf, &params_send_cb, params,
+                                     MESH_SEND_CLASS_BULK, 0);
+    if (!err)
+    {
+        class_sent(config_client, ROBOT_CONFIG_CLI_CLASS_PARAMS, ttl, retransmit);
+    }
+    return err;
+}
+
+static void params_complete(struct bt_mesh_robot_config_cli *config_client, int err)
+{
+    struct bt_mesh_robot_config_cli_params *params = &config_client->params;
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+
+    if (!params->busy)
+    {
+        k_spin_unlock(&config_client->tx_lock, key);
+        return;
+    }
+    k_work_cancel_delayable(&params->timeout);
+    params->busy = false;
+    k_spin_unlock(&config_client->tx_lock, key);
 
-    return bt_mesh_model_send(config_client->model, &ctx, &buf, NULL, NULL);
+    if (params->cb != NULL)
+    {
+        params->cb(config_client, params->addr, err, params->user_data);
+    }
+}
+
+static void params_timeout(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct bt_mesh_robot_config_cli_params *params = CONTAINER_OF(dwork, struct bt_mesh_robot_config_cli_params, timeout);
+    struct bt_mesh_robot_config_cli *config_client = CONTAINER_OF(params, struct bt_mesh_robot_config_cli, params);
+
+    if (!params->busy)
+    {
+        return;
+    }
+    if (params->attempts > CONFIG_ROBOT_CONFIG_CLIENT_TX_RETRIES)
+    {
+        LOG_WRN("Robot 0x%04x did not acknowledge its parameters", params->addr);
+        params_complete(config_client, -ETIMEDOUT);
+        return;
+    }
+
+    int err = params_send(config_client);
+    if (err)
+    {
+        LOG_DBG("Failed to resend parameters to 0x%04x (err %d)", params->addr, err);
+    }
+    k_work_reschedule(&params->timeout, K_MSEC(CONFIG_ROBOT_CONFIG_CLIENT_PARAMS_TIMEOUT_MS));
+}
+
+int configure_robot_params_async(struct bt_mesh_robot_config_cli *config_client, uint16_t address,
+                                 const struct robot_params *params, bt_mesh_robot_config_cli_tx_cb_t cb,
+                                 void *user_data)
+{
+    struct bt_mesh_robot_config_cli_params *tx = &config_client->params;
+
+    if (!bt_mesh_is_provisioned())
+    {
+        LOG_ERR("Device not provisioned");
+        return -EAGAIN;
+    }
+    if (params->step_count > ROBOT_PARAMS_STEPS_MAX)
+    {
+        return -EINVAL;
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+    if (tx->busy)
+    {
+        k_spin_unlock(&config_client->tx_lock, key);
+        return -EBUSY;
+    }
+    /* Answers to the previous transaction no longer match. */
+    tx->tid++;
+    tx->busy = true;
+    k_spin_unlock(&config_client->tx_lock, key);
+
+    tx->params = *params;
+    tx->addr = address;
+    tx->cb = cb;
+    tx->user_data = user_data;
+    tx->attempts = 0;
+    tx->start_ms = k_uptime_get();
+
+    int err = params_send(config_client);
+    if (err && err != -ENOMEM)
+    {
+        LOG_ERR("Failed to send message (err %d)", err);
+        tx->busy = false;
+        return err;
+    }
+    k_work_reschedule(&tx->timeout, K_MSEC(CONFIG_ROBOT_CONFIG_CLIENT_PARAMS_TIMEOUT_MS));
+    return 0;
+}
+
+int configure_robot_params(struct bt_mesh_robot_config_cli *config_client, uint16_t address,
+                           const struct robot_params *params)
+{
+    struct movement_set_wait wait;
+
+    k_sem_init(&wait.done, 0, 1);
+    int err = configure_robot_params_async(config_client, address, params, movement_set_wait_done, &wait);
+    if (err)
+    {
+        return err;
+    }
+    k_sem_take(&wait.done, K_FOREVER);
+    return wait.err;
 }
 
 /* Received commands */
 static int handle_robot_movement_done_status(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx, struct net_buf_simple *buf)
 {
-    LOG_DBG("Movement done status received");
+    LOG_DBG("Movement done status received from 0x%04x", ctx->addr);
+    struct bt_mesh_robot_config_cli *config_client = model->user_data;
+    struct robot_movement_done_status_msg status;
+
+    robot_heard(config_client, ctx);
+    status.motor_a_rot = net_buf_simple_pull_le16(buf);
+    status.motor_b_rot = net_buf_simple_pull_le16(buf);
+    status.imu.rotation = net_buf_simple_pull_le16(buf);
+    status.imu.local_trans.x = net_buf_simple_pull_le16(buf);
+    status.imu.local_trans.y = net_buf_simple_pull_le16(buf);
+    status.imu.local_trans.z = net_buf_simple_pull_le16(buf);
+
+    if (config_client->handlers.movement_done != NULL)
+    {
+        config_client->handlers.movement_done(config_client, ctx->addr, &status);
+    }
     return 0;
 }
 
@@ -78,19 +918,151 @@ static int handle_robot_movement_set_status(struct bt_mesh_model *model, struct
 {
     LOG_DBG("Movement set status received");
     struct bt_mesh_robot_config_cli *config_client = model->user_data;
+    uint8_t status = net_buf_simple_pull_u8(buf);
+
+    config_client->airtime.status_pdus++;
+    robot_heard(config_client, ctx);
+
+    k_spinlock_key_t key = k_spin_lock(&config_client->tx_lock);
+    struct bt_mesh_robot_config_cli_tx *tx = tx_find(config_client, ctx->addr, OP_VND_ROBOT_MOVEMENT_SET_STATUS);
+    k_spin_unlock(&config_client->tx_lock, key);
+
+    if (tx == NULL)
+    {
+        /* Late acknowledgment of a resent message. */
+        LOG_DBG("No transaction for 0x%04x", ctx->addr);
+        return 0;
+    }
+    LOG_DBG("ACK received for movement set message");
+    /* Only the first attempt is known to be the one that was answered. */
+    robot_done(config_client, ctx->addr, true, tx->attempts == 1 ? k_uptime_get() - tx->start_ms : -1);
+    if (!status)
+    {
+        class_delivered(config_client, ROBOT_CONFIG_CLI_CLASS_CONFIG, tx->start_ms);
+    }
+    tx_complete(tx, status ? -EIO : 0);
+    return 0;
+}
+
+static int handle_robot_movement_set_multi_status(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx, struct net_buf_simple *buf)
+{
+    struct bt_mesh_robot_config_cli *config_client = model->user_data;
+    struct bt_mesh_robot_config_cli_multi *multi = &config_client->multi;
+    uint8_t tid = net_buf_simple_pull_u8(buf);
+    uint8_t status = net_buf_simple_pull_u8(buf);
+    bool done = true;
 
-    if (bt_mesh_msg_ack_ctx_match(&config_client->ack_ctx, OP_VND_ROBOT_MOVEMENT_SET_STATUS, ctx->addr, NULL))
+    LOG_DBG("Multicast movement set status received from 0x%04x", ctx->addr);
+    config_client->airtime.status_pdus++;
+    robot_heard(config_client, ctx);
+    if (!multi->busy || tid != multi->tid)
     {
-        bt_mesh_msg_ack_ctx_rx(&config_client->ack_ctx);
-        LOG_DBG("ACK received for movement set message");
+        return 0;
     }
 
-    // TODO: Inform rest of system
+    for (int i = 0; i < multi->count; i++)
+    {
+        if (multi->entries[i].addr == ctx->addr)
+        {
+            if (status)
+            {
+                LOG_WRN("Robot 0x%04x rejected its movement configuration: %u", ctx->addr, status);
+            }
+            else if (!atomic_test_and_set_bit(multi->acked, i))
+            {
+                class_delivered(config_client, ROBOT_CONFIG_CLI_CLASS_MULTI, multi->start_ms);
+                /* Robots answer one slot after another, so there is no round trip time. */
+                robot_done(config_client, ctx->addr, true, -1);
+            }
+        }
+        done = done && atomic_test_bit(multi->acked, i);
+    }
+
+    if (done)
+    {
+        multi_complete(config_client);
+    }
+    return 0;
+}
+
+static int handle_robot_params_status(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx, struct net_buf_simple *buf)
+{
+    struct bt_mesh_robot_config_cli *config_client = model->user_data;
+    struct bt_mesh_robot_config_cli_params *params = &config_client->params;
+    uint8_t tid = net_buf_simple_pull_u8(buf);
+    uint8_t status = net_buf_simple_pull_u8(buf);
+
+    LOG_DBG("Parameter set status received from 0x%04x", ctx->addr);
+    config_client->airtime.status_pdus++;
+    robot_heard(config_client, ctx);
+    if (!params->busy || tid != params->tid || ctx->addr != params->addr)
+    {
+        return 0;
+    }
+
+    switch (status)
+    {
+    case ROBOT_PARAMS_STATUS_OK:
+    {
+        size_t len = 3 + ROBOT_PARAMS_SET_MSG_LEN(params->params.step_count);
+        uint32_t segments = mesh_send_queue_pdus(len);
+
+        class_delivered(config_client, ROBOT_CONFIG_CLI_CLASS_PARAMS, params->start_ms);
+        /* The segments of the attempt that was answered are known to have been acknowledged
+         * in time, if the transport reported back already.
+         */
+        if (params->transfer_ms > 0)
+        {
+            config_client->params_stats.bytes += len;
+            config_client->params_stats.segments += segments;
+            config_client->params_stats.transfer_ms += params->transfer_ms;
+            LOG_INF("Parameters to 0x%04x: %zu bytes in %u segments, transfer %d ms (%zu B/s), %u attempts",
+                    ctx->addr, len, segments, params->transfer_ms, len * 1000 / params->transfer_ms,
+                    params->attempts);
+        }
+        params_complete(config_client, 0);
+        break;
+    }
+    case ROBOT_PARAMS_STATUS_CRC_MISMATCH:
+    {
+        LOG_WRN("Robot 0x%04x got parameters with a CRC mismatch", ctx->addr);
+        config_client->params_stats.crc_mismatches++;
+        /* Resent right away, unless the retries are spent. */
+        k_work_reschedule(&params->timeout, K_NO_WAIT);
+        break;
+    }
+    default:
+    {
+        LOG_WRN("Robot 0x%04x rejected its parameters: %u", ctx->addr, status);
+        params_complete(config_client, -EIO);
+        break;
+    }
+    }
     return 0;
 }
 
 /* Model callbacks */
-const struct bt_mesh_model_cb robot_config_cli_cb;
+static int robot_config_cli_init(struct bt_mesh_model *model)
+{
+    struct bt_mesh_robot_config_cli *config_client = model->user_data;
+
+    for (int i = 0; i < ARRAY_SIZE(config_client->txs); i++)
+    {
+        config_client->txs[i].config_client = config_client;
+        k_work_init_delayable(&config_client->txs[i].timeout, tx_timeout);
+    }
+    k_work_init_delayable(&config_client->multi.timeout, multi_timeout);
+    k_work_init_delayable(&config_client->start.repeat, clear_to_move_repeat);
+    k_work_init_delayable(&config_client->params.timeout, params_timeout);
+#if defined(CONFIG_ROBOT_CONFIG_CLIENT_AIRTIME_COMPARE)
+    airtime_compare_log();
+#endif
+    return 0;
+}
+
+const struct bt_mesh_model_cb robot_config_cli_cb = {
+    .init = robot_config_cli_init,
+};
 
 /* Model operations */
 const struct bt_mesh_model_op robot_config_cli_ops[] = {
@@ -104,5 +1076,15 @@ const struct bt_mesh_model_op robot_config_cli_ops[] = {
         sizeof(struct robot_movement_set_status_msg),
         handle_robot_movement_set_status,
     },
+    {
+        OP_VND_ROBOT_MOVEMENT_SET_MULTI_STATUS,
+        sizeof(struct robot_movement_set_multi_status_msg),
+        handle_robot_movement_set_multi_status,
+    },
+    {
+        OP_VND_ROBOT_PARAMS_STATUS,
+        sizeof(struct robot_params_status_msg),
+        handle_robot_params_status,
+    },
     BT_MESH_MODEL_OP_END,
 };
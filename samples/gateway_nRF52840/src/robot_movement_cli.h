@@ -3,12 +3,188 @@
 #include <zephyr/bluetooth/mesh.h>
 #include <bluetooth/mesh/model_types.h>
 #include "../../common/mesh_model_defines/robot_movement_srv.h"
+#include "../../common/mesh_model_defines/robot_movement_cli.h"
 
 // Defined in model_handler.c
 extern const struct bt_mesh_model_op robot_config_cli_ops[];
 extern const struct bt_mesh_model_cb robot_config_cli_cb;
 
+struct bt_mesh_robot_config_cli;
+
 struct bt_mesh_robot_config_cli_handlers {
+    /** Called in the mesh receive context when a robot reports that its movement is done. */
+    void (*movement_done)(struct bt_mesh_robot_config_cli *config_client, uint16_t addr,
+                                const struct robot_movement_done_status_msg *status);
+};
+
+/**
+ * @brief Called when an acknowledged transaction completes.
+ *
+ * Runs in the mesh receive context when the status arrives, or in the system work queue when
+ * the transaction times out.
+ *
+ * @param config_client The robot configuration client the transaction was sent from.
+ * @param addr Address of the robot.
+ * @param err 0 if the robot acknowledged, -ETIMEDOUT if it never did, -EIO if it reported an
+ *            error, otherwise the error of the last send.
+ * @param user_data User data given when the transaction was started.
+ */
+typedef void (*bt_mesh_robot_config_cli_tx_cb_t)(struct bt_mesh_robot_config_cli *config_client,
+                                                 uint16_t addr, int err, void *user_data);
+
+/* An acknowledged message in flight, keyed by the robot address and the status opcode. */
+struct bt_mesh_robot_config_cli_tx
+{
+    struct bt_mesh_robot_config_cli *config_client;
+    struct k_work_delayable timeout;
+    bt_mesh_robot_config_cli_tx_cb_t cb;
+    void *user_data;
+    struct robot_movement_set_msg msg;
+    int64_t start_ms;
+    uint32_t status_op;
+    uint16_t addr;
+    uint8_t attempts;
+    bool busy;
+};
+
+/**
+ * @brief Called when a multicast movement set completes.
+ *
+ * Runs in the mesh receive context when the last robot acknowledged, or in the system work queue
+ * when the transaction times out.
+ *
+ * @param config_client The robot configuration client the transaction was sent from.
+ * @param entries Movement configurations that were sent.
+ * @param count Number of entries.
+ * @param acked Bit i is set if the robot of entry i acknowledged.
+ * @param user_data User data given when the transaction was started.
+ */
+typedef void (*bt_mesh_robot_config_cli_multi_cb_t)(struct bt_mesh_robot_config_cli *config_client,
+                                                    const struct robot_movement_set_multi_entry *entries,
+                                                    uint8_t count, const atomic_t *acked, void *user_data);
+
+/* A multicast movement set in flight. Entries not acknowledged in time are sent again. */
+struct bt_mesh_robot_config_cli_multi
+{
+    struct k_work_delayable timeout;
+    bt_mesh_robot_config_cli_multi_cb_t cb;
+    void *user_data;
+    struct robot_movement_set_multi_entry entries[CONFIG_ROBOT_CONFIG_CLIENT_TX_COUNT];
+    ATOMIC_DEFINE(acked, CONFIG_ROBOT_CONFIG_CLIENT_TX_COUNT);
+    int64_t start_ms;
+    uint16_t dst;
+    uint8_t count;
+    uint8_t tid;
+    uint8_t attempts;
+    bool busy;
+};
+
+/* A clear to move being repeated until its start time. */
+struct bt_mesh_robot_config_cli_start
+{
+    struct k_work_delayable repeat;
+    uint32_t start_ms;
+    uint16_t addr;
+    uint8_t repeats_left;
+};
+
+/* A parameter set in flight. It goes out as one segmented message, which is resent whole if the
+ * robot does not acknowledge it in time or finds that its CRC does not match.
+ */
+struct bt_mesh_robot_config_cli_params
+{
+    struct k_work_delayable timeout;
+    bt_mesh_robot_config_cli_tx_cb_t cb;
+    void *user_data;
+    struct robot_params params;
+    int64_t start_ms;
+    /* Uptime the last attempt was sent at, and how long its segments took to be acknowledged. */
+    int64_t sent_ms;
+    int32_t transfer_ms;
+    uint16_t addr;
+    uint8_t tid;
+    uint8_t attempts;
+    bool busy;
+};
+
+/* Bytes of delivered parameter sets and the time their segments took, for the throughput. */
+struct bt_mesh_robot_config_cli_params_stats
+{
+    uint32_t bytes;
+    uint32_t segments;
+    uint32_t transfer_ms;
+    uint32_t crc_mismatches;
+};
+
+/* Access messages and network PDUs sent and received by the client, to compare the airtime of
+ * unicast and multicast movement configuration.
+ */
+struct bt_mesh_robot_config_cli_airtime
+{
+    uint32_t unicast_msgs;
+    uint32_t unicast_pdus;
+    uint32_t multicast_msgs;
+    uint32_t multicast_pdus;
+    uint32_t status_pdus;
+};
+
+/* Round trip times of movement configurations are counted in bins. Bin i holds the ones shorter
+ * than ROBOT_CONFIG_CLI_RTT_BIN_MS << i that did not fit in an earlier bin, the last bin holds
+ * the rest.
+ */
+#define ROBOT_CONFIG_CLI_RTT_BINS 8
+#define ROBOT_CONFIG_CLI_RTT_BIN_MS 25
+
+/* What the client knows of a robot. The relay hops are learned from the TTL its messages arrive
+ * with. Movement configurations are counted whether they were sent unicast or multicast, round
+ * trip times are only taken of unicast ones that were acknowledged at the first attempt, as an
+ * acknowledgment of a resent message could answer any of the copies.
+ */
+struct bt_mesh_robot_config_cli_robot
+{
+    /* Uptime of the last message from the robot, 0 if none arrived yet. */
+    int64_t seen_ms;
+    /* Uptime of the last message to or from the robot, the least recently used entry is reused. */
+    int64_t used_ms;
+    uint32_t sent;
+    uint32_t acked;
+    uint32_t timeouts;
+    uint32_t retries;
+    uint32_t rtt_bins[ROBOT_CONFIG_CLI_RTT_BINS];
+    uint16_t addr;
+    int8_t rssi;
+    uint8_t ttl;
+    uint8_t hops;
+};
+
+/* Messages are sent in classes that are retransmitted differently. */
+enum bt_mesh_robot_config_cli_class
+{
+    /* Unicast movement configuration, resent until acknowledged. */
+    ROBOT_CONFIG_CLI_CLASS_CONFIG,
+    /* Multicast movement configuration, resent for the robots that did not acknowledge. */
+    ROBOT_CONFIG_CLI_CLASS_MULTI,
+    /* Clear to move, repeated a fixed number of times. */
+    ROBOT_CONFIG_CLI_CLASS_START,
+    /* Parameter set, one segmented message resent until acknowledged. */
+    ROBOT_CONFIG_CLI_CLASS_PARAMS,
+    ROBOT_CONFIG_CLI_CLASS_COUNT,
+};
+
+/* How the messages of a class were sent and how long they took to be acknowledged. The relay
+ * radius is the number of relay hops the TTL allows, summed over the messages, next to what the
+ * default TTL would have allowed.
+ */
+struct bt_mesh_robot_config_cli_class_stats
+{
+    uint32_t msgs;
+    uint32_t retransmits;
+    uint32_t reduced_ttl;
+    uint32_t relay_radius;
+    uint32_t relay_radius_default;
+    uint32_t delivered;
+    uint32_t latency_total_ms;
+    uint32_t latency_max_ms;
 };
 
 struct bt_mesh_robot_config_cli
@@ -16,9 +192,19 @@ struct bt_mesh_robot_config_cli
     struct bt_mesh_model *model;
     struct bt_mesh_model_pub pub;
     struct net_buf_simple pub_msg;
-    uint8_t buf[BT_MESH_MODEL_BUF_LEN(OP_VND_ROBOT_CLEAR_TO_MOVE, 0)];
+    uint8_t buf[BT_MESH_MODEL_BUF_LEN(OP_VND_ROBOT_CLEAR_TO_MOVE, ROBOT_CLEAR_TO_MOVE_MSG_LEN)];
     struct bt_mesh_robot_config_cli_handlers handlers;
-    struct bt_mesh_msg_ack_ctx ack_ctx;
+    struct k_spinlock tx_lock;
+    struct bt_mesh_robot_config_cli_tx txs[CONFIG_ROBOT_CONFIG_CLIENT_TX_COUNT];
+    struct bt_mesh_robot_config_cli_multi multi;
+    struct bt_mesh_robot_config_cli_start start;
+    struct bt_mesh_robot_config_cli_params params;
+    struct bt_mesh_robot_config_cli_params_stats params_stats;
+    struct bt_mesh_robot_config_cli_airtime airtime;
+    struct bt_mesh_robot_config_cli_robot robots[CONFIG_ROBOT_CONFIG_CLIENT_ROBOT_TABLE_SIZE];
+    /* Set once a robot was forgotten to make room for another one. */
+    bool robots_forgotten;
+    struct bt_mesh_robot_config_cli_class_stats stats[ROBOT_CONFIG_CLI_CLASS_COUNT];
 };
 
 #define BT_MESH_MODEL_VND_ROBOT_CONFIG_CLI(_robot_config_cli)                        \
@@ -31,7 +217,30 @@ struct bt_mesh_robot_config_cli
         &robot_config_cli_cb)
 
 /**
- * @brief Configure the next movement for a robot.
+ * @brief Start configuring the next movement for a robot.
+ *
+ * Returns as soon as the configuration is sent. The message is sent again if the robot does not
+ * acknowledge it in time, and the callback is called once the transaction completes. Any number
+ * of robots can be configured at once, up to CONFIG_ROBOT_CONFIG_CLIENT_TX_COUNT.
+ *
+ * The first attempt goes out with just the TTL the robot was last seen to need, the retransmits
+ * with the default TTL in case the robot moved away.
+ *
+ * @param config_client The robot configuration client to send from
+ * @param address Address of robot to configure.
+ * @param msg Movement configuration
+ * @param cb Called when the robot acknowledged the configuration or the transaction failed.
+ * @param user_data Passed to the callback.
+ * @return 0 if the transaction was started, -EALREADY if the robot is being configured already,
+ *         -ENOMEM if too many transactions are in flight, other negative error codes otherwise.
+ *         The callback is only called if the transaction was started.
+ */
+int configure_robot_movement_async(struct bt_mesh_robot_config_cli *config_client, uint16_t address,
+                                   struct robot_movement_set_msg msg, bt_mesh_robot_config_cli_tx_cb_t cb,
+                                   void *user_data);
+
+/**
+ * @brief Configure the next movement for a robot and wait for it to acknowledge.
  *
  * @param config_client The robot configuration client to send from
  * @param address Address of robot to configure.
@@ -41,7 +250,85 @@ struct bt_mesh_robot_config_cli
 int configure_robot_movement(struct bt_mesh_robot_config_cli *config_client, uint16_t address, struct robot_movement_set_msg msg);
 
 /**
- * @brief Signal a robot that it should start moving.
+ * @brief Configure the next movement for many robots with multicast messages.
+ *
+ * The configurations are packed into as few OP_VND_ROBOT_MOVEMENT_SET_MULTI messages as possible
+ * and sent to the given address. Every robot acknowledges its own entry. Entries that are not
+ * acknowledged in time are sent again, and the callback is called when all robots acknowledged
+ * or the retries are spent. Only one multicast movement set can be in flight.
+ *
+ * @param config_client The robot configuration client to send from
+ * @param dst Group or broadcast address the robots listen to.
+ * @param entries Movement configurations, at most CONFIG_ROBOT_CONFIG_CLIENT_TX_COUNT.
+ * @param count Number of entries.
+ * @param cb Called when the transaction completes.
+ * @param user_data Passed to the callback.
+ * @return 0 if the transaction was started, -EBUSY if another one is in flight, other negative
+ *         error codes otherwise. The callback is only called if the transaction was started.
+ */
+int configure_robot_movement_multi(struct bt_mesh_robot_config_cli *config_client, uint16_t dst,
+                                   const struct robot_movement_set_multi_entry *entries, uint8_t count,
+                                   bt_mesh_robot_config_cli_multi_cb_t cb, void *user_data);
+
+/**
+ * @brief Start sending the movement parameters and script of a robot.
+ *
+ * Everything goes in one segmented message with a CRC, which the robot checks before it applies
+ * the parameters. The message is sent again if the robot does not acknowledge it in time or
+ * reports a CRC mismatch, and the callback is called once the transaction completes. Only one
+ * parameter set can be in flight.
+ *
+ * @param config_client The robot configuration client to send from
+ * @param address Address of robot to configure.
+ * @param params Parameters and script, at most ROBOT_PARAMS_STEPS_MAX steps.
+ * @param cb Called when the robot acknowledged the parameters or the transaction failed.
+ * @param user_data Passed to the callback.
+ * @return 0 if the transaction was started, -EBUSY if another one is in flight, other negative
+ *         error codes otherwise. The callback is only called if the transaction was started.
+ */
+int configure_robot_params_async(struct bt_mesh_robot_config_cli *config_client, uint16_t address,
+                                 const struct robot_params *params, bt_mesh_robot_config_cli_tx_cb_t cb,
+                                 void *user_data);
+
+/**
+ * @brief Send the movement parameters and script of a robot and wait for it to acknowledge.
+ *
+ * @param config_client The robot configuration client to send from
+ * @param address Address of robot to configure.
+ * @param params Parameters and script.
+ * @return 0 on success, negative error code otherwise.
+ */
+int configure_robot_params(struct bt_mesh_robot_config_cli *config_client, uint16_t address,
+                           const struct robot_params *params);
+
+/**
+ * @brief Log the messages and PDUs sent for movement configuration, with an airtime estimate, the
+ *        relay radius, retransmits and delivery latency of every message class, and the
+ *        throughput of parameter sets.
+ *
+ * @param config_client The robot configuration client.
+ */
+void robot_config_cli_airtime_log(struct bt_mesh_robot_config_cli *config_client);
+
+/**
+ * @brief Get what the client knows of the robots, for as many robots as fit.
+ *
+ * @param config_client The robot configuration client.
+ * @param robots Filled with the robots, in no particular order.
+ * @param max Number of robots that fit.
+ * @return Number of robots filled in.
+ */
+size_t robot_config_cli_robots_get(struct bt_mesh_robot_config_cli *config_client,
+                                   struct bt_mesh_robot_config_cli_robot *robots, size_t max);
+
+/**
+ * @brief Signal robots that they should start moving.
+ *
+ * The robots start CONFIG_ROBOT_CONFIG_CLIENT_START_DELAY_MS from now, all at the same time.
+ * The message is sent CONFIG_ROBOT_CONFIG_CLIENT_START_REPEATS times before then, so that a
+ * robot that misses one copy still starts on time.
+ *
+ * Sent to a group address, the TTL reaches the farthest robot that answered recently.
  *
  * @param config_client The robot configuration client to send from
  * @param address Address of robot to configure.
@@ -0,0 +1,94 @@
+
+#include <zephyr.h>
+#include <zephyr/bluetooth/mesh.h>
+#include "./time_sync_srv.h"
+#include "./mesh_send_queue.h"
+
+#define MODULE time_sync_server
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE, CONFIG_TIME_SYNC_SERVER_LOG_LEVEL);
+
+uint64_t time_sync_srv_now_us(void)
+{
+    return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+/* Called when the beacon goes on air, which is the moment its time refers to. */
+static void beacon_send_start(uint16_t duration, int err, void *cb_data)
+{
+    struct bt_mesh_time_sync_srv *time_sync_srv = cb_data;
+
+    if (err)
+    {
+        time_sync_srv->last_tx_valid = false;
+        return;
+    }
+    time_sync_srv->last_tx_us = time_sync_srv_now_us();
+    time_sync_srv->last_tx_seq = time_sync_srv->seq;
+    time_sync_srv->last_tx_valid = true;
+}
+
+static const struct bt_mesh_send_cb beacon_send_cb = {
+    .start = beacon_send_start,
+};
+
+static void beacon_send(struct k_work *work)
+{
+    struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+    struct bt_mesh_time_sync_srv *time_sync_srv = CONTAINER_OF(dwork, struct bt_mesh_time_sync_srv, beacon_work);
+
+    k_work_schedule(dwork, K_MSEC(CONFIG_TIME_SYNC_SRV_PERIOD_MS));
+    if (!bt_mesh_is_provisioned())
+    {
+        return;
+    }
+
+    uint8_t ttl = bt_mesh_default_ttl_get();
+    struct bt_mesh_msg_ctx ctx =
+        {
+            .addr = BT_MESH_ADDR_ALL_NODES,
+            .app_idx = time_sync_srv->model->keys[0],
+            .send_ttl = ttl,
+            .send_rel = false,
+        };
+    bool prev_valid = time_sync_srv->last_tx_valid && time_sync_srv->last_tx_seq == time_sync_srv->seq;
+
+    time_sync_srv->seq++;
+    BT_MESH_MODEL_BUF_DEFINE(buf, OP_VND_TIME_SYNC_BEACON, TIME_SYNC_BEACON_MSG_LEN);
+    bt_mesh_model_msg_init(&buf, OP_VND_TIME_SYNC_BEACON);
+    net_buf_simple_add_u8(&buf, time_sync_srv->seq);
+    net_buf_simple_add_u8(&buf, ttl);
+    net_buf_simple_add_be48(&buf, prev_valid ? time_sync_srv->last_tx_us : 0);
+
+    time_sync_srv->last_tx_valid = false;
+    /* The timestamp is taken when the beacon goes on air, so waiting in the queue does not skew
+     * it. A beacon still waiting when the next one is due is dropped.
+     */
+    int err = mesh_send_queue_submit(time_sync_srv->model, &ctx, &buf, &beacon_send_cb, time_sync_srv,
+                                     MESH_SEND_CLASS_CONFIG, k_uptime_get() + CONFIG_TIME_SYNC_SRV_PERIOD_MS);
+    if (err)
+    {
+        LOG_WRN("Failed to send time beacon (err %d)", err);
+    }
+}
+
+/* Model callbacks */
+static int time_sync_srv_init(struct bt_mesh_model *model)
+{
+    struct bt_mesh_time_sync_srv *time_sync_srv = model->user_data;
+
+    time_sync_srv->model = model;
+    k_work_init_delayable(&time_sync_srv->beacon_work, beacon_send);
+    k_work_schedule(&time_sync_srv->beacon_work, K_MSEC(CONFIG_TIME_SYNC_SRV_PERIOD_MS));
+    return 0;
+}
+
+const struct bt_mesh_model_cb time_sync_srv_cb = {
+    .init = time_sync_srv_init,
+};
+
+/* Model operations */
+const struct bt_mesh_model_op time_sync_srv_ops[] = {
+    BT_MESH_MODEL_OP_END,
+};
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <zephyr/bluetooth/mesh.h>
+#include "../../common/mesh_model_defines/time_sync.h"
+
+// Defined in time_sync_srv.c
+extern const struct bt_mesh_model_op time_sync_srv_ops[];
+extern const struct bt_mesh_model_cb time_sync_srv_cb;
+
+/* Sends a time beacon to all robots every CONFIG_TIME_SYNC_SRV_PERIOD_MS. */
+struct bt_mesh_time_sync_srv
+{
+    struct bt_mesh_model *model;
+    struct k_work_delayable beacon_work;
+    uint64_t last_tx_us;
+    uint8_t last_tx_seq;
+    uint8_t seq;
+    bool last_tx_valid;
+};
+
+#define BT_MESH_MODEL_VND_TIME_SYNC_SRV(_time_sync_srv)                            \
+    BT_MESH_MODEL_VND_CB(                                                          \
+        CONFIG_BT_COMPANY_ID,                                                      \
+        TIME_SYNC_SRV_MODEL_ID,                                                    \
+        time_sync_srv_ops,                                                         \
+        NULL,                                                                      \
+        BT_MESH_MODEL_USER_DATA(struct bt_mesh_time_sync_srv, _time_sync_srv),     \
+        &time_sync_srv_cb)
+
+/**
+ * @brief Get the time of the gateway, the time base the robots synchronize to.
+ *
+ * @return Uptime in microseconds.
+ */
+uint64_t time_sync_srv_now_us(void);
@@ -2,7 +2,16 @@
 #include <zephyr/drivers/uart.h>
 
 #include "./robot_movement_cli.h"
+#include "./mesh_send_queue.h"
 #include "uart_handler.h"
+#include "uart_codec.h"
+#include "uart_frame.h"
+#include "uart_tx_queue.h"
+#include "uart_request.h"
+#include "uart_rx.h"
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+#include "provisioner.h"
+#endif
 
 #define MODULE uart
 
@@ -11,189 +20,236 @@ LOG_MODULE_REGISTER(MODULE, CONFIG_UART_MODULE_LOG_LEVEL);
 
 struct uart_thread_msg
 {
-	struct device *uart_dev;
 	struct bt_mesh_robot_config_cli *config_client;
 	union mesh_uart_msg msg;
 };
-K_MSGQ_DEFINE(uart_msg_queue, sizeof(struct uart_thread_msg), 4, 4);
+/* Room for a full window of requests, and a retransmission of each. */
+K_MSGQ_DEFINE(uart_msg_queue, sizeof(struct uart_thread_msg), 2 * MESH_UART_REQUEST_WINDOW, 4);
 
 K_MEM_SLAB_DEFINE_STATIC(mesh_uart_rx_slab, CONFIG_MESH_UART_RX_BUF_SIZE, CONFIG_MESH_UART_RX_BUF_COUNT, 4);
 
-static int uart_data_rx_rdy_handler(const struct device *dev, struct uart_event_rx event_data, struct bt_mesh_robot_config_cli *config_client)
+/* Context handed to the frame handler. */
+struct uart_rx_context
 {
-	static union mesh_uart_msg msg;
-	static size_t current_msg_len = 0; // Length of currently received fragment
+	struct bt_mesh_robot_config_cli *config_client;
+};
+static struct uart_rx_context rx_context;
+static struct mesh_uart_frame_parser uart_frame_parser;
+static struct mesh_uart_rx uart_rx;
+static uint8_t uart_rx_ring_buf[CONFIG_MESH_UART_RX_RING_SIZE];
 
-	uint8_t *msg_fill_start = ((uint8_t *)&msg) + current_msg_len;
-	memcpy(msg_fill_start, (event_data.buf + event_data.offset), event_data.len);
-	current_msg_len += event_data.len;
+/* Called by the frame parser for every frame that passed the length and CRC checks. */
+static void uart_frame_handler(const uint8_t *payload, size_t len, void *user_data)
+{
+	struct uart_rx_context *context = (struct uart_rx_context *)user_data;
+	static struct uart_thread_msg thread_msg; // Prepare message for message queue. Kept off the stack.
 
-	LOG_DBG("Message fragment received: length: %d offset: %d", event_data.len, event_data.offset);
-	if (current_msg_len < sizeof(msg.header))
+	int err = mesh_uart_msg_decode(payload, len, &thread_msg.msg);
+	if (err)
 	{
-		return 0; // Header not yet received. Keep waiting for more data.
+		LOG_WRN("Dropping invalid message of length %d: %d", len, err);
+		return;
 	}
 
-	struct uart_thread_msg thread_msg; // Prepare message for message queue
-	thread_msg.uart_dev = dev;
-	thread_msg.config_client = config_client;
-	thread_msg.msg = msg;
+	LOG_DBG("Got message with type %d", thread_msg.msg.header.type);
+	thread_msg.config_client = context->config_client;
 
-	LOG_DBG("Got message with type %d", msg.header.type);
-	switch (msg.header.type)
-	{
-	case HELLO:
-	{
-		if (current_msg_len < sizeof(msg.hello))
-		{
-			return 0; // Message not complete. Keep waiting for more data.
-		}
-		LOG_DBG("UART \"HELLO\" received");
-		int err = k_msgq_put(&uart_msg_queue, &thread_msg, K_NO_WAIT);
-		if (err)
-		{
-			LOG_ERR("Failed to enqueue message: Error %d", err);
-		}
-		break;
-	}
-	case CLEAR_TO_MOVE:
-	{
-		if (current_msg_len < sizeof(msg.clear_to_move))
-		{
-			return 0; // Message not complete. Keep waiting for more data.
-		}
-		LOG_DBG("UART \"CLEAR_TO_MOVE\" received");
-		int err = k_msgq_put(&uart_msg_queue, &thread_msg, K_NO_WAIT);
-		if (err)
-		{
-			LOG_ERR("Failed to enqueue message: Error %d", err);
-		}
-		break;
-	}
-	case SET_MOVEMENT_CONFIG:
-	{
-		if (current_msg_len < sizeof(msg.set_movement_config))
-		{
-			return 0; // Message not complete. Keep waiting for more data.
-		}
-		LOG_DBG("UART \"SET_MOVEMENT_CONFIG\" received");
-		int err = k_msgq_put(&uart_msg_queue, &thread_msg, K_NO_WAIT);
-		if (err)
-		{
-			LOG_ERR("Failed to enqueue message: Error %d", err);
-		}
-		break;
-	}
-	default:
+	err = k_msgq_put(&uart_msg_queue, &thread_msg, K_NO_WAIT);
+	if (err)
 	{
-		LOG_ERR("Unknown message type %d", msg.header.type);
-		current_msg_len = 0;
-		return -EINVAL;
+		LOG_ERR("Failed to enqueue message: Error %d", err);
 	}
-	}
-	current_msg_len = 0;
+}
 
-	return 0;
+/* Parses the bytes received by the UART interrupt. Frames are handed on to the UART thread, which
+ * blocks on mesh acknowledgements while the parser keeps draining the UART.
+ */
+static void uart_rx_thread_fn(void)
+{
+	mesh_uart_rx_thread_run(&uart_rx);
 }
 
-static K_SEM_DEFINE(uart_tx_sem, 1, 1);
-static int mesh_uart_send(const struct device *dev, void *data, size_t len, k_timeout_t timeout)
+K_THREAD_DEFINE(uart_rx_thread, CONFIG_UART_RX_THREAD_STACK_SIZE, uart_rx_thread_fn, NULL, NULL, NULL, CONFIG_UART_RX_THREAD_PRIORITY, 0, SYS_FOREVER_MS);
+
+static struct mesh_uart_tx_queue uart_tx_queue;
+
+static int mesh_uart_send(const void *data, size_t len)
 {
-	int err = k_sem_take(&uart_tx_sem, timeout);
-	if (err)
-	{
-		LOG_ERR("Failed to take semaphore: Error %d", err);
-		return err;
-	}
-	err = uart_tx(dev, data, len, SYS_FOREVER_US);
+	int err = mesh_uart_tx_queue_send(&uart_tx_queue, data, len, NULL, NULL);
 	if (err)
 	{
 		LOG_ERR("Failed to send data: Error %d", err);
-		return err;
 	}
-	return 0;
+	return err;
 }
 
-static int mesh_uart_send_status(const struct device *dev, int status, k_timeout_t timeout)
+static int mesh_uart_send_status(uint8_t seq, int status)
 {
-	static struct mesh_uart_status_msg msg;
+	struct mesh_uart_status_msg msg;
 	msg.header.type = STATUS;
+	msg.header.seq = seq;
 	msg.data.status = status;
-	return mesh_uart_send(dev, &msg, sizeof(msg), timeout);
+	return mesh_uart_send(&msg, sizeof(msg));
 }
 
-static int mesh_uart_send_hello(const struct device *dev, uint16_t echo, k_timeout_t timeout)
+static int mesh_uart_send_hello(uint8_t seq, uint16_t echo)
 {
-	static struct mesh_uart_hello_msg msg;
+	struct mesh_uart_hello_msg msg;
 	msg.header.type = HELLO;
+	msg.header.seq = seq;
 	msg.echo = echo;
-	return mesh_uart_send(dev, &msg, sizeof(msg), timeout);
+	msg.baudrate_max = CONFIG_MESH_UART_BAUDRATE_MAX;
+	msg.version_min = MESH_UART_PROTOCOL_VERSION_MIN;
+	msg.version_max = MESH_UART_PROTOCOL_VERSION;
+	return mesh_uart_send(&msg, sizeof(msg));
 }
 
-static int mesh_uart_send_movement_config_accepted(const struct device *dev, struct mesh_uart_movement_config config, k_timeout_t timeout)
+static int mesh_uart_send_robot_added(uint16_t addr, const uint8_t uuid[16])
 {
-	static struct mesh_uart_movement_config_accepted_msg msg;
+	struct mesh_uart_robot_added_msg msg;
+	msg.header.type = ROBOT_ADDED;
+	msg.header.seq = MESH_UART_SEQ_NONE;
+	msg.data.addr = addr;
+	/* Robots have no MAC address in their beacons, the start of the UUID is their hardware ID. */
+	memcpy(msg.data.mac_address, uuid, sizeof(msg.data.mac_address));
+	msg.data.mesh_address = addr;
+	return mesh_uart_send(&msg, sizeof(msg));
+}
+
+void uart_robot_added(uint16_t addr, const uint8_t uuid[16])
+{
+	int err = mesh_uart_send_robot_added(addr, uuid);
+	if (err)
+	{
+		LOG_WRN("Failed to report robot 0x%04x: Error %d", addr, err);
+	}
+}
+
+static int mesh_uart_send_movement_config_accepted(uint8_t seq, struct mesh_uart_movement_config config)
+{
+	struct mesh_uart_movement_config_accepted_msg msg;
 	msg.header.type = MOVEMENT_CONFIG_ACCEPTED;
+	msg.header.seq = seq;
 	msg.data = config;
-	return mesh_uart_send(dev, &msg, sizeof(msg), timeout);
+	return mesh_uart_send(&msg, sizeof(msg));
+}
+
+static int mesh_uart_send_movement_config_accepted_batch(uint8_t seq, struct mesh_uart_movement_config_batch_msg *msg)
+{
+	msg->header.type = MOVEMENT_CONFIG_ACCEPTED_BATCH;
+	msg->header.seq = seq;
+	return mesh_uart_send(msg, MESH_UART_MOVEMENT_CONFIG_BATCH_LEN(msg->count));
+}
+
+/* Movement reports. Robots report in when their movement is done, all at about the same time.
+ * Reports that arrive within CONFIG_MESH_UART_MOVEMENT_REPORT_WINDOW_MS of each other are sent to
+ * the gateway in one frame, a full batch is sent at once.
+ */
+static struct k_spinlock movement_report_lock;
+static struct mesh_uart_movement_reported_batch_msg movement_report_batch;
+static uint32_t movement_reports_sent;
+static uint32_t movement_reports_dropped;
+
+static void movement_report_flush(void)
+{
+	struct mesh_uart_movement_reported_batch_msg msg;
+
+	k_spinlock_key_t key = k_spin_lock(&movement_report_lock);
+	memcpy(&msg, &movement_report_batch, MESH_UART_MOVEMENT_REPORTED_BATCH_LEN(movement_report_batch.count));
+	movement_report_batch.count = 0;
+	k_spin_unlock(&movement_report_lock, key);
+
+	if (msg.count == 0)
+	{
+		return;
+	}
+
+	msg.header.type = MOVEMENT_REPORTED_BATCH;
+	msg.header.seq = MESH_UART_SEQ_NONE;
+	if (mesh_uart_send(&msg, MESH_UART_MOVEMENT_REPORTED_BATCH_LEN(msg.count)))
+	{
+		movement_reports_dropped += msg.count;
+		return;
+	}
+	movement_reports_sent += msg.count;
+}
+
+static void movement_report_work_fn(struct k_work *work)
+{
+	movement_report_flush();
+}
+
+static K_WORK_DELAYABLE_DEFINE(movement_report_work, movement_report_work_fn);
+
+static void movement_done_handler(struct bt_mesh_robot_config_cli *config_client, uint16_t addr,
+				  const struct robot_movement_done_status_msg *status)
+{
+	bool full;
+
+	k_spinlock_key_t key = k_spin_lock(&movement_report_lock);
+	struct mesh_uart_movement_reported_data *report =
+		&movement_report_batch.reports[movement_report_batch.count++];
+	report->addr = addr;
+	report->x = status->imu.local_trans.x;
+	report->y = status->imu.local_trans.y;
+	report->yaw = status->imu.rotation;
+	full = movement_report_batch.count == MESH_UART_MOVEMENT_REPORTED_BATCH_MAX;
+	k_spin_unlock(&movement_report_lock, key);
+
+	if (full)
+	{
+		movement_report_flush();
+	}
+	else
+	{
+		k_work_schedule(&movement_report_work, K_MSEC(CONFIG_MESH_UART_MOVEMENT_REPORT_WINDOW_MS));
+	}
+}
+
+static void log_link_stats(void)
+{
+	struct mesh_uart_tx_stats tx_stats;
+
+	mesh_uart_tx_queue_stats_get(&uart_tx_queue, &tx_stats);
+	mesh_uart_rx_stats_log(&uart_rx);
+	LOG_DBG("UART rx: %u frames, %u CRC errors, %u resyncs",
+			uart_frame_parser.stats.frames,
+			uart_frame_parser.stats.crc_errors,
+			uart_frame_parser.stats.resyncs);
+	LOG_DBG("UART tx: %u frames, %u bytes, %u dropped, %u failed, depth %d (max %d), %u B/s",
+			tx_stats.frames, tx_stats.bytes, tx_stats.dropped, tx_stats.failed,
+			tx_stats.depth, tx_stats.depth_max, tx_stats.bytes_per_sec);
+	LOG_DBG("Movement reports: %u sent, %u dropped", movement_reports_sent, movement_reports_dropped);
+	robot_config_cli_airtime_log(rx_context.config_client);
+	mesh_send_queue_stats_log();
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+	provisioner_stats_log();
+#endif
 }
 
 static void uart_callback(const struct device *dev, struct uart_event *event, void *user_data)
 {
-	struct bt_mesh_robot_config_cli *config_client = (struct bt_mesh_robot_config_cli *)user_data;
 	switch (event->type)
 	{
 	case UART_TX_DONE:
 	{
 		LOG_DBG("UART_TX_DONE: Sent %d bytes", event->data.tx.len);
-		k_sem_give(&uart_tx_sem);
+		mesh_uart_tx_queue_on_event(&uart_tx_queue, event);
 		break;
 	}
 	case UART_TX_ABORTED:
 	{
 		LOG_ERR("UART_TX_ABORTED");
-		k_sem_give(&uart_tx_sem);
+		mesh_uart_tx_queue_on_event(&uart_tx_queue, event);
 		break;
 	}
 	case UART_RX_RDY:
-	{
-		LOG_DBG("UART_RX_RDY");
-		uart_data_rx_rdy_handler(dev, event->data.rx, config_client);
-		break;
-	}
 	case UART_RX_BUF_REQUEST:
-	{
-		LOG_DBG("UART_RX_BUF_REQUEST");
-		void *new_buf;
-		int err = k_mem_slab_alloc(&mesh_uart_rx_slab, &new_buf, K_NO_WAIT);
-		if (err)
-		{
-			LOG_ERR("Could not allocate new buffer: Error %d", err);
-		}
-		else
-		{
-			err = uart_rx_buf_rsp(dev, new_buf, CONFIG_MESH_UART_RX_BUF_SIZE);
-			if (err)
-			{
-				LOG_ERR("Could not set new buffer: Error %d", err);
-			}
-		}
-		break;
-	}
 	case UART_RX_BUF_RELEASED:
-	{
-		LOG_DBG("UART_RX_BUF_RELEASED");
-		k_mem_slab_free(&mesh_uart_rx_slab, (void **)&event->data.rx_buf.buf);
-		break;
-	}
 	case UART_RX_DISABLED:
-	{
-		LOG_DBG("UART_RX_DISABLED");
-		break;
-	}
 	case UART_RX_STOPPED:
 	{
-		LOG_DBG("UART_RX_STOPPED: Reason: %d", event->data.rx_stop.reason);
+		mesh_uart_rx_on_event(&uart_rx, event);
 		break;
 	}
 	default:
@@ -213,23 +269,473 @@ int init_uart(const struct device *uart_dev, struct bt_mesh_robot_config_cli *co
 	}
 	LOG_DBG("UART device ready");
 
-	err = uart_callback_set(uart_dev, uart_callback, (void *)config_client);
+	mesh_uart_tx_queue_init(&uart_tx_queue, uart_dev);
+	rx_context.config_client = config_client;
+	config_client->handlers.movement_done = movement_done_handler;
+	mesh_uart_frame_parser_init(&uart_frame_parser, uart_frame_handler, &rx_context);
+	mesh_uart_rx_init(&uart_rx, &uart_frame_parser, uart_rx_ring_buf, sizeof(uart_rx_ring_buf),
+			  IS_ENABLED(CONFIG_MESH_UART_RX_PARSE_IN_ISR));
+#if defined(CONFIG_MESH_UART_RX_FAULTS)
+	const struct mesh_uart_rx_faults faults = {
+		.drop_ppm = CONFIG_MESH_UART_RX_FAULT_DROP_PPM,
+		.corrupt_ppm = CONFIG_MESH_UART_RX_FAULT_CORRUPT_PPM,
+		.latency_ms = CONFIG_MESH_UART_RX_FAULT_LATENCY_MS,
+	};
+	LOG_WRN("Injecting faults into received UART bytes");
+	mesh_uart_rx_faults_set(&uart_rx, &faults);
+#endif
+	k_thread_start(uart_rx_thread);
+
+	err = uart_callback_set(uart_dev, uart_callback, NULL);
 	if (err)
 	{
 		LOG_ERR("Failed to set UART callback: Error %d", err);
 		return err;
 	}
-	void *initial_rx_buf;
-	err = k_mem_slab_alloc(&mesh_uart_rx_slab, &initial_rx_buf, K_NO_WAIT);
+	const struct mesh_uart_rx_buf_config rx_buf_config = {
+		.slab = &mesh_uart_rx_slab,
+		.buf_size = CONFIG_MESH_UART_RX_BUF_SIZE,
+		.timeout_us = CONFIG_MESH_UART_RX_TIMEOUT_US,
+		.timeout_min_us = IS_ENABLED(CONFIG_MESH_UART_RX_TIMEOUT_ADAPTIVE) ?
+			CONFIG_MESH_UART_RX_TIMEOUT_MIN_US : CONFIG_MESH_UART_RX_TIMEOUT_US,
+	};
+	return mesh_uart_rx_enable(&uart_rx, uart_dev, &rx_buf_config);
+}
+
+/* Status of the latest completed requests. A request that is received again, because the
+ * gateway did not get the response in time, is answered from here instead of being run twice.
+ */
+struct response_cache_entry
+{
+	uint8_t seq;
+	int16_t status;
+};
+static struct response_cache_entry response_cache[2 * MESH_UART_REQUEST_WINDOW];
+static size_t response_cache_next;
+
+static void response_cache_clear(void)
+{
+	memset(response_cache, 0, sizeof(response_cache));
+}
+
+static void response_cache_add(uint8_t seq, int status)
+{
+	response_cache[response_cache_next].seq = seq;
+	response_cache[response_cache_next].status = status;
+	response_cache_next = (response_cache_next + 1) % ARRAY_SIZE(response_cache);
+}
+
+static struct response_cache_entry *response_cache_find(uint8_t seq)
+{
+	if (seq == MESH_UART_SEQ_NONE)
+	{
+		return NULL;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(response_cache); i++)
+	{
+		if (response_cache[i].seq == seq)
+		{
+			return &response_cache[i];
+		}
+	}
+	return NULL;
+}
+
+/* Baud rate negotiation, see messages.h. */
+
+static const uint32_t baudrates[] = MESH_UART_BAUDRATES;
+static uint32_t baudrate_committed; // Baud rate to go back to when a new rate is not committed.
+static uint32_t baudrate_pending; // Baud rate to switch to once the answer to BAUDRATE_SET is sent.
+
+static int baudrate_get(uint32_t *baudrate)
+{
+	struct uart_config cfg;
+
+	int err = uart_config_get(uart_tx_queue.dev, &cfg);
+	if (err)
+	{
+		return err;
+	}
+	*baudrate = cfg.baudrate;
+	return 0;
+}
+
+static int baudrate_apply(uint32_t baudrate)
+{
+	struct uart_config cfg;
+
+	int err = uart_config_get(uart_tx_queue.dev, &cfg);
+	if (err)
+	{
+		return err;
+	}
+	cfg.baudrate = baudrate;
+	err = uart_configure(uart_tx_queue.dev, &cfg);
+	if (err)
+	{
+		return err;
+	}
+	mesh_uart_rx_baudrate_set(&uart_rx, baudrate);
+	return 0;
+}
+
+static bool baudrate_supported(uint32_t baudrate)
+{
+	if (baudrate > CONFIG_MESH_UART_BAUDRATE_MAX)
+	{
+		return false;
+	}
+
+	for (size_t i = 0; i < ARRAY_SIZE(baudrates); i++)
+	{
+		if (baudrates[i] == baudrate)
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+static void baudrate_probation_expired(struct k_work *work)
+{
+	LOG_WRN("Baud rate not committed, going back to %u baud", baudrate_committed);
+	baudrate_apply(baudrate_committed);
+}
+static K_WORK_DELAYABLE_DEFINE(baudrate_probation_work, baudrate_probation_expired);
+
+/* Called when the answer to BAUDRATE_SET has left the UART. */
+static void baudrate_switch(int err, void *user_data)
+{
+	if (err)
+	{
+		return; // The gateway did not get the answer and stays at the old rate.
+	}
+
+	err = baudrate_apply(baudrate_pending);
+	if (err)
+	{
+		LOG_ERR("Failed to switch to %u baud: Error %d", baudrate_pending, err);
+		return;
+	}
+	k_work_reschedule(&baudrate_probation_work, K_MSEC(MESH_UART_BAUDRATE_PROBATION_MS));
+}
+
+static int baudrate_set(uint8_t seq, uint32_t baudrate)
+{
+	if (!baudrate_supported(baudrate))
+	{
+		return -EINVAL;
+	}
+
+	/* A rate on probation is never the one to go back to. */
+	if (!k_work_delayable_is_pending(&baudrate_probation_work))
+	{
+		int err = baudrate_get(&baudrate_committed);
+		if (err)
+		{
+			return err;
+		}
+	}
+	baudrate_pending = baudrate;
+
+	struct mesh_uart_status_msg msg;
+	msg.header.type = STATUS;
+	msg.header.seq = seq;
+	msg.data.status = 0;
+	int err = mesh_uart_tx_queue_send(&uart_tx_queue, &msg, sizeof(msg), baudrate_switch, NULL);
+	if (err)
+	{
+		return err;
+	}
+	response_cache_add(seq, 0);
+	return 0;
+}
+
+static int baudrate_commit(uint32_t baudrate)
+{
+	uint32_t current;
+
+	int err = baudrate_get(&current);
 	if (err)
 	{
-		LOG_ERR("Could not allocate initial RX buffer");
 		return err;
 	}
-	uart_rx_enable(uart_dev, initial_rx_buf, CONFIG_MESH_UART_RX_BUF_SIZE, 1000);
+	if (current != baudrate)
+	{
+		return -EINVAL;
+	}
+
+	k_work_cancel_delayable(&baudrate_probation_work);
+	baudrate_committed = baudrate;
+	LOG_INF("UART link at %u baud", baudrate);
 	return 0;
 }
 
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+/* Robots that are already onboarded are reported again after HELLO, as the nRF9160 may have
+ * restarted and lost them. ROBOT_ADDED is never retransmitted, so the reports wait until the baud
+ * rate negotiation that follows HELLO has been over for a while, and go out one robot at a time
+ * as the transmit queue has room.
+ */
+#define ROBOTS_REPORT_QUIET_MS MESH_UART_BAUDRATE_PROBATION_MS
+#define ROBOTS_REPORT_RETRY_MS 10
+
+static uint16_t robots_report_addr;
+
+static void robots_report_fn(struct k_work *work)
+{
+	uint8_t uuid[16];
+	uint16_t addr = robots_report_addr;
+
+	if (k_work_delayable_is_pending(&baudrate_probation_work))
+	{
+		k_work_reschedule(k_work_delayable_from_work(work), K_MSEC(ROBOTS_REPORT_QUIET_MS));
+		return;
+	}
+	if (provisioner_robot_next(&addr, uuid))
+	{
+		return;
+	}
+
+	int err = mesh_uart_send_robot_added(addr, uuid);
+	if (err == -ENOMEM)
+	{
+		k_work_reschedule(k_work_delayable_from_work(work), K_MSEC(ROBOTS_REPORT_RETRY_MS));
+		return;
+	}
+	if (err)
+	{
+		LOG_WRN("Failed to report robot 0x%04x: Error %d", addr, err);
+	}
+	robots_report_addr = addr;
+	k_work_reschedule(k_work_delayable_from_work(work), K_NO_WAIT);
+}
+static K_WORK_DELAYABLE_DEFINE(robots_report_work, robots_report_fn);
+
+static void robots_report_start(void)
+{
+	robots_report_addr = BT_MESH_ADDR_UNASSIGNED;
+	k_work_reschedule(&robots_report_work, K_MSEC(ROBOTS_REPORT_QUIET_MS));
+}
+
+/* The link is still being set up, the report starts over once it has been quiet. */
+static void robots_report_hold(void)
+{
+	if (k_work_delayable_is_pending(&robots_report_work))
+	{
+		robots_report_start();
+	}
+}
+#endif
+
+static int link_test_check(const struct mesh_uart_link_test_msg *msg)
+{
+	for (size_t i = 0; i < MESH_UART_LINK_TEST_LEN; i++)
+	{
+		if (msg->pattern[i] != MESH_UART_LINK_TEST_BYTE(msg->seed, i))
+		{
+			return -EIO;
+		}
+	}
+	return 0;
+}
+
+/* Movement configuration batch in flight. The robots are configured concurrently, so the batch
+ * takes about one round trip however many robots it holds.
+ */
+static struct
+{
+	struct k_spinlock lock;
+	struct k_sem done;
+	struct mesh_uart_movement_config_batch_msg accepted;
+	int status;
+} movement_config_batch;
+
+static void movement_config_done(struct bt_mesh_robot_config_cli *config_client, uint16_t addr, int err,
+				 void *user_data)
+{
+	struct mesh_uart_movement_config *config = user_data;
+	k_spinlock_key_t key = k_spin_lock(&movement_config_batch.lock);
+
+	if (err)
+	{
+		LOG_ERR("Failed to set movement configuration of robot 0x%04x: Error %d", addr, err);
+		movement_config_batch.status = err;
+	}
+	else
+	{
+		movement_config_batch.accepted.configs[movement_config_batch.accepted.count++] = *config;
+	}
+	k_spin_unlock(&movement_config_batch.lock, key);
+	k_sem_give(&movement_config_batch.done);
+}
+
+static void movement_config_multi_done(struct bt_mesh_robot_config_cli *config_client,
+				       const struct robot_movement_set_multi_entry *entries, uint8_t count,
+				       const atomic_t *acked, void *user_data)
+{
+	struct mesh_uart_movement_config_batch_msg *batch = user_data;
+
+	for (uint8_t i = 0; i < count; i++)
+	{
+		if (atomic_test_bit(acked, i))
+		{
+			movement_config_batch.accepted.configs[movement_config_batch.accepted.count++] = batch->configs[i];
+		}
+		else
+		{
+			LOG_ERR("Failed to set movement configuration of robot 0x%04x: Error %d", entries[i].addr, -ETIMEDOUT);
+			movement_config_batch.status = -ETIMEDOUT;
+		}
+	}
+	k_sem_give(&movement_config_batch.done);
+}
+
+/* All robots of the batch in as few multicast messages as they fit in. */
+static int movement_config_batch_multicast(struct bt_mesh_robot_config_cli *config_client,
+					   struct mesh_uart_movement_config_batch_msg *batch)
+{
+	struct robot_movement_set_multi_entry entries[MESH_UART_MOVEMENT_CONFIG_BATCH_MAX];
+
+	for (uint8_t i = 0; i < batch->count; i++)
+	{
+		entries[i].addr = batch->configs[i].addr;
+		entries[i].config.time = batch->configs[i].time;
+		entries[i].config.angle = batch->configs[i].angle;
+	}
+	int err = configure_robot_movement_multi(config_client, BT_MESH_ADDR_ALL_NODES, entries, batch->count,
+						 movement_config_multi_done, batch);
+	if (err)
+	{
+		LOG_ERR("Failed to send multicast movement configuration: Error %d", err);
+		return err;
+	}
+	k_sem_take(&movement_config_batch.done, K_FOREVER);
+	return movement_config_batch.status;
+}
+
+/* Fills movement_config_batch.accepted and returns the status of the last failure, if any. */
+static int movement_config_batch_run(struct bt_mesh_robot_config_cli *config_client,
+				     struct mesh_uart_movement_config_batch_msg *batch)
+{
+	uint8_t started = 0;
+
+	k_sem_init(&movement_config_batch.done, 0, MESH_UART_MOVEMENT_CONFIG_BATCH_MAX);
+	movement_config_batch.accepted.count = 0;
+	movement_config_batch.status = 0;
+
+	if (IS_ENABLED(CONFIG_ROBOT_CONFIG_CLIENT_MULTICAST))
+	{
+		return movement_config_batch_multicast(config_client, batch);
+	}
+
+	for (uint8_t i = 0; i < batch->count; i++)
+	{
+		struct robot_movement_set_msg movement_config;
+		movement_config.time = batch->configs[i].time;
+		movement_config.angle = batch->configs[i].angle;
+		int err = configure_robot_movement_async(config_client, batch->configs[i].addr, movement_config,
+							 movement_config_done, &batch->configs[i]);
+		if (err)
+		{
+			LOG_ERR("Failed to set movement configuration of robot 0x%04x: Error %d", batch->configs[i].addr, err);
+			k_spinlock_key_t key = k_spin_lock(&movement_config_batch.lock);
+			movement_config_batch.status = err;
+			k_spin_unlock(&movement_config_batch.lock, key);
+			continue;
+		}
+		started++;
+	}
+
+	/* Every transaction completes, if only by timing out. */
+	while (started--)
+	{
+		k_sem_take(&movement_config_batch.done, K_FOREVER);
+	}
+	return movement_config_batch.status;
+}
+
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+BUILD_ASSERT(MESH_UART_GROUP_SET_MAX <= ROBOT_MOVEMENT_SRV_GROUPS_MAX,
+	     "Robots cannot be in as many groups as the UART messages carry");
+#endif
+
+BUILD_ASSERT(MESH_UART_SCRIPT_STEPS_MAX <= ROBOT_PARAMS_STEPS_MAX,
+	     "Robots cannot take as long scripts as the UART messages carry");
+
+static int params_set(struct bt_mesh_robot_config_cli *config_client, const struct mesh_uart_params_set_msg *msg)
+{
+	struct robot_params params = {
+		.kp = msg->kp,
+		.ki = msg->ki,
+		.kd = msg->kd,
+		.trim_a = msg->trim_a,
+		.trim_b = msg->trim_b,
+		.step_count = msg->count,
+	};
+
+	for (uint8_t i = 0; i < msg->count; i++)
+	{
+		params.steps[i].time = msg->steps[i].time;
+		params.steps[i].angle = msg->steps[i].angle;
+	}
+	return configure_robot_params(config_client, msg->addr, &params);
+}
+
+/* Link statistics of every robot the client knows of, in as many batches as they take. */
+BUILD_ASSERT(MESH_UART_ROBOT_STATS_RTT_BINS == ROBOT_CONFIG_CLI_RTT_BINS &&
+	     MESH_UART_ROBOT_STATS_RTT_BIN_MS == ROBOT_CONFIG_CLI_RTT_BIN_MS,
+	     "Round trip time bins differ between the client and the UART messages");
+
+static int robot_stats_send(struct bt_mesh_robot_config_cli *config_client, uint8_t seq)
+{
+	static struct bt_mesh_robot_config_cli_robot robots[CONFIG_ROBOT_CONFIG_CLIENT_ROBOT_TABLE_SIZE];
+	struct mesh_uart_robot_stats_msg msg;
+	size_t count = robot_config_cli_robots_get(config_client, robots, ARRAY_SIZE(robots));
+	int64_t now = k_uptime_get();
+
+	msg.header.type = ROBOT_STATS;
+	msg.header.seq = seq;
+	msg.count = 0;
+	for (size_t i = 0; i < count; i++)
+	{
+		struct mesh_uart_robot_stats *stats = &msg.robots[msg.count++];
+
+		stats->addr = robots[i].addr;
+		stats->sent = MIN(robots[i].sent, UINT16_MAX);
+		stats->acked = MIN(robots[i].acked, UINT16_MAX);
+		stats->timeouts = MIN(robots[i].timeouts, UINT16_MAX);
+		stats->retries = MIN(robots[i].retries, UINT16_MAX);
+		for (int j = 0; j < MESH_UART_ROBOT_STATS_RTT_BINS; j++)
+		{
+			stats->rtt_bins[j] = MIN(robots[i].rtt_bins[j], UINT16_MAX);
+		}
+		stats->rssi = robots[i].rssi;
+		stats->ttl = robots[i].ttl;
+		stats->hops = robots[i].hops;
+		stats->last_seen_ms = robots[i].seen_ms ? MIN(now - robots[i].seen_ms, UINT32_MAX - 1) : UINT32_MAX;
+
+		if (msg.count == MESH_UART_ROBOT_STATS_BATCH_MAX || i == count - 1)
+		{
+			int err = mesh_uart_send(&msg, MESH_UART_ROBOT_STATS_LEN(msg.count));
+			if (err)
+			{
+				return err;
+			}
+			msg.count = 0;
+		}
+	}
+	return 0;
+}
+
+/* Answer a request with its final status and remember the status. */
+static void request_complete(uint8_t seq, int status)
+{
+	response_cache_add(seq, status);
+	mesh_uart_send_status(seq, status);
+}
+
 static void uart_thread_fn(void *arg1, void *arg2, void *arg3)
 {
 	LOG_DBG("Starting UART thread");
@@ -242,11 +748,42 @@ static void uart_thread_fn(void *arg1, void *arg2, void *arg3)
 			LOG_ERR("Failed to dequeue message: Error %d", err);
 			continue;
 		}
+
+		uint8_t seq = thread_msg.msg.header.seq;
+		if (thread_msg.msg.header.type != HELLO)
+		{
+			struct response_cache_entry *cached = response_cache_find(seq);
+			if (cached)
+			{
+				LOG_DBG("Request %d received again, resending status", seq);
+				mesh_uart_send_status(seq, cached->status);
+				continue;
+			}
+		}
+
 		switch (thread_msg.msg.header.type)
 		{
 		case HELLO:
 		{
-			mesh_uart_send_hello(thread_msg.uart_dev, thread_msg.msg.hello.echo, K_FOREVER);
+			/* The gateway starts a new session, and numbers its requests from scratch. */
+			response_cache_clear();
+			uint8_t version = mesh_uart_version_negotiate(thread_msg.msg.hello.version_min,
+								      thread_msg.msg.hello.version_max);
+			if (version)
+			{
+				mesh_uart_tx_queue_version_set(&uart_tx_queue, version);
+			}
+			else
+			{
+				/* Answer anyway, the gateway tells from the versions in the answer. */
+				LOG_ERR("Gateway speaks protocol versions %d to %d",
+					thread_msg.msg.hello.version_min, thread_msg.msg.hello.version_max);
+			}
+			mesh_uart_send_hello(seq, thread_msg.msg.hello.echo);
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+			/* The nRF9160 may have restarted and lost its robots. */
+			robots_report_start();
+#endif
 			break;
 		}
 		case CLEAR_TO_MOVE:
@@ -256,6 +793,8 @@ static void uart_thread_fn(void *arg1, void *arg2, void *arg3)
 			{
 				LOG_ERR("Failed to send CLEAR_TO_MOVE: Error %d", err);
 			}
+			request_complete(seq, err);
+			log_link_stats();
 			break;
 		}
 		case SET_MOVEMENT_CONFIG:
@@ -272,14 +811,97 @@ static void uart_thread_fn(void *arg1, void *arg2, void *arg3)
 				accepted_config.addr = thread_msg.msg.set_movement_config.data.addr;
 				accepted_config.time = movement_config.time;
 				accepted_config.angle = movement_config.angle;
-				mesh_uart_send_movement_config_accepted(thread_msg.uart_dev, accepted_config, K_FOREVER);
+				mesh_uart_send_movement_config_accepted(seq, accepted_config);
+			}
+			request_complete(seq, err);
+			break;
+		}
+		case SET_MOVEMENT_CONFIG_BATCH:
+		{
+			/* Fan the batch out to the robots and answer with the configurations that
+			 * were accepted, followed by the status of the last failure, if any.
+			 */
+			int status = movement_config_batch_run(thread_msg.config_client,
+							       &thread_msg.msg.set_movement_config_batch);
+			mesh_uart_send_movement_config_accepted_batch(seq, &movement_config_batch.accepted);
+			request_complete(seq, status);
+			break;
+		}
+		case BAUDRATE_SET:
+		{
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+			robots_report_hold();
+#endif
+			err = baudrate_set(seq, thread_msg.msg.baudrate.baudrate);
+			if (err)
+			{
+				LOG_ERR("Failed to set %u baud: Error %d", thread_msg.msg.baudrate.baudrate, err);
+				request_complete(seq, err);
+			}
+			break;
+		}
+		case BAUDRATE_COMMIT:
+		{
+			request_complete(seq, baudrate_commit(thread_msg.msg.baudrate.baudrate));
+			break;
+		}
+		case LINK_TEST:
+		{
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+			robots_report_hold();
+#endif
+			request_complete(seq, link_test_check(&thread_msg.msg.link_test));
+			break;
+		}
+		case ROBOT_STATS_GET:
+		{
+			request_complete(seq, robot_stats_send(thread_msg.config_client, seq));
+			break;
+		}
+		case GROUP_SET:
+		{
+#if defined(CONFIG_GATEWAY_PROVISIONER)
+			uint16_t groups[MESH_UART_GROUP_SET_MAX];
+
+			for (uint8_t i = 0; i < thread_msg.msg.group_set.count; i++)
+			{
+				groups[i] = thread_msg.msg.group_set.groups[i].addr;
+			}
+			err = provisioner_robot_groups_set(thread_msg.msg.group_set.addr, groups,
+							   thread_msg.msg.group_set.count);
+#else
+			/* Robots are configured by whoever provisioned them. */
+			err = -ENOTSUP;
+#endif
+			request_complete(seq, err);
+			break;
+		}
+		case CLEAR_TO_MOVE_GROUP:
+		{
+			err = send_clear_to_move(thread_msg.config_client, thread_msg.msg.clear_to_move_group.group);
+			if (err)
+			{
+				LOG_ERR("Failed to send CLEAR_TO_MOVE to group 0x%04x: Error %d",
+					thread_msg.msg.clear_to_move_group.group, err);
+			}
+			request_complete(seq, err);
+			log_link_stats();
+			break;
+		}
+		case PARAMS_SET:
+		{
+			err = params_set(thread_msg.config_client, &thread_msg.msg.params_set);
+			if (err)
+			{
+				LOG_ERR("Failed to set parameters of robot 0x%04x: Error %d",
+					thread_msg.msg.params_set.addr, err);
 			}
-			mesh_uart_send_status(thread_msg.uart_dev, err, K_FOREVER);
+			request_complete(seq, err);
 			break;
 		}
 		default:
 		{
-			LOG_ERR("Unknown message type %d", thread_msg.msg.header.type);
+			LOG_ERR("Unexpected message %s", mesh_uart_msg_name(thread_msg.msg.header.type));
 			break;
 		}
 		}
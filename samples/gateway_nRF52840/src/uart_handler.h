@@ -5,3 +5,10 @@
 
 int init_uart(const struct device *dev, struct bt_mesh_robot_config_cli *config_client);
 
+/**
+ * @brief Report a robot that was added to the network to the nRF9160.
+ *
+ * @param addr Unicast address of the robot.
+ * @param uuid Device UUID of the robot.
+ */
+void uart_robot_added(uint16_t addr, const uint8_t uuid[16]);
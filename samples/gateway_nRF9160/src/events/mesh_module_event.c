@@ -25,6 +25,14 @@ static char *type_to_str(enum mesh_module_event_type type)
         return "MESH_EVT_MOVEMENT_REPORTED";
     case MESH_EVT_MOVEMENT_CONFIG_ACCEPTED:
         return "MESH_EVT_MOVEMENT_CONFIG_ACCEPTED";
+    case MESH_EVT_ROBOT_STATS_DONE:
+        return "MESH_EVT_ROBOT_STATS_DONE";
+    case MESH_EVT_GROUPS_CONFIGURED:
+        return "MESH_EVT_GROUPS_CONFIGURED";
+    case MESH_EVT_PARAMS_CONFIGURED:
+        return "MESH_EVT_PARAMS_CONFIGURED";
+    case MESH_EVT_ERROR:
+        return "MESH_EVT_ERROR";
     default:
         return "UNKNOWN";
     }
@@ -27,6 +27,33 @@ enum mesh_module_event_type {
     MESH_EVT_OP_STATUS, // Status of previous operation.
     MESH_EVT_MOVEMENT_REPORTED, // Movement reported by robot.
     MESH_EVT_MOVEMENT_CONFIG_ACCEPTED, // Movement configuration accepted by robot.
+    MESH_EVT_ROBOT_STATS_DONE, // Link statistics of every robot the nRF52840 knows of have been received.
+    MESH_EVT_GROUPS_CONFIGURED, // Groups of a robot configured.
+    MESH_EVT_PARAMS_CONFIGURED, // Movement parameters and script of a robot configured.
+    MESH_EVT_ERROR, // The link to the nRF52840 could not be set up.
+};
+
+/* Result of a configuration of one robot. */
+struct mesh_module_robot_result {
+    uint16_t addr; // Mesh network address of the robot.
+    int status;
+};
+
+/* Result of configuring the groups of one robot. */
+struct mesh_module_groups_result {
+    uint16_t addr; // Mesh network address of the robot.
+    uint16_t groups; // Groups the robot was asked to be in, bit i for group i.
+    int status;
+};
+
+/* Link statistics of the robots the nRF52840 knows of. The statistics are owned by the mesh
+ * module, and stay as they are until the robot module requests them again. The robot module
+ * makes no new request before it has handled the event.
+ */
+struct mesh_module_robot_stats {
+    int status;
+    const struct mesh_uart_robot_stats *robots;
+    uint8_t count;
 };
 
 struct mesh_module_event {
@@ -34,9 +61,13 @@ struct mesh_module_event {
     enum mesh_module_event_type type;
     union {
         int status; // MESH_EVT_OP_STATUS: Status for previous operation.
+        int err; // MESH_EVT_ERROR: Error code.
         struct mesh_uart_robot_added_data new_robot; // MESH_EVT_ROBOT_ADDED: Data about new robot.
         struct mesh_uart_movement_reported_data movement_reported; // MESH_EVT_MOVEMENT_REPORTED: Data about actual movement reported by robot.
         struct mesh_uart_movement_config movement_config; // MESH_EVT_MOVEMENT_CONFIG_ACCEPTED: Movement configuration accepted by robot.
+        struct mesh_module_robot_stats robot_stats; // MESH_EVT_ROBOT_STATS_DONE: Link statistics of every robot.
+        struct mesh_module_groups_result groups_configured; // MESH_EVT_GROUPS_CONFIGURED: Result of configuring the groups of a robot.
+        struct mesh_module_robot_result params_configured; // MESH_EVT_PARAMS_CONFIGURED: Result of configuring the parameters of a robot.
     } data;
 };
 
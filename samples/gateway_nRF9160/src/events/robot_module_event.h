@@ -27,19 +27,49 @@ enum robot_module_event_type {
 	ROBOT_EVT_LED_CONFIGURE,
 	ROBOT_EVT_ERROR,
 	ROBOT_EVT_CLEAR_TO_MOVE,
+	ROBOT_EVT_LINK_STATS_REQUEST,
+	ROBOT_EVT_GROUPS_CONFIGURE,
+	ROBOT_EVT_PARAMS_CONFIGURE,
 };
 
+/* Address of every robot, ROBOT_EVT_CLEAR_TO_MOVE is sent to it or to a group address. */
+#define ROBOT_ADDR_ALL 0xFFFF
+
+/* Groups a robot can be in at once. */
+#define ROBOT_GROUPS_PER_ROBOT_MAX 4
+
+/* Steps of the longest movement script. */
+#define ROBOT_SCRIPT_STEPS_MAX 12
+
 struct robot_led_cfg {
 	int r, g, b;
 	int time;
 };
 
+struct robot_script_step {
+	int drive_time;
+	int rotation;
+};
+
+/* PID gains in thousandths, motor trims in thousandths of full power. */
+struct robot_params_cfg {
+	int kp, ki, kd;
+	int trim_a, trim_b;
+	struct robot_script_step script[ROBOT_SCRIPT_STEPS_MAX];
+	int script_len;
+};
+
 struct robot_cfg {
 	int rotation;
 	int drive_time;
 	int speed;
 	int revolutions;
 	struct robot_led_cfg led;
+	uint16_t groups[ROBOT_GROUPS_PER_ROBOT_MAX];
+	int group_count;
+	/* The groups above, bit i for group i, returned with the result. */
+	uint16_t group_mask;
+	struct robot_params_cfg params;
 };
 
 
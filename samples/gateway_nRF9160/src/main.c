@@ -9,10 +9,25 @@
 
 #define MODULE main
 #include "modules_common.h"
+#include "cloud_module_event.h"
+#include "mesh_module_event.h"
+#include "modem_module_event.h"
+#include "robot_module_event.h"
+#include "ui_module_event.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(MODULE);
 
+/* Single listener for all module events. Events are enqueued to the modules that subscribed to
+ * them with MODULE_SUBSCRIBE().
+ */
+APP_EVENT_LISTENER(MODULE, modules_route_event);
+APP_EVENT_SUBSCRIBE(MODULE, cloud_module_event);
+APP_EVENT_SUBSCRIBE(MODULE, mesh_module_event);
+APP_EVENT_SUBSCRIBE(MODULE, modem_module_event);
+APP_EVENT_SUBSCRIBE(MODULE, robot_module_event);
+APP_EVENT_SUBSCRIBE(MODULE, ui_module_event);
+
 void main(void)
 {
 	if (app_event_manager_init()) {
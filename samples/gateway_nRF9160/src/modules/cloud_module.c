@@ -68,16 +68,40 @@ static struct cloud_backoff_delay_lookup backoff_delay[] = {
  */
 static int connect_retries;
 
-/* Cloud module message queue. */
+/* Cloud module message queue. Connection state events are put in a control lane. Reports and
+ * QoS sends share the telemetry lane, which is served at least once per control lane round.
+ */
+#define CLOUD_CONTROL_QUEUE_ENTRY_COUNT	6
 #define CLOUD_QUEUE_ENTRY_COUNT		20
-#define CLOUD_QUEUE_BYTE_ALIGNMENT	4
 
-K_MSGQ_DEFINE(msgq_cloud, sizeof(struct cloud_msg_data),
-	      CLOUD_QUEUE_ENTRY_COUNT, CLOUD_QUEUE_BYTE_ALIGNMENT);
+enum cloud_lane {
+	CLOUD_LANE_CONTROL,
+	CLOUD_LANE_TELEMETRY,
+};
+
+MODULE_MSGQ_DEFINE(msgq_cloud_control, struct cloud_msg_data, CLOUD_CONTROL_QUEUE_ENTRY_COUNT);
+MODULE_MSGQ_DEFINE(msgq_cloud, struct cloud_msg_data, CLOUD_QUEUE_ENTRY_COUNT);
+static K_SEM_DEFINE(cloud_lane_sem, 0, K_SEM_MAX_LIMIT);
+
+static struct module_lane lanes[] = {
+	[CLOUD_LANE_CONTROL] = { .msg_q = &msgq_cloud_control, .weight = 4 },
+	[CLOUD_LANE_TELEMETRY] = { .msg_q = &msgq_cloud, .weight = 1 },
+};
+
+static const struct module_lane_class lane_classes[] = {
+	MODULE_LANE_CLASS(modem_module_event, MODULE_SUBTYPE_ANY, CLOUD_LANE_CONTROL),
+	MODULE_LANE_CLASS(cloud_module_event, CLOUD_EVT_CONNECTED, CLOUD_LANE_CONTROL),
+	MODULE_LANE_CLASS(cloud_module_event, CLOUD_EVT_CONNECTION_TIMEOUT, CLOUD_LANE_CONTROL),
+};
 
 static struct module_data self = {
 	.name = "cloud",
-	.msg_q = &msgq_cloud,
+	.lanes = lanes,
+	.lane_count = ARRAY_SIZE(lanes),
+	.lane_classes = lane_classes,
+	.lane_class_count = ARRAY_SIZE(lane_classes),
+	.lane_policy = MODULE_LANE_POLICY_WEIGHTED,
+	.lane_sem = &cloud_lane_sem,
 	.supports_shutdown = true,
 };
 
@@ -143,42 +167,6 @@ static inline int is_topic(const struct aws_iot_evt *evt, char* topic)
 }
 
 /* Handlers */
-static bool app_event_handler(const struct app_event_header *aeh)
-{
-	struct cloud_msg_data msg = {0};
-	bool enqueue_msg = false;
-
-	if (is_cloud_module_event(aeh)) {
-		struct cloud_module_event *evt = cast_cloud_module_event(aeh);
-		msg.module.cloud = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_modem_module_event(aeh)) {
-		struct modem_module_event *evt = cast_modem_module_event(aeh);
-		msg.module.modem = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_robot_module_event(aeh)) {
-		struct robot_module_event *evt = cast_robot_module_event(aeh);
-
-		msg.module.robot = *evt;
-		enqueue_msg = true;
-	}
-
-	if (enqueue_msg) {
-		int err = module_enqueue_msg(&self, &msg);
-
-		if (err) {
-			LOG_ERR("Message could not be enqueued");
-			SEND_ERROR(cloud, CLOUD_EVT_ERROR, err);
-		}
-	}
-
-	return false;
-}
-
 static void cloud_event_handler(const struct aws_iot_evt *evt) 
 {
 switch (evt->type) {
@@ -488,7 +476,8 @@ static void on_sub_state_cloud_connected(struct cloud_msg_data *msg)
 static void module_thread_fn(void)
 {
 	int err;
-	struct cloud_msg_data msg;
+	struct cloud_msg_data msg_buf;
+	struct cloud_msg_data *msg;
 
 	LOG_INF("Cloud module thread started");
 
@@ -509,31 +498,33 @@ static void module_thread_fn(void)
 	k_work_init_delayable(&connect_check_work, connect_check_work_fn);
 
 	while (true) {
-		module_get_next_msg(&self, &msg);
+		msg = module_get_next_event(&self, &msg_buf);
 
 		switch (state) {
 		case STATE_LTE_DISCONNECTED:
-			on_state_lte_disconnected(&msg);
+			on_state_lte_disconnected(msg);
 			break;
 		case STATE_LTE_CONNECTED:
 			switch (sub_state)
 			{
 			case SUB_STATE_CLOUD_DISCONNECTED:
-				on_sub_state_cloud_disconnected(&msg);
+				on_sub_state_cloud_disconnected(msg);
 				break;
 			case SUB_STATE_CLOUD_CONNECTED:
-				on_sub_state_cloud_connected(&msg);
+				on_sub_state_cloud_connected(msg);
 				break;
 			
 			default:
 				break;
 			}
 			
-			on_state_lte_connected(&msg);
+			on_state_lte_connected(msg);
 			break;
 		default:
 			break;
 		}
+
+		module_release_event(&self, msg);
 	}
 }
 
@@ -541,9 +532,13 @@ K_THREAD_DEFINE(cloud_module_thread, CONFIG_CLOUD_THREAD_STACK_SIZE,
 		module_thread_fn, NULL, NULL, NULL,
 		K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
 
-APP_EVENT_LISTENER(MODULE, app_event_handler);
-APP_EVENT_SUBSCRIBE_EARLY(MODULE, cloud_module_event);
-APP_EVENT_SUBSCRIBE(MODULE, modem_module_event);
-APP_EVENT_SUBSCRIBE(MODULE, robot_module_event);
+MODULE_SUBSCRIBE(self, cloud_module_event, CLOUD_EVT_CONNECTED);
+MODULE_SUBSCRIBE(self, cloud_module_event, CLOUD_EVT_CONNECTION_TIMEOUT);
+MODULE_SUBSCRIBE(self, cloud_module_event, CLOUD_EVT_SEND_QOS);
+MODULE_SUBSCRIBE(self, cloud_module_event, CLOUD_EVT_SEND_QOS_CLEAR);
+MODULE_SUBSCRIBE(self, modem_module_event, MODEM_EVT_LTE_CONNECTED);
+MODULE_SUBSCRIBE(self, modem_module_event, MODEM_EVT_LTE_DISCONNECTED);
+MODULE_SUBSCRIBE(self, robot_module_event, ROBOT_EVT_CLEAR_ALL);
+MODULE_SUBSCRIBE(self, robot_module_event, ROBOT_EVT_REPORT);
 
 
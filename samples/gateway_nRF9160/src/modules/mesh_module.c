@@ -13,6 +13,13 @@
 #define MODULE mesh_module
 
 #include "../../common/nRF9160dk_uart_interface/messages.h"
+#include "uart_codec.h"
+#include "uart_codec_bench.h"
+#include "uart_frame.h"
+#include "uart_tx_queue.h"
+#include "uart_request.h"
+#include "uart_rx.h"
+#include "modules_common.h"
 #include "mesh_module_event.h"
 #include "robot_module_event.h"
 
@@ -27,11 +34,53 @@ struct mesh_msg_data
 	} module;
 };
 
+/* Movement configuration and clear to move share the control lane, so that clear to move never
+ * overtakes the configuration of the round it starts. A round puts the configuration of every
+ * robot in the lane at once, followed by its clear to move.
+ */
+#define MESH_CONTROL_QUEUE_ENTRY_COUNT (CONFIG_ROBOT_COUNT_MAX + 4)
 #define MESH_QUEUE_ENTRY_COUNT 10
-#define MESH_QUEUE_BYTE_ALIGNMENT 4
 
-K_MSGQ_DEFINE(msgq_mesh, sizeof(struct mesh_msg_data),
-			  MESH_QUEUE_ENTRY_COUNT, MESH_QUEUE_BYTE_ALIGNMENT);
+BUILD_ASSERT(MESH_CONTROL_QUEUE_ENTRY_COUNT >= CONFIG_ROBOT_COUNT_MAX + 1,
+	     "The control lane must hold a configuration for every robot and the clear to move");
+
+enum mesh_lane
+{
+	MESH_LANE_CONTROL,
+	MESH_LANE_OTHER,
+};
+
+MODULE_MSGQ_DEFINE(msgq_mesh_control, struct mesh_msg_data, MESH_CONTROL_QUEUE_ENTRY_COUNT);
+MODULE_MSGQ_DEFINE(msgq_mesh, struct mesh_msg_data, MESH_QUEUE_ENTRY_COUNT);
+static K_SEM_DEFINE(mesh_lane_sem, 0, K_SEM_MAX_LIMIT);
+
+static struct module_lane lanes[] = {
+	[MESH_LANE_CONTROL] = {.msg_q = &msgq_mesh_control},
+	[MESH_LANE_OTHER] = {.msg_q = &msgq_mesh},
+};
+
+static const struct module_lane_class lane_classes[] = {
+	MODULE_LANE_CLASS(robot_module_event, ROBOT_EVT_CLEAR_TO_MOVE, MESH_LANE_CONTROL),
+	MODULE_LANE_CLASS(robot_module_event, ROBOT_EVT_MOVEMENT_CONFIGURE, MESH_LANE_CONTROL),
+	MODULE_LANE_CLASS(robot_module_event, ROBOT_EVT_GROUPS_CONFIGURE, MESH_LANE_CONTROL),
+	/* A script must reach the robot before the clear to move of its round. */
+	MODULE_LANE_CLASS(robot_module_event, ROBOT_EVT_PARAMS_CONFIGURE, MESH_LANE_CONTROL),
+};
+
+static void recover(void);
+
+static struct module_data self = {
+	.name = "mesh",
+	.lanes = lanes,
+	.lane_count = ARRAY_SIZE(lanes),
+	.lane_classes = lane_classes,
+	.lane_class_count = ARRAY_SIZE(lane_classes),
+	.lane_policy = MODULE_LANE_POLICY_STRICT,
+	.lane_sem = &mesh_lane_sem,
+	.handler_budget_ms = 2000,
+	.recover = recover,
+	.supports_shutdown = false,
+};
 
 /* mesh module super states. */
 static enum state_type {
@@ -39,8 +88,6 @@ static enum state_type {
 	STATE_MESH_READY,
 } state;
 
-static K_SEM_DEFINE(uart_transmit_sem, 1, 1);
-
 /* Convenience functions used in internal state handling. */
 static char *state2str(enum state_type state)
 {
@@ -77,161 +124,832 @@ static void state_set(enum state_type new_state)
 static const struct device *mesh_uart = DEVICE_DT_GET(DT_ALIAS(uartmesh));
 K_MEM_SLAB_DEFINE_STATIC(mesh_uart_rx_slab, CONFIG_MESH_UART_RX_BUF_SIZE, CONFIG_MESH_UART_RX_BUF_COUNT, 4);
 
-/* Event handlers */
-static bool app_event_handler(const struct app_event_header *aeh)
+static struct mesh_uart_frame_parser uart_frame_parser;
+static struct mesh_uart_rx uart_rx;
+static uint8_t uart_rx_ring_buf[CONFIG_MESH_UART_RX_RING_SIZE];
+static struct mesh_uart_tx_queue uart_tx_queue;
+static struct mesh_uart_requester uart_requester;
+
+/* UART related functions*/
+
+static void op_status_submit(int status)
 {
-	struct mesh_msg_data msg = {0};
-	bool enqueue_msg = false;
+	struct mesh_module_event *evt = new_mesh_module_event();
+	evt->type = MESH_EVT_OP_STATUS;
+	evt->data.status = status;
+	APP_EVENT_SUBMIT(evt);
+}
 
-	if (is_robot_module_event(aeh))
+/* Called with the final response to a request, or when the request timed out. */
+static void request_done(int err, const union mesh_uart_msg *rsp, void *user_data)
+{
+	if (err)
 	{
-		struct robot_module_event *evt = cast_robot_module_event(aeh);
-		msg.module.robot = *evt;
-		enqueue_msg = true;
+		LOG_ERR("UART request failed: %d", err);
 	}
+	else if (rsp->header.type == HELLO)
+	{
+		return;
+	}
+
+	op_status_submit(err ? err : rsp->status.data.status);
+}
 
-	if (enqueue_msg)
+static int mesh_uart_request(const void *data, size_t len, uint32_t timeout_ms)
+{
+	int err = mesh_uart_request_send(&uart_requester, data, len, timeout_ms, request_done, NULL);
+	if (err)
 	{
-		int err = k_msgq_put(&msgq_mesh, &msg, K_NO_WAIT);
+		LOG_ERR("Failed to send UART request: %d", err);
+	}
+	return err;
+}
 
-		if (err)
-		{
-			LOG_ERR("Message could not be enqueued");
-		}
+/* Called by the module supervisor when the module is stuck. The module never waits for the UART
+ * itself, but a lost UART_TX_DONE stalls the transmit queue and with it every command.
+ */
+static void recover(void)
+{
+	mesh_uart_tx_queue_abort(&uart_tx_queue);
+}
+
+static void log_link_stats(void)
+{
+	struct mesh_uart_tx_stats tx_stats;
+
+	mesh_uart_tx_queue_stats_get(&uart_tx_queue, &tx_stats);
+	mesh_uart_rx_stats_log(&uart_rx);
+	LOG_DBG("UART rx: %u frames, %u CRC errors, %u resyncs",
+			uart_frame_parser.stats.frames,
+			uart_frame_parser.stats.crc_errors,
+			uart_frame_parser.stats.resyncs);
+	LOG_DBG("UART tx: %u frames, %u bytes, %u dropped, %u failed, depth %d (max %d), %u B/s",
+			tx_stats.frames, tx_stats.bytes, tx_stats.dropped, tx_stats.failed,
+			tx_stats.depth, tx_stats.depth_max, tx_stats.bytes_per_sec);
+	mesh_uart_request_stats_log(&uart_requester);
+}
+
+static int uart_send_clear_to_move(uint16_t addr)
+{
+	if (addr == ROBOT_ADDR_ALL)
+	{
+		struct mesh_uart_clear_to_move_msg msg = {
+			.header = {
+				.type = CLEAR_TO_MOVE,
+			},
+		};
+		return mesh_uart_request(&msg, sizeof(msg), CONFIG_MESH_UART_REQUEST_TIMEOUT_MS);
 	}
 
-	return false;
+	struct mesh_uart_clear_to_move_group_msg msg = {
+		.header = {
+			.type = CLEAR_TO_MOVE_GROUP,
+		},
+		.group = addr,
+	};
+	return mesh_uart_request(&msg, sizeof(msg), CONFIG_MESH_UART_REQUEST_TIMEOUT_MS);
 }
 
-/* UART related functions*/
+BUILD_ASSERT(ROBOT_GROUPS_PER_ROBOT_MAX <= MESH_UART_GROUP_SET_MAX,
+	     "A robot is in more groups than GROUP_SET carries");
+
+BUILD_ASSERT(CONFIG_ROBOT_GROUP_COUNT_MAX <= 16, "Group mask does not fit the GROUP_SET user data");
 
-static int mesh_uart_send(const void *data, size_t len, k_timeout_t timeout)
+/* Called with the status of a GROUP_SET. The user data holds the robot address in the lower
+ * half and the groups it was asked to be in in the upper half.
+ */
+static void group_set_done(int err, const union mesh_uart_msg *rsp, void *user_data)
 {
-	int err = 0;
-	err = k_sem_take(&uart_transmit_sem, timeout);
+	uint32_t data = POINTER_TO_UINT(user_data);
+
+	struct mesh_module_event *evt = new_mesh_module_event();
+	evt->type = MESH_EVT_GROUPS_CONFIGURED;
+	evt->data.groups_configured.addr = data & 0xFFFF;
+	evt->data.groups_configured.groups = data >> 16;
+	evt->data.groups_configured.status = err ? err : rsp->status.data.status;
+	APP_EVENT_SUBMIT(evt);
+}
+
+static int uart_send_group_set(uint16_t addr, const struct robot_cfg *cfg)
+{
+	struct mesh_uart_group_set_msg msg = {
+		.header = {
+			.type = GROUP_SET,
+		},
+		.addr = addr,
+		.count = cfg->group_count,
+	};
+
+	for (int i = 0; i < cfg->group_count; i++)
+	{
+		msg.groups[i].addr = cfg->groups[i];
+	}
+
+	void *user_data = UINT_TO_POINTER(addr | ((uint32_t)cfg->group_mask << 16));
+	int err = mesh_uart_request_send(&uart_requester, &msg, MESH_UART_GROUP_SET_LEN(msg.count),
+					 CONFIG_MESH_UART_REQUEST_TIMEOUT_MS +
+					 CONFIG_MESH_UART_GROUP_CONFIG_TIMEOUT_MS,
+					 group_set_done, user_data);
 	if (err)
 	{
-		LOG_ERR("Could not take semaphore: Reason: %d", err);
-		return err;
+		LOG_ERR("Failed to send UART request: %d", err);
+		/* The robot module waits for the result before it configures the next robot. */
+		group_set_done(err, NULL, user_data);
+	}
+	return err;
+}
+
+static void params_set_done(int err, const union mesh_uart_msg *rsp, void *user_data)
+{
+	struct mesh_module_event *evt = new_mesh_module_event();
+	evt->type = MESH_EVT_PARAMS_CONFIGURED;
+	evt->data.params_configured.addr = POINTER_TO_UINT(user_data);
+	evt->data.params_configured.status = err ? err : rsp->status.data.status;
+	APP_EVENT_SUBMIT(evt);
+}
+
+BUILD_ASSERT(ROBOT_SCRIPT_STEPS_MAX <= MESH_UART_SCRIPT_STEPS_MAX,
+	     "Scripts are longer than PARAMS_SET carries");
+
+static int uart_send_params_set(uint16_t addr, const struct robot_cfg *cfg)
+{
+	const struct robot_params_cfg *params = &cfg->params;
+	struct mesh_uart_params_set_msg msg = {
+		.header = {
+			.type = PARAMS_SET,
+		},
+		.addr = addr,
+		.kp = params->kp,
+		.ki = params->ki,
+		.kd = params->kd,
+		.trim_a = params->trim_a,
+		.trim_b = params->trim_b,
+		.count = params->script_len,
+	};
+
+	for (int i = 0; i < params->script_len; i++)
+	{
+		msg.steps[i].time = params->script[i].drive_time;
+		msg.steps[i].angle = params->script[i].rotation;
+	}
+
+	int err = mesh_uart_request_send(&uart_requester, &msg, MESH_UART_PARAMS_SET_LEN(msg.count),
+					 CONFIG_MESH_UART_REQUEST_TIMEOUT_MS +
+					 CONFIG_MESH_UART_PARAMS_TIMEOUT_MS,
+					 params_set_done, UINT_TO_POINTER(addr));
+	if (err)
+	{
+		LOG_ERR("Failed to send UART request: %d", err);
+		params_set_done(err, NULL, UINT_TO_POINTER(addr));
+	}
+	return err;
+}
+
+static void link_check_schedule(void);
+
+/* Statistics of the request in progress, collected from its ROBOT_STATS frames. Only touched
+ * again when the robot module requests the next statistics, which it does not before it has
+ * handled MESH_EVT_ROBOT_STATS_DONE for these. Every request ends in that event.
+ */
+static struct mesh_uart_robot_stats robot_stats[CONFIG_MESH_ROBOT_STATS_MAX];
+static uint8_t robot_stats_count;
+
+static void robot_stats_add(const struct mesh_uart_robot_stats_msg *msg)
+{
+	uint8_t count = MIN(msg->count, ARRAY_SIZE(robot_stats) - robot_stats_count);
+
+	if (count < msg->count)
+	{
+		LOG_WRN("Link statistics of %d robots dropped", msg->count - count);
 	}
-	err = uart_tx(mesh_uart, data, len, SYS_FOREVER_US);
+	memcpy(&robot_stats[robot_stats_count], msg->robots, count * sizeof(robot_stats[0]));
+	robot_stats_count += count;
+}
+
+/* Called when every ROBOT_STATS of the request has been received, or the request failed. */
+static void robot_stats_done(int err, const union mesh_uart_msg *rsp, void *user_data)
+{
+	if (err)
+	{
+		LOG_ERR("Robot statistics request failed: %d", err);
+	}
+
+	/* The statistics are requested once the round has ended, which is when the link is free
+	 * to change baud rate.
+	 */
+	link_check_schedule();
+
+	struct mesh_module_event *evt = new_mesh_module_event();
+	evt->type = MESH_EVT_ROBOT_STATS_DONE;
+	evt->data.robot_stats.status = err ? err : rsp->status.data.status;
+	evt->data.robot_stats.robots = robot_stats;
+	evt->data.robot_stats.count = robot_stats_count;
+	APP_EVENT_SUBMIT(evt);
+}
+
+static int uart_send_robot_stats_get(void)
+{
+	struct mesh_uart_robot_stats_get_msg msg = {
+		.header = {
+			.type = ROBOT_STATS_GET,
+		},
+	};
+
+	robot_stats_count = 0;
+	int err = mesh_uart_request_send(&uart_requester, &msg, sizeof(msg),
+					 CONFIG_MESH_UART_REQUEST_TIMEOUT_MS, robot_stats_done, NULL);
 	if (err)
 	{
-		LOG_ERR("Failed to start UART tx: %d", err);
+		LOG_ERR("Failed to send UART request: %d", err);
+		robot_stats_done(err, NULL, NULL);
 	}
 	return err;
 }
 
-static int uart_send_hello(k_timeout_t timeout)
+/* Link setup and baud rate negotiation, see messages.h. */
+
+BUILD_ASSERT(CONFIG_MESH_UART_LINK_TEST_FRAMES <= MESH_UART_REQUEST_WINDOW + MESH_UART_REQUEST_BACKLOG,
+			 "Link test burst does not fit in the request window and backlog");
+
+static const uint32_t link_baudrates[] = MESH_UART_BAUDRATES;
+static uint32_t link_baudrate; // Baud rate in use.
+static uint32_t link_baudrate_base; // Baud rate from devicetree, which both sides start at.
+static uint32_t link_peer_baudrate_max;
+static uint32_t link_crc_errors_seen;
+
+static K_SEM_DEFINE(link_sync_sem, 0, 1);
+static int link_sync_err;
+static union mesh_uart_msg link_sync_rsp;
+
+static K_SEM_DEFINE(link_test_sem, 0, CONFIG_MESH_UART_LINK_TEST_FRAMES);
+static atomic_t link_test_err;
+
+static void link_sync_done(int err, const union mesh_uart_msg *rsp, void *user_data)
+{
+	link_sync_err = err;
+	if (!err)
+	{
+		link_sync_rsp = *rsp;
+	}
+	k_sem_give(&link_sync_sem);
+}
+
+/* Send a request and wait for the final response. Returns the status of a STATUS response. Only
+ * used while the link is set up, or between rounds.
+ */
+static int link_request_sync(const void *msg, size_t len, uint32_t timeout_ms)
 {
-	static struct mesh_uart_hello_msg msg = {
+	k_sem_reset(&link_sync_sem);
+
+	int err = mesh_uart_request_send(&uart_requester, msg, len, timeout_ms, link_sync_done, NULL);
+	if (err)
+	{
+		return err;
+	}
+
+	/* The requester always completes a request, at the latest when it times out. */
+	k_sem_take(&link_sync_sem, K_FOREVER);
+	if (link_sync_err)
+	{
+		return link_sync_err;
+	}
+	return link_sync_rsp.header.type == STATUS ? link_sync_rsp.status.data.status : 0;
+}
+
+static int link_hello(void)
+{
+	struct mesh_uart_hello_msg msg = {
 		.header = {
 			.type = HELLO,
 		},
-		.echo = 0x1010};
-	return mesh_uart_send(&msg, sizeof(msg), timeout);
+		.echo = 0x1010,
+		.baudrate_max = CONFIG_MESH_UART_BAUDRATE_MAX,
+		.version_min = MESH_UART_PROTOCOL_VERSION_MIN,
+		.version_max = MESH_UART_PROTOCOL_VERSION};
+
+	int err = link_request_sync(&msg, sizeof(msg), CONFIG_MESH_UART_REQUEST_TIMEOUT_MS);
+	if (err)
+	{
+		return err;
+	}
+
+	uint8_t version = mesh_uart_version_negotiate(link_sync_rsp.hello.version_min,
+						      link_sync_rsp.hello.version_max);
+	if (!version)
+	{
+		LOG_ERR("nRF52840 speaks protocol versions %d to %d, supported are %d to %d",
+			link_sync_rsp.hello.version_min, link_sync_rsp.hello.version_max,
+			MESH_UART_PROTOCOL_VERSION_MIN, MESH_UART_PROTOCOL_VERSION);
+		return -EPROTONOSUPPORT;
+	}
+	LOG_INF("Using protocol version %d", version);
+	mesh_uart_tx_queue_version_set(&uart_tx_queue, version);
+
+	link_peer_baudrate_max = link_sync_rsp.hello.baudrate_max;
+	return 0;
+}
+
+static int link_baudrate_apply(uint32_t baudrate)
+{
+	struct uart_config cfg;
+
+	int err = uart_config_get(mesh_uart, &cfg);
+	if (err)
+	{
+		return err;
+	}
+	cfg.baudrate = baudrate;
+	err = uart_configure(mesh_uart, &cfg);
+	if (err)
+	{
+		return err;
+	}
+	link_baudrate = baudrate;
+	mesh_uart_rx_baudrate_set(&uart_rx, baudrate);
+	return 0;
+}
+
+static void link_test_done(int err, const union mesh_uart_msg *rsp, void *user_data)
+{
+	if (!err && rsp->header.type == STATUS)
+	{
+		err = rsp->status.data.status;
+	}
+	if (err)
+	{
+		atomic_set(&link_test_err, err);
+	}
+	k_sem_give(&link_test_sem);
+}
+
+/* Send a burst of test frames and wait for all of them to be answered. The throughput counts the
+ * framed bytes of the test frames and their answers.
+ */
+static int link_self_test(uint32_t *bytes_per_sec)
+{
+	struct mesh_uart_link_test_msg msg = {
+		.header = {
+			.type = LINK_TEST,
+		},
+	};
+	uint32_t crc_errors = uart_frame_parser.stats.crc_errors;
+	uint32_t start = k_uptime_get_32();
+	int sent = 0;
+	int err = 0;
+
+	atomic_set(&link_test_err, 0);
+	k_sem_reset(&link_test_sem);
+
+	for (int i = 0; i < CONFIG_MESH_UART_LINK_TEST_FRAMES; i++)
+	{
+		msg.seed = i;
+		for (int j = 0; j < MESH_UART_LINK_TEST_LEN; j++)
+		{
+			msg.pattern[j] = MESH_UART_LINK_TEST_BYTE(msg.seed, j);
+		}
+		err = mesh_uart_request_send(&uart_requester, &msg, sizeof(msg),
+					     CONFIG_MESH_UART_LINK_TEST_TIMEOUT_MS, link_test_done, NULL);
+		if (err)
+		{
+			break;
+		}
+		sent++;
+	}
+
+	for (int i = 0; i < sent; i++)
+	{
+		k_sem_take(&link_test_sem, K_FOREVER);
+	}
+
+	uint32_t elapsed = MAX(k_uptime_get_32() - start, 1);
+	*bytes_per_sec = (uint64_t)sent *
+			 (MESH_UART_FRAME_ENCODED_SIZE(sizeof(msg)) +
+			  MESH_UART_FRAME_ENCODED_SIZE(sizeof(struct mesh_uart_status_msg))) *
+			 MSEC_PER_SEC / elapsed;
+
+	if (!err)
+	{
+		err = atomic_get(&link_test_err);
+	}
+	if (!err && uart_frame_parser.stats.crc_errors != crc_errors)
+	{
+		err = -EIO;
+	}
+	return err;
+}
+
+/* Move both sides to a new baud rate, test it, and go back to the old rate if the test fails. */
+static int link_baudrate_try(uint32_t baudrate)
+{
+	struct mesh_uart_baudrate_msg msg = {
+		.header = {
+			.type = BAUDRATE_SET,
+		},
+		.baudrate = baudrate,
+	};
+	uint32_t fallback = link_baudrate;
+	uint32_t bytes_per_sec = 0;
+
+	int err = link_request_sync(&msg, sizeof(msg), CONFIG_MESH_UART_REQUEST_TIMEOUT_MS);
+	if (err && err != -ETIMEDOUT)
+	{
+		LOG_WRN("nRF52840 refused %u baud: %d", baudrate, err);
+		return err;
+	}
+
+	if (!err)
+	{
+		err = link_baudrate_apply(baudrate);
+	}
+	if (!err)
+	{
+		err = link_self_test(&bytes_per_sec);
+	}
+	if (!err)
+	{
+		msg.header.type = BAUDRATE_COMMIT;
+		err = link_request_sync(&msg, sizeof(msg), CONFIG_MESH_UART_REQUEST_TIMEOUT_MS);
+	}
+	if (err)
+	{
+		LOG_WRN("Link at %u baud failed: %d, falling back to %u baud", baudrate, err, fallback);
+		link_baudrate_apply(fallback);
+		/* Give the nRF52840 time to end its probation and fall back as well. */
+		k_sleep(K_MSEC(MESH_UART_BAUDRATE_PROBATION_MS));
+		return err;
+	}
+
+	LOG_INF("UART link at %u baud, effective throughput %u B/s", baudrate, bytes_per_sec);
+	return 0;
+}
+
+/* Try the supported baud rates in [floor, limit] from the top, and keep the first that works. */
+static void link_negotiate(uint32_t limit, uint32_t floor)
+{
+	limit = MIN(limit, MIN(CONFIG_MESH_UART_BAUDRATE_MAX, link_peer_baudrate_max));
+
+	for (size_t i = 0; i < ARRAY_SIZE(link_baudrates); i++)
+	{
+		if (link_baudrates[i] > limit || link_baudrates[i] == link_baudrate)
+		{
+			continue;
+		}
+		if (link_baudrates[i] < floor)
+		{
+			break;
+		}
+		if (link_baudrate_try(link_baudrates[i]) == 0)
+		{
+			break;
+		}
+	}
+	link_crc_errors_seen = uart_frame_parser.stats.crc_errors;
 }
 
-static int uart_send_clear_to_move(k_timeout_t timeout)
+/* Step down to a lower baud rate if the link has seen too many CRC errors since the last check. */
+static void link_check_errors(void)
 {
-	static struct mesh_uart_clear_to_move_msg msg = {
+	uint32_t crc_errors = uart_frame_parser.stats.crc_errors - link_crc_errors_seen;
+
+	link_crc_errors_seen = uart_frame_parser.stats.crc_errors;
+	if (crc_errors > CONFIG_MESH_UART_CRC_ERROR_LIMIT && link_baudrate > link_baudrate_base)
+	{
+		LOG_WRN("%u CRC errors at %u baud, trying a lower rate", crc_errors, link_baudrate);
+		link_negotiate(link_baudrate - 1, link_baudrate_base);
+	}
+}
+
+/* The link check runs in a work queue of its own, as a renegotiation blocks for longer than the
+ * handler budget of the module, and waits for responses that time out in the system work queue.
+ */
+static K_THREAD_STACK_DEFINE(link_work_stack, CONFIG_MESH_UART_LINK_THREAD_STACK_SIZE);
+static struct k_work_q link_work_q;
+
+/* Only check once no request is in flight and no command is waiting, so the baud rate does not
+ * change underneath a round.
+ */
+static void link_check_work_fn(struct k_work *work)
+{
+	struct k_work_delayable *dwork = k_work_delayable_from_work(work);
+
+	if (!mesh_uart_request_idle(&uart_requester) || k_sem_count_get(&mesh_lane_sem) > 0)
+	{
+		k_work_reschedule_for_queue(&link_work_q, dwork, K_MSEC(CONFIG_MESH_UART_LINK_CHECK_RETRY_MS));
+		return;
+	}
+	link_check_errors();
+}
+static K_WORK_DELAYABLE_DEFINE(link_check_work, link_check_work_fn);
+
+static void link_check_schedule(void)
+{
+	k_work_reschedule_for_queue(&link_work_q, &link_check_work, K_NO_WAIT);
+}
+
+#if defined(CONFIG_MESH_UART_LINK_BENCH)
+/* Link benchmark. A stream of test frames is sent with a full request window while faults are
+ * injected into what the gateway receives. Reports the exchanges per second, the latency of an
+ * exchange, and the longest time without a completed exchange, which is how long the link took
+ * to recover from the worst fault.
+ */
+#define LINK_BENCH_FRAMES CONFIG_MESH_UART_LINK_BENCH_FRAMES
+
+static K_SEM_DEFINE(link_bench_window_sem, MESH_UART_REQUEST_WINDOW, MESH_UART_REQUEST_WINDOW);
+static K_SEM_DEFINE(link_bench_done_sem, 0, 1);
+static uint32_t link_bench_sent_at[LINK_BENCH_FRAMES];
+static uint32_t link_bench_latency_us[LINK_BENCH_FRAMES];
+static uint32_t link_bench_ok;
+static uint32_t link_bench_failed;
+static uint32_t link_bench_last_done;
+static uint32_t link_bench_gap_max_us;
+/* Responses complete in the parser thread, timeouts in the system work queue. */
+static struct k_spinlock link_bench_lock;
+
+static void link_bench_done(int err, const union mesh_uart_msg *rsp, void *user_data)
+{
+	uint32_t i = (uint32_t)(uintptr_t)user_data;
+	uint32_t now = k_cycle_get_32();
+
+	if (!err && rsp->header.type == STATUS)
+	{
+		err = rsp->status.data.status;
+	}
+
+	k_spinlock_key_t key = k_spin_lock(&link_bench_lock);
+	if (err)
+	{
+		link_bench_failed++;
+	}
+	else
+	{
+		link_bench_latency_us[link_bench_ok++] = k_cyc_to_us_floor32(now - link_bench_sent_at[i]);
+		link_bench_gap_max_us = MAX(link_bench_gap_max_us,
+					    k_cyc_to_us_floor32(now - link_bench_last_done));
+		link_bench_last_done = now;
+	}
+
+	bool done = link_bench_ok + link_bench_failed == LINK_BENCH_FRAMES;
+	k_spin_unlock(&link_bench_lock, key);
+
+	if (done)
+	{
+		k_sem_give(&link_bench_done_sem);
+	}
+	k_sem_give(&link_bench_window_sem);
+}
+
+static void link_bench_sort(uint32_t *values, uint32_t count)
+{
+	for (uint32_t i = 1; i < count; i++)
+	{
+		uint32_t value = values[i];
+		uint32_t j = i;
+
+		for (; j > 0 && values[j - 1] > value; j--)
+		{
+			values[j] = values[j - 1];
+		}
+		values[j] = value;
+	}
+}
+
+static void link_bench(void)
+{
+	struct mesh_uart_rx_faults faults = {
+		.drop_ppm = CONFIG_MESH_UART_LINK_BENCH_DROP_PPM,
+		.corrupt_ppm = CONFIG_MESH_UART_LINK_BENCH_CORRUPT_PPM,
+		.latency_ms = CONFIG_MESH_UART_LINK_BENCH_LATENCY_MS,
+	};
+	struct mesh_uart_link_test_msg msg = {
 		.header = {
-			.type = CLEAR_TO_MOVE,
+			.type = LINK_TEST,
 		},
 	};
-	return mesh_uart_send(&msg, sizeof(msg), timeout);
+	struct mesh_uart_rx_faults no_faults = {0};
+
+	link_bench_ok = 0;
+	link_bench_failed = 0;
+	link_bench_gap_max_us = 0;
+	k_sem_reset(&link_bench_done_sem);
+	mesh_uart_rx_faults_set(&uart_rx, &faults);
+
+	uint32_t start = k_uptime_get_32();
+	link_bench_last_done = k_cycle_get_32();
+
+	for (uint32_t i = 0; i < LINK_BENCH_FRAMES; i++)
+	{
+		k_sem_take(&link_bench_window_sem, K_FOREVER);
+
+		msg.seed = i;
+		for (int j = 0; j < MESH_UART_LINK_TEST_LEN; j++)
+		{
+			msg.pattern[j] = MESH_UART_LINK_TEST_BYTE(msg.seed, j);
+		}
+		link_bench_sent_at[i] = k_cycle_get_32();
+		int err = mesh_uart_request_send(&uart_requester, &msg, sizeof(msg),
+						 CONFIG_MESH_UART_LINK_TEST_TIMEOUT_MS, link_bench_done,
+						 (void *)(uintptr_t)i);
+		if (err)
+		{
+			link_bench_done(err, NULL, (void *)(uintptr_t)i);
+		}
+	}
+
+	k_sem_take(&link_bench_done_sem, K_FOREVER);
+	uint32_t elapsed = MAX(k_uptime_get_32() - start, 1);
+	mesh_uart_rx_faults_set(&uart_rx, &no_faults);
+
+	LOG_INF("Link benchmark at %u baud: %u of %u exchanges, %u exchanges/s",
+		link_baudrate, link_bench_ok, LINK_BENCH_FRAMES,
+		link_bench_ok * MSEC_PER_SEC / elapsed);
+	if (link_bench_ok)
+	{
+		link_bench_sort(link_bench_latency_us, link_bench_ok);
+		LOG_INF("Latency p50 %u us, p99 %u us, longest recovery %u us",
+			link_bench_latency_us[link_bench_ok / 2],
+			link_bench_latency_us[link_bench_ok * 99 / 100],
+			link_bench_gap_max_us);
+	}
+	log_link_stats();
 }
+#endif /* CONFIG_MESH_UART_LINK_BENCH */
 
-static int uart_send_movement_config(uint16_t address, uint32_t time, int32_t angle, k_timeout_t timeout)
+static int link_setup(void)
 {
-	static struct mesh_uart_set_movement_config_msg msg;
-	msg.header.type = SET_MOVEMENT_CONFIG;
-	msg.data.addr = address;
-	msg.data.time = time;
-	msg.data.angle = angle;
-	return mesh_uart_send(&msg, sizeof(msg), timeout);
+#if defined(CONFIG_MESH_UART_CODEC_BENCH)
+	if (mesh_uart_codec_bench_run(CONFIG_MESH_UART_CODEC_BENCH_ITERATIONS))
+	{
+		LOG_ERR("UART codec check failed");
+	}
+#endif
+
+	int err = link_hello();
+	if (err)
+	{
+		LOG_ERR("No \"HELLO\" from nRF52840: %d", err);
+		return err;
+	}
+
+	link_negotiate(UINT32_MAX, link_baudrate + 1);
+
+#if defined(CONFIG_MESH_UART_LINK_BENCH)
+	link_bench();
+#endif
+	return 0;
+}
+
+/* Movement configurations waiting to go out in one SET_MOVEMENT_CONFIG_BATCH frame. */
+static struct mesh_uart_movement_config_batch_msg movement_config_batch = {
+	.header = {
+		.type = SET_MOVEMENT_CONFIG_BATCH,
+	},
+};
+
+static int uart_send_movement_config_batch(void)
+{
+	if (movement_config_batch.count == 0)
+	{
+		return 0;
+	}
+
+	LOG_DBG("Sending %d movement configurations", movement_config_batch.count);
+	int err = mesh_uart_request(&movement_config_batch,
+				    MESH_UART_MOVEMENT_CONFIG_BATCH_LEN(movement_config_batch.count),
+				    CONFIG_MESH_UART_REQUEST_TIMEOUT_MS +
+				    movement_config_batch.count * CONFIG_MESH_UART_ROBOT_CONFIG_TIMEOUT_MS);
+	if (err)
+	{
+		return err; // Keep the batch, it goes out with the next flush.
+	}
+	movement_config_batch.count = 0;
+	return 0;
 }
 
-static int uart_data_rx_rdy_handler(struct uart_event_rx event_data)
+static int uart_queue_movement_config(uint16_t address, uint32_t time, int32_t angle)
 {
-	static union mesh_uart_msg msg;
-	static size_t current_msg_len = 0; // Length of currently received fragment
+	if (movement_config_batch.count == MESH_UART_MOVEMENT_CONFIG_BATCH_MAX)
+	{
+		int err = uart_send_movement_config_batch();
+		if (err)
+		{
+			LOG_ERR("Movement configuration of 0x%04x dropped, batch not sent: %d", address, err);
+			op_status_submit(err);
+			return err;
+		}
+	}
+
+	struct mesh_uart_movement_config *config = &movement_config_batch.configs[movement_config_batch.count++];
+	config->addr = address;
+	config->time = time;
+	config->angle = angle;
+	return 0;
+}
 
-	uint8_t *msg_fill_start = ((uint8_t *)&msg) + current_msg_len;
-	memcpy(msg_fill_start, (event_data.buf + event_data.offset), event_data.len);
-	current_msg_len += event_data.len;
+/* Called by the frame parser for every frame that passed the length and CRC checks. */
+static void uart_frame_handler(const uint8_t *payload, size_t len, void *user_data)
+{
+	static union mesh_uart_msg msg; // Kept off the stack.
 
-	LOG_DBG("Message fragment received: length: %d offset: %d", event_data.len, event_data.offset);
-	if (current_msg_len < sizeof(msg.header))
+	int err = mesh_uart_msg_decode(payload, len, &msg);
+	if (err)
 	{
-		return 0; // Header not yet received. Keep waiting for more data.
+		LOG_WRN("Dropping invalid message of length %d: %d", len, err);
+		return;
 	}
 
 	switch (msg.header.type)
 	{
 	case HELLO:
 	{
-		if (current_msg_len < sizeof(msg.hello))
-		{
-			return 0; // Message not complete. Keep waiting for more data.
-		}
+		/* Only ends the request, the link is ready once link_setup() has agreed on it. */
 		LOG_DBG("UART \"HELLO\" received");
-		state_set(STATE_MESH_READY);
-		struct mesh_module_event *evt = new_mesh_module_event();
-		evt->type = MESH_EVT_READY;
-		APP_EVENT_SUBMIT(evt);
+		mesh_uart_request_on_response(&uart_requester, &msg);
 		break;
 	}
 	case ROBOT_ADDED:
 	{
-		if (current_msg_len < sizeof(msg.robot_added))
-		{
-			return 0; // Message not complete. Keep waiting for more data.
-		}
 		LOG_DBG("UART \"ROBOT_ADDED\" received");
+		struct mesh_module_event *evt = new_mesh_module_event();
+		evt->type = MESH_EVT_ROBOT_ADDED;
+		evt->data.new_robot = msg.robot_added.data;
+		APP_EVENT_SUBMIT(evt);
 		break;
 	}
 	case STATUS:
 	{
-		if (current_msg_len < sizeof(msg.status))
+		LOG_DBG("UART \"STATUS\" received for request %d", msg.header.seq);
+		if (!mesh_uart_request_on_response(&uart_requester, &msg))
 		{
-			return 0; // Message not complete. Keep waiting for more data.
+			LOG_DBG("No request in flight with sequence number %d", msg.header.seq);
 		}
-		LOG_DBG("UART \"STATUS\" received");
 		break;
 	}
 	case MOVEMENT_REPORTED:
 	{
-		if (current_msg_len < sizeof(msg.movement_reported))
-		{
-			return 0; // Message not complete. Keep waiting for more data.
-		}
 		LOG_DBG("UART \"MOVEMENT_REPORTED\" received");
+		struct mesh_module_event *evt = new_mesh_module_event();
+		evt->type = MESH_EVT_MOVEMENT_REPORTED;
+		evt->data.movement_reported = msg.movement_reported.data;
+		APP_EVENT_SUBMIT(evt);
 		break;
 	}
-	case MOVEMENT_CONFIG_ACCEPTED: {
-		if (current_msg_len < sizeof(msg.movement_config_accepted))
+	case MOVEMENT_REPORTED_BATCH:
+	{
+		uint8_t count = msg.movement_reported_batch.count;
+		LOG_DBG("UART \"MOVEMENT_REPORTED_BATCH\" received, %d robots", count);
+		for (uint8_t i = 0; i < count; i++)
 		{
-			return 0; // Message not complete. Keep waiting for more data.
+			struct mesh_module_event *evt = new_mesh_module_event();
+			evt->type = MESH_EVT_MOVEMENT_REPORTED;
+			evt->data.movement_reported = msg.movement_reported_batch.reports[i];
+			APP_EVENT_SUBMIT(evt);
 		}
+		break;
+	}
+	case MOVEMENT_CONFIG_ACCEPTED: {
 		struct mesh_module_event *evt = new_mesh_module_event();
 		evt->type = MESH_EVT_MOVEMENT_CONFIG_ACCEPTED;
 		evt->data.movement_config = msg.movement_config_accepted.data;
 		APP_EVENT_SUBMIT(evt);
 		break;
 	}
+	case MOVEMENT_CONFIG_ACCEPTED_BATCH:
+	{
+		uint8_t count = msg.movement_config_accepted_batch.count;
+		LOG_DBG("UART \"MOVEMENT_CONFIG_ACCEPTED_BATCH\" received, %d robots", count);
+		for (uint8_t i = 0; i < count; i++)
+		{
+			struct mesh_module_event *evt = new_mesh_module_event();
+			evt->type = MESH_EVT_MOVEMENT_CONFIG_ACCEPTED;
+			evt->data.movement_config = msg.movement_config_accepted_batch.configs[i];
+			APP_EVENT_SUBMIT(evt);
+		}
+		break;
+	}
+	case ROBOT_STATS:
+	{
+		LOG_DBG("UART \"ROBOT_STATS\" received, %d robots", msg.robot_stats.count);
+		robot_stats_add(&msg.robot_stats);
+		break;
+	}
 	default:
 	{
-		LOG_ERR("Unknown message type %d", msg.header.type);
-		current_msg_len = 0;
-		return -EINVAL;
+		LOG_ERR("Unexpected message %s", mesh_uart_msg_name(msg.header.type));
+		break;
 	}
 	}
-	current_msg_len = 0;
+}
 
-	return 0;
+/* Parses the bytes received by the UART interrupt, the frame handler runs here. */
+static void uart_rx_thread_fn(void)
+{
+	mesh_uart_rx_thread_run(&uart_rx);
 }
 
+K_THREAD_DEFINE(mesh_uart_rx_thread, CONFIG_MESH_UART_RX_THREAD_STACK_SIZE,
+				uart_rx_thread_fn, NULL, NULL, NULL,
+				CONFIG_MESH_UART_RX_THREAD_PRIORITY, 0, SYS_FOREVER_MS);
+
 static void uart_callback(const struct device *dev, struct uart_event *event, void *user_data)
 {
 	switch (event->type)
@@ -239,54 +957,22 @@ static void uart_callback(const struct device *dev, struct uart_event *event, vo
 	case UART_TX_DONE:
 	{
 		LOG_DBG("UART_TX_DONE: Sent %d bytes", event->data.tx.len);
-		k_sem_give(&uart_transmit_sem);
+		mesh_uart_tx_queue_on_event(&uart_tx_queue, event);
 		break;
 	}
 	case UART_TX_ABORTED:
 	{
 		LOG_ERR("UART_TX_ABORTED");
-		k_sem_give(&uart_transmit_sem);
+		mesh_uart_tx_queue_on_event(&uart_tx_queue, event);
 		break;
 	}
 	case UART_RX_RDY:
-	{
-		LOG_DBG("UART_RX_RDY");
-		uart_data_rx_rdy_handler(event->data.rx);
-		break;
-	}
 	case UART_RX_BUF_REQUEST:
-	{
-		LOG_DBG("UART_RX_BUF_REQUEST");
-		void *new_buf;
-		int err = k_mem_slab_alloc(&mesh_uart_rx_slab, &new_buf, K_NO_WAIT);
-		if (err)
-		{
-			LOG_ERR("Could not allocate new buffer: Error %d", err);
-		}
-		else
-		{
-			err = uart_rx_buf_rsp(dev, new_buf, CONFIG_MESH_UART_RX_BUF_SIZE);
-			if (err)
-			{
-				LOG_ERR("Could not set new buffer: Error %d", err);
-			}
-		}
-		break;
-	}
 	case UART_RX_BUF_RELEASED:
-	{
-		LOG_DBG("UART_RX_BUF_RELEASED");
-		k_mem_slab_free(&mesh_uart_rx_slab, (void **)&event->data.rx_buf.buf);
-		break;
-	}
 	case UART_RX_DISABLED:
-	{
-		LOG_DBG("UART_RX_DISABLED");
-		break;
-	}
 	case UART_RX_STOPPED:
 	{
-		LOG_DBG("UART_RX_STOPPED: Reason: %d", event->data.rx_stop.reason);
+		mesh_uart_rx_on_event(&uart_rx, event);
 		break;
 	}
 	default:
@@ -317,22 +1003,37 @@ static int init_uart()
 	}
 	LOG_DBG("UART device ready");
 
-	err = uart_callback_set(mesh_uart, uart_callback, NULL);
+	mesh_uart_frame_parser_init(&uart_frame_parser, uart_frame_handler, NULL);
+	mesh_uart_rx_init(&uart_rx, &uart_frame_parser, uart_rx_ring_buf, sizeof(uart_rx_ring_buf),
+			  IS_ENABLED(CONFIG_MESH_UART_RX_PARSE_IN_ISR));
+	k_thread_start(mesh_uart_rx_thread);
+	mesh_uart_tx_queue_init(&uart_tx_queue, mesh_uart);
+	mesh_uart_requester_init(&uart_requester, &uart_tx_queue, CONFIG_MESH_UART_REQUEST_RETRIES);
+
+	struct uart_config cfg;
+	err = uart_config_get(mesh_uart, &cfg);
 	if (err)
 	{
-		LOG_ERR("Failed to set UART callback: Error %d", err);
+		LOG_ERR("Failed to get UART configuration: Error %d", err);
 		return err;
 	}
-	void *initial_rx_buf;
-	err = k_mem_slab_alloc(&mesh_uart_rx_slab, &initial_rx_buf, K_NO_WAIT);
+	link_baudrate = cfg.baudrate;
+	link_baudrate_base = cfg.baudrate;
+
+	err = uart_callback_set(mesh_uart, uart_callback, NULL);
 	if (err)
 	{
-		LOG_ERR("Could not allocate initial RX buffer");
+		LOG_ERR("Failed to set UART callback: Error %d", err);
 		return err;
 	}
-	uart_rx_enable(mesh_uart, initial_rx_buf, CONFIG_MESH_UART_RX_BUF_SIZE, 1000);
-
-	return 0;
+	const struct mesh_uart_rx_buf_config rx_buf_config = {
+		.slab = &mesh_uart_rx_slab,
+		.buf_size = CONFIG_MESH_UART_RX_BUF_SIZE,
+		.timeout_us = CONFIG_MESH_UART_RX_TIMEOUT_US,
+		.timeout_min_us = IS_ENABLED(CONFIG_MESH_UART_RX_TIMEOUT_ADAPTIVE) ?
+			CONFIG_MESH_UART_RX_TIMEOUT_MIN_US : CONFIG_MESH_UART_RX_TIMEOUT_US,
+	};
+	return mesh_uart_rx_enable(&uart_rx, mesh_uart, &rx_buf_config);
 }
 
 /* Module state handlers. */
@@ -347,8 +1048,17 @@ static void on_state_mesh_ready(struct mesh_msg_data *msg)
 		{
 		case ROBOT_EVT_CLEAR_TO_MOVE:
 		{
-			LOG_DBG("Sending \"CLEAR_TO_MOVE\" command.");
-			uart_send_clear_to_move(K_FOREVER);
+			/* The robots must have their configuration before they are cleared to move. */
+			int err = uart_send_movement_config_batch();
+			if (err)
+			{
+				LOG_ERR("Movement configurations not sent, clear to move skipped: %d", err);
+				op_status_submit(err);
+				break;
+			}
+			LOG_DBG("Sending \"CLEAR_TO_MOVE\" command to 0x%04x.", msg->module.robot.data.robot.addr);
+			uart_send_clear_to_move(msg->module.robot.data.robot.addr);
+			log_link_stats();
 			break;
 		}
 		case ROBOT_EVT_MOVEMENT_CONFIGURE: {
@@ -356,7 +1066,33 @@ static void on_state_mesh_ready(struct mesh_msg_data *msg)
 			uint16_t addr = msg->module.robot.data.robot.addr;
 			uint32_t time = msg->module.robot.data.robot.cfg->drive_time;
 			int32_t angle = msg->module.robot.data.robot.cfg->rotation;
-			uart_send_movement_config(addr, time, angle, K_FOREVER);
+			(void)uart_queue_movement_config(addr, time, angle);
+			/* A round configures all robots back to back. Ship the batch once the last
+			 * configuration of the round has been taken from the control lane.
+			 */
+			if (k_msgq_num_used_get(&msgq_mesh_control) == 0 &&
+			    uart_send_movement_config_batch())
+			{
+				LOG_WRN("Movement configurations not sent, retried with the clear to move");
+			}
+			break;
+		}
+		case ROBOT_EVT_GROUPS_CONFIGURE:
+		{
+			LOG_DBG("Configuring groups of robot");
+			uart_send_group_set(msg->module.robot.data.robot.addr, msg->module.robot.data.robot.cfg);
+			break;
+		}
+		case ROBOT_EVT_PARAMS_CONFIGURE:
+		{
+			LOG_DBG("Configuring parameters of robot");
+			uart_send_params_set(msg->module.robot.data.robot.addr, msg->module.robot.data.robot.cfg);
+			break;
+		}
+		case ROBOT_EVT_LINK_STATS_REQUEST:
+		{
+			LOG_DBG("Requesting robot link statistics");
+			uart_send_robot_stats_get();
 			break;
 		}
 		default:
@@ -375,6 +1111,12 @@ static void module_thread_fn(void)
 	LOG_INF("Mesh module thread started");
 	state_set(STATE_MESH_NOT_READY);
 
+	self.thread_id = k_current_get();
+
+	/* The UART and link setup blocks for seconds, longer than the handler budget. The module
+	 * is started afterwards, so that the supervisor does not take the events waiting meanwhile
+	 * for a stuck module.
+	 */
 	int err = init_uart();
 	if (err)
 	{
@@ -383,25 +1125,49 @@ static void module_thread_fn(void)
 	}
 	LOG_DBG("UART initialized");
 
-	err = uart_send_hello(K_FOREVER);
+	k_work_queue_start(&link_work_q, link_work_stack, K_THREAD_STACK_SIZEOF(link_work_stack),
+			   K_LOWEST_APPLICATION_THREAD_PRIO, NULL);
+	err = link_setup();
+	if (err)
+	{
+		LOG_ERR("Link to nRF52840 not set up, mesh stays unavailable: %d", err);
+		SEND_ERROR(mesh, MESH_EVT_ERROR, err);
+	}
+	else
+	{
+		state_set(STATE_MESH_READY);
+		SEND_EVENT(mesh, MESH_EVT_READY);
+	}
 
-	struct mesh_msg_data msg = {0};
+	/* Without a link the module still takes its events, and drops them. */
+	err = module_start(&self);
+	if (err)
+	{
+		LOG_ERR("Failed starting module, error: %d", err);
+		SEND_ERROR(mesh, MESH_EVT_ERROR, err);
+		return;
+	}
+
+	struct mesh_msg_data msg_buf;
+	struct mesh_msg_data *msg;
 	while (true)
 	{
-		k_msgq_get(&msgq_mesh, &msg, K_FOREVER);
+		msg = module_get_next_event(&self, &msg_buf);
 
 		switch (state)
 		{
 		case STATE_MESH_READY:
 		{
-			on_state_mesh_ready(&msg);
+			on_state_mesh_ready(msg);
 			break;
 		}
 		default:
 			break;
 		}
 
-		on_all_states(&msg);
+		on_all_states(msg);
+
+		module_release_event(&self, msg);
 	}
 }
 
@@ -409,5 +1175,8 @@ K_THREAD_DEFINE(mesh_module_thread, CONFIG_MESH_THREAD_STACK_SIZE,
 				module_thread_fn, NULL, NULL, NULL,
 				K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
 
-APP_EVENT_LISTENER(MODULE, app_event_handler);
-APP_EVENT_SUBSCRIBE(MODULE, robot_module_event);
\ No newline at end of file
+MODULE_SUBSCRIBE(self, robot_module_event, ROBOT_EVT_CLEAR_TO_MOVE);
+MODULE_SUBSCRIBE(self, robot_module_event, ROBOT_EVT_MOVEMENT_CONFIGURE);
+MODULE_SUBSCRIBE(self, robot_module_event, ROBOT_EVT_LINK_STATS_REQUEST);
+MODULE_SUBSCRIBE(self, robot_module_event, ROBOT_EVT_GROUPS_CONFIGURE);
+MODULE_SUBSCRIBE(self, robot_module_event, ROBOT_EVT_PARAMS_CONFIGURE);
\ No newline at end of file
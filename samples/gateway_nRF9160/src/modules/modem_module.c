@@ -33,10 +33,8 @@ struct modem_msg_data {
 
 /* Modem module message queue. */
 #define MODEM_QUEUE_ENTRY_COUNT		10
-#define MODEM_QUEUE_BYTE_ALIGNMENT	4
 
-K_MSGQ_DEFINE(msgq_modem, sizeof(struct modem_msg_data),
-	      MODEM_QUEUE_ENTRY_COUNT, MODEM_QUEUE_BYTE_ALIGNMENT);
+MODULE_MSGQ_DEFINE(msgq_modem, struct modem_msg_data, MODEM_QUEUE_ENTRY_COUNT);
 
 static struct module_data self = {
 	.name = "modem",
@@ -74,36 +72,6 @@ static void state_set(enum state_type new_state)
 }
 
 /* Handlers */
-static bool app_event_handler(const struct app_event_header *aeh)
-{
-	struct modem_msg_data msg = {0};
-	bool enqueue_msg = false;
-
-	if (is_modem_module_event(aeh)) {
-		struct modem_module_event *evt = cast_modem_module_event(aeh);
-		msg.module.modem = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_ui_module_event(aeh)) {
-		struct ui_module_event *evt = cast_ui_module_event(aeh);
-
-		msg.module.ui = *evt;
-		enqueue_msg = true;
-	}
-
-	if (enqueue_msg) {
-		int err = module_enqueue_msg(&self, &msg);
-
-		if (err) {
-			LOG_ERR("Message could not be enqueued");
-			SEND_ERROR(modem, MODEM_EVT_ERROR, err);
-		}
-	}
-
-	return false;
-}
-
 static void lte_evt_handler(const struct lte_lc_evt *const evt)
 {
 	switch (evt->type) {
@@ -215,7 +183,8 @@ static void module_thread_fn(void)
 {
 	int err;
 	LOG_INF("Modem module thread started");
-	struct modem_msg_data msg;
+	struct modem_msg_data msg_buf;
+	struct modem_msg_data *msg;
 
 	self.thread_id = k_current_get();
 
@@ -232,23 +201,25 @@ static void module_thread_fn(void)
 	}
 
 	while (true) {
-		module_get_next_msg(&self, &msg);
+		msg = module_get_next_event(&self, &msg_buf);
 
 		switch (state) {
 		case STATE_DISCONNECTED:
-			on_state_disconnected(&msg);
+			on_state_disconnected(msg);
 			break;
 		case STATE_CONNECTING:
-			on_state_connecting(&msg);
+			on_state_connecting(msg);
 			break;
 		case STATE_CONNECTED:
-			on_state_connected(&msg);
+			on_state_connected(msg);
 			break;
 		default:
 			break;
 		}
 
-		on_all_states(&msg);
+		on_all_states(msg);
+
+		module_release_event(&self, msg);
 	}
 }
 
@@ -256,8 +227,8 @@ K_THREAD_DEFINE(modem_module_thread, CONFIG_MODEM_THREAD_STACK_SIZE,
 		module_thread_fn, NULL, NULL, NULL,
 		K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
 
-APP_EVENT_LISTENER(MODULE, app_event_handler);
-APP_EVENT_SUBSCRIBE(MODULE, modem_module_event);
-APP_EVENT_SUBSCRIBE(MODULE, ui_module_event);
+MODULE_SUBSCRIBE(self, modem_module_event, MODEM_EVT_LTE_CONNECTING);
+MODULE_SUBSCRIBE(self, modem_module_event, MODEM_EVT_LTE_CONNECTED);
+MODULE_SUBSCRIBE(self, modem_module_event, MODEM_EVT_LTE_DISCONNECTED);
 
 
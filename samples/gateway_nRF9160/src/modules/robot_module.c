@@ -41,10 +41,37 @@ struct robot {
 	uint64_t addr;
 	enum robot_state state;
 	struct robot_cfg cfg;
+	/* Mesh link statistics from the nRF52840, valid once link_valid is set. */
+	struct mesh_uart_robot_stats link;
+	bool link_valid;
+	/* Groups the robot was last asked to be in, and the ones it is in, bit i for group i. They
+	 * differ while the request is in flight.
+	 */
+	uint32_t groups_requested;
+	uint32_t groups_configured;
+	/* Groups the robot could not be put in, not asked again until its groups change. */
+	uint32_t groups_failed;
+	/* Parameters changed since they were last sent, and parameters being sent. */
+	bool params_changed;
+	bool params_sending;
 };
 
 static sys_slist_t robot_list;
 
+/* Robot groups, such as teams and arenas, from the shadow. The robots of a group subscribe to
+ * its mesh group address, so that a command for all of them is one message.
+ */
+#define ROBOT_GROUP_ADDR(_index) (0xC000 + (_index))
+
+struct robot_group {
+	char name[CONFIG_ROBOT_GROUP_NAME_LEN + 1];
+	uint16_t members[CONFIG_ROBOT_COUNT_MAX];
+	int member_count;
+	bool used;
+};
+
+static struct robot_group groups[CONFIG_ROBOT_GROUP_COUNT_MAX];
+
 struct robot_msg_data {
 	union {
 		struct ui_module_event ui;
@@ -54,16 +81,52 @@ struct robot_msg_data {
 	} module;
 };
 
-/* Robot module message queue. */
-#define ROBOT_QUEUE_ENTRY_COUNT		10
-#define ROBOT_QUEUE_BYTE_ALIGNMENT	4
+/* Robot module message queue. Round gating events are put in a separate control lane so they
+ * are not held up by a backlog of movement reports. The control lane holds an acknowledgement
+ * from every robot, as a batch of acknowledgements is forwarded one event per robot. The
+ * telemetry lane holds a movement report from every robot, as they all report at the end of a
+ * round.
+ */
+#define ROBOT_CONTROL_QUEUE_ENTRY_COUNT	(CONFIG_ROBOT_COUNT_MAX + 6)
+#define ROBOT_QUEUE_ENTRY_COUNT		(CONFIG_ROBOT_COUNT_MAX + 4)
 
-K_MSGQ_DEFINE(msgq_robot, sizeof(struct robot_msg_data),
-	      ROBOT_QUEUE_ENTRY_COUNT, ROBOT_QUEUE_BYTE_ALIGNMENT);
+enum robot_lane {
+	ROBOT_LANE_CONTROL,
+	ROBOT_LANE_TELEMETRY,
+};
+
+BUILD_ASSERT(ROBOT_CONTROL_QUEUE_ENTRY_COUNT >= MIN(CONFIG_ROBOT_COUNT_MAX,
+						    MESH_UART_MOVEMENT_CONFIG_BATCH_MAX) + 1,
+	     "The control lane must hold a full batch of acknowledgements");
+
+MODULE_MSGQ_DEFINE(msgq_robot_control, struct robot_msg_data, ROBOT_CONTROL_QUEUE_ENTRY_COUNT);
+MODULE_MSGQ_DEFINE(msgq_robot, struct robot_msg_data, ROBOT_QUEUE_ENTRY_COUNT);
+static K_SEM_DEFINE(robot_lane_sem, 0, K_SEM_MAX_LIMIT);
+
+static struct module_lane lanes[] = {
+	[ROBOT_LANE_CONTROL] = { .msg_q = &msgq_robot_control },
+	[ROBOT_LANE_TELEMETRY] = { .msg_q = &msgq_robot },
+};
+
+static const struct module_lane_class lane_classes[] = {
+	MODULE_LANE_CLASS(cloud_module_event, CLOUD_EVT_UPDATE_DELTA, ROBOT_LANE_CONTROL),
+	MODULE_LANE_CLASS(cloud_module_event, CLOUD_EVT_CONNECTED, ROBOT_LANE_CONTROL),
+	MODULE_LANE_CLASS(cloud_module_event, CLOUD_EVT_DISCONNECTED, ROBOT_LANE_CONTROL),
+	MODULE_LANE_CLASS(mesh_module_event, MESH_EVT_MOVEMENT_CONFIG_ACCEPTED,
+			  ROBOT_LANE_CONTROL),
+	MODULE_LANE_CLASS(mesh_module_event, MESH_EVT_ROBOT_STATS_DONE, ROBOT_LANE_CONTROL),
+	MODULE_LANE_CLASS(mesh_module_event, MESH_EVT_GROUPS_CONFIGURED, ROBOT_LANE_CONTROL),
+	MODULE_LANE_CLASS(mesh_module_event, MESH_EVT_PARAMS_CONFIGURED, ROBOT_LANE_CONTROL),
+};
 
 static struct module_data self = {
 	.name = "robot",
-	.msg_q = &msgq_robot,
+	.lanes = lanes,
+	.lane_count = ARRAY_SIZE(lanes),
+	.lane_classes = lane_classes,
+	.lane_class_count = ARRAY_SIZE(lane_classes),
+	.lane_policy = MODULE_LANE_POLICY_STRICT,
+	.lane_sem = &robot_lane_sem,
 	.supports_shutdown = true,
 };
 
@@ -335,6 +398,57 @@ static char* json_encode_robot_movement_config_report(uint64_t addr)
 	return msg;
 }
 
+static char* json_encode_robot_params_report(uint64_t addr)
+{
+	char *msg;
+	char robot_addr[13];
+	cJSON *root_obj;
+	struct robot *robot;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->addr == addr) {
+			break;
+		}
+	}
+	if (robot == NULL) {
+		return NULL;
+	}
+
+	const struct robot_params_cfg *params = &robot->cfg.params;
+	int pid[] = {params->kp, params->ki, params->kd};
+	int trim[] = {params->trim_a, params->trim_b};
+
+	cJSON *robots_obj = cJSON_CreateObject();
+	if (robots_obj == NULL) {
+		return NULL;
+	}
+
+	sprintf(robot_addr, "%x", (uint32_t) ((addr >> 32) & 0xffffffff));
+	sprintf(&robot_addr[4], "%x", (uint32_t) (addr & 0xffffffff));
+	cJSON *robot_obj = cJSON_AddObjectToObject(robots_obj, robot_addr);
+	cJSON *params_obj = cJSON_AddObjectToObject(robot_obj, "params");
+	cJSON *script_obj = cJSON_AddArrayToObject(params_obj, "script");
+	if (script_obj == NULL ||
+	    !cJSON_AddItemToObject(params_obj, "pid", cJSON_CreateIntArray(pid, ARRAY_SIZE(pid))) ||
+	    !cJSON_AddItemToObject(params_obj, "trim", cJSON_CreateIntArray(trim, ARRAY_SIZE(trim)))) {
+		LOG_ERR("unable to report parameters on robot addr %lld", addr);
+		cJSON_Delete(robots_obj);
+		return NULL;
+	}
+
+	for (int i = 0; i < params->script_len; i++) {
+		int step[] = {params->script[i].drive_time, params->script[i].rotation};
+
+		cJSON_AddItemToArray(script_obj, cJSON_CreateIntArray(step, ARRAY_SIZE(step)));
+	}
+
+	root_obj = json_create_reported_object(robots_obj, "robots");
+
+	msg = cJSON_PrintUnformatted(root_obj);
+	cJSON_Delete(root_obj);
+	return msg;
+}
+
 static char* json_encode_robot_led_config_report(uint64_t addr)
 {
 	char *msg;
@@ -416,6 +530,409 @@ static char* json_encode_robot_revolution_count_list(void)
 	return msg;
 }
 
+/* Group functions */
+
+static int group_find(const char *name)
+{
+	for (int i = 0; i < ARRAY_SIZE(groups); i++) {
+		if (groups[i].used && strcmp(groups[i].name, name) == 0) {
+			return i;
+		}
+	}
+
+	return -ENOENT;
+}
+
+static int group_add(const char *name)
+{
+	int index = group_find(name);
+
+	if (index >= 0) {
+		return index;
+	}
+
+	if (strlen(name) > CONFIG_ROBOT_GROUP_NAME_LEN) {
+		return -EINVAL;
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(groups); i++) {
+		if (!groups[i].used) {
+			memset(&groups[i], 0, sizeof(groups[i]));
+			strcpy(groups[i].name, name);
+			groups[i].used = true;
+			return i;
+		}
+	}
+
+	return -ENOMEM;
+}
+
+/* Groups the robot should be in, bit i for group i. */
+static uint32_t robot_groups_get(const struct robot *robot)
+{
+	uint32_t mask = 0;
+
+	for (int i = 0; i < ARRAY_SIZE(groups); i++) {
+		if (!groups[i].used) {
+			continue;
+		}
+
+		for (int j = 0; j < groups[i].member_count; j++) {
+			if (groups[i].members[j] == robot->addr) {
+				mask |= BIT(i);
+				break;
+			}
+		}
+	}
+
+	return mask;
+}
+
+/* Ask the robots whose groups changed to subscribe to their new groups. The nRF52840 changes
+ * the groups of a robot with several acknowledged configuration messages, so one robot is
+ * configured at a time, and the next once the result is in.
+ */
+static void configure_groups(void)
+{
+	struct robot_module_event *event;
+	struct robot *robot;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->groups_requested != robot->groups_configured) {
+			return;
+		}
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		uint32_t mask = robot_groups_get(robot);
+
+		if (mask == robot->groups_configured || mask == robot->groups_failed) {
+			continue;
+		}
+
+		if (__builtin_popcount(mask) > ROBOT_GROUPS_PER_ROBOT_MAX) {
+			LOG_ERR("Robot %lld is in more than %d groups", robot->addr,
+				ROBOT_GROUPS_PER_ROBOT_MAX);
+			continue;
+		}
+
+		robot->cfg.group_count = 0;
+		for (int i = 0; i < ARRAY_SIZE(groups); i++) {
+			if (mask & BIT(i)) {
+				robot->cfg.groups[robot->cfg.group_count++] = ROBOT_GROUP_ADDR(i);
+			}
+		}
+		robot->cfg.group_mask = mask;
+		robot->groups_requested = mask;
+		robot->groups_failed = robot->groups_configured;
+
+		event = new_robot_module_event();
+		event->type = ROBOT_EVT_GROUPS_CONFIGURE;
+		event->data.robot.addr = robot->addr;
+		event->data.robot.cfg = &robot->cfg;
+		APP_EVENT_SUBMIT(event);
+		return;
+	}
+}
+
+/* Send the changed parameters to the robots. The nRF52840 sends them in a segmented message
+ * and waits for the robot to acknowledge, so one robot is configured at a time, and the next
+ * once the result is in.
+ */
+static void configure_params(void)
+{
+	struct robot_module_event *event;
+	struct robot *robot;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->params_sending) {
+			return;
+		}
+	}
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (!robot->params_changed) {
+			continue;
+		}
+
+		robot->params_changed = false;
+		robot->params_sending = true;
+
+		event = new_robot_module_event();
+		event->type = ROBOT_EVT_PARAMS_CONFIGURE;
+		event->data.robot.addr = robot->addr;
+		event->data.robot.cfg = &robot->cfg;
+		APP_EVENT_SUBMIT(event);
+		return;
+	}
+}
+
+/* The result carries the groups that were asked for, as the groups of the robot may have
+ * changed again since.
+ */
+static void set_groups_configured(uint16_t addr, uint32_t groups, int status)
+{
+	struct robot *robot;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->addr != addr) {
+			continue;
+		}
+
+		if (status) {
+			LOG_ERR("Failed to configure the groups of robot %d: %d", addr, status);
+			robot->groups_failed = groups;
+		} else {
+			robot->groups_configured = groups;
+		}
+
+		if (robot->groups_requested == groups) {
+			robot->groups_requested = robot->groups_configured;
+		}
+		break;
+	}
+
+	configure_groups();
+}
+
+/* A round is started for the group that holds exactly the robots that are configured for it,
+ * so that the robots of other groups keep still. Without such a group every robot is started.
+ */
+static uint16_t round_addr(void)
+{
+	struct robot *robot;
+
+	for (int i = 0; i < ARRAY_SIZE(groups); i++) {
+		bool match = groups[i].used;
+		bool members = false;
+
+		SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+			bool member = robot->groups_configured & BIT(i);
+
+			if (!match) {
+				break;
+			}
+			match = member == (robot->state != ROBOT_STATE_READY);
+			members |= member;
+		}
+
+		if (match && members) {
+			return ROBOT_GROUP_ADDR(i);
+		}
+	}
+
+	return ROBOT_ADDR_ALL;
+}
+
+static char* json_encode_groups_report(void)
+{
+	char *msg;
+	cJSON *root_obj;
+	struct robot *robot;
+
+	cJSON *groups_obj = cJSON_CreateObject();
+	if (groups_obj == NULL) {
+		return NULL;
+	}
+
+	for (int i = 0; i < ARRAY_SIZE(groups); i++) {
+		if (!groups[i].used) {
+			continue;
+		}
+
+		cJSON *members_obj = cJSON_AddArrayToObject(groups_obj, groups[i].name);
+		if (members_obj == NULL) {
+			cJSON_Delete(groups_obj);
+			return NULL;
+		}
+
+		SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+			if (robot->groups_configured & BIT(i)) {
+				cJSON_AddItemToArray(members_obj, cJSON_CreateNumber(robot->addr));
+			}
+		}
+	}
+
+	root_obj = json_create_reported_object(groups_obj, "groups");
+
+	msg = cJSON_PrintUnformatted(root_obj);
+	cJSON_Delete(root_obj);
+	return msg;
+}
+
+/* Groups are given by name, with the addresses of all their robots. A group set to null is
+ * removed.
+ */
+static int json_get_delta_groups(cJSON *root_obj)
+{
+	cJSON *groups_obj = NULL;
+	cJSON *group_obj = NULL;
+	cJSON *member_obj = NULL;
+
+	groups_obj = json_get_object_in_state(root_obj, "groups");
+	if (groups_obj == NULL) {
+		return -ENODATA;
+	}
+
+	cJSON_ArrayForEach(group_obj, groups_obj) {
+		if (cJSON_IsNull(group_obj)) {
+			int index = group_find(group_obj->string);
+			if (index >= 0) {
+				groups[index].used = false;
+			}
+			continue;
+		}
+
+		int index = group_add(group_obj->string);
+		if (index < 0) {
+			LOG_ERR("could not add group %s: %d", group_obj->string, index);
+			continue;
+		}
+
+		groups[index].member_count = 0;
+		cJSON_ArrayForEach(member_obj, group_obj) {
+			if (groups[index].member_count == ARRAY_SIZE(groups[index].members)) {
+				LOG_ERR("too many robots in group %s", group_obj->string);
+				break;
+			}
+			groups[index].members[groups[index].member_count++] = member_obj->valueint;
+		}
+	}
+
+	configure_groups();
+	return 0;
+}
+
+/* Mesh link functions */
+
+/* Share of the completed movement configurations the robot acknowledged, -1 if none completed. */
+static int link_delivery_pct(const struct mesh_uart_robot_stats *link)
+{
+	uint32_t completed = link->acked + link->timeouts;
+
+	if (completed == 0) {
+		return -1;
+	}
+
+	return link->acked * 100 / completed;
+}
+
+/* Median round trip time, as the upper edge of the bin it is in. 0 if none was measured. */
+static uint32_t link_rtt_median_ms(const struct mesh_uart_robot_stats *link)
+{
+	uint32_t total = 0;
+	uint32_t count = 0;
+
+	for (int i = 0; i < MESH_UART_ROBOT_STATS_RTT_BINS; i++) {
+		total += link->rtt_bins[i];
+	}
+
+	for (int i = 0; i < MESH_UART_ROBOT_STATS_RTT_BINS; i++) {
+		count += link->rtt_bins[i];
+		if (total > 0 && 2 * count >= total) {
+			return MESH_UART_ROBOT_STATS_RTT_BIN_MS << i;
+		}
+	}
+
+	return 0;
+}
+
+static bool link_is_weak(const struct mesh_uart_robot_stats *link)
+{
+	int delivery_pct = link_delivery_pct(link);
+
+	return (delivery_pct >= 0 && delivery_pct < CONFIG_ROBOT_LINK_DELIVERY_MIN_PCT) ||
+	       link_rtt_median_ms(link) > CONFIG_ROBOT_LINK_RTT_MAX_MS ||
+	       (link->rssi != 0 && link->rssi < CONFIG_ROBOT_LINK_RSSI_MIN);
+}
+
+static char* json_encode_robot_link_stats_report(void)
+{
+	char *msg;
+	char robot_addr[13];
+	cJSON *root_obj;
+
+	cJSON *robots_obj = cJSON_CreateObject();
+	if (robots_obj == NULL) {
+		return NULL;
+	}
+
+	struct robot *robot;
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (!robot->link_valid) {
+			continue;
+		}
+
+		cJSON *robot_obj = cJSON_CreateObject();
+		if (robot_obj == NULL) {
+			cJSON_Delete(robots_obj);
+			return NULL;
+		}
+
+		sprintf(robot_addr, "%x", (uint32_t) ((robot->addr >> 32) & 0xffffffff));
+		sprintf(&robot_addr[4], "%x", (uint32_t) (robot->addr & 0xffffffff));
+		cJSON_AddItemToObject(robots_obj, robot_addr, robot_obj);
+
+		cJSON *link_obj = cJSON_AddObjectToObject(robot_obj, "link");
+		if (link_obj == NULL ||
+		    !cJSON_AddNumberToObject(link_obj, "deliveryPct", link_delivery_pct(&robot->link)) ||
+		    !cJSON_AddNumberToObject(link_obj, "rttMedianMs", link_rtt_median_ms(&robot->link)) ||
+		    !cJSON_AddNumberToObject(link_obj, "timeouts", robot->link.timeouts) ||
+		    !cJSON_AddNumberToObject(link_obj, "retries", robot->link.retries) ||
+		    !cJSON_AddNumberToObject(link_obj, "rssi", robot->link.rssi) ||
+		    !cJSON_AddNumberToObject(link_obj, "hops", robot->link.hops) ||
+		    !cJSON_AddNumberToObject(link_obj, "lastSeenMs", robot->link.last_seen_ms) ||
+		    !cJSON_AddBoolToObject(link_obj, "weak", link_is_weak(&robot->link))) {
+			LOG_ERR("unable to report link statistics on robot addr %lld", robot->addr);
+			cJSON_Delete(robots_obj);
+			return NULL;
+		}
+	}
+
+	root_obj = json_create_reported_object(robots_obj, "robots");
+
+	msg = cJSON_PrintUnformatted(root_obj);
+	cJSON_Delete(root_obj);
+	return msg;
+}
+
+/* Parameters are given as {"pid": [kp, ki, kd], "trim": [a, b], "script": [[driveTimeMs, angleDeg],
+ * ...]}, gains and trims in thousandths. Parts that are left out keep their values, except the
+ * script, which is empty unless given.
+ */
+static int json_get_robot_params(struct robot_params_cfg *params, cJSON *params_obj)
+{
+	cJSON *value_obj;
+	cJSON *step_obj;
+	int *pid[] = {&params->kp, &params->ki, &params->kd};
+	int *trim[] = {&params->trim_a, &params->trim_b};
+
+	value_obj = json_object_decode(params_obj, "pid");
+	for (int i = 0; i < ARRAY_SIZE(pid) && cJSON_GetArrayItem(value_obj, i) != NULL; i++) {
+		*pid[i] = cJSON_GetArrayItem(value_obj, i)->valueint;
+	}
+
+	value_obj = json_object_decode(params_obj, "trim");
+	for (int i = 0; i < ARRAY_SIZE(trim) && cJSON_GetArrayItem(value_obj, i) != NULL; i++) {
+		*trim[i] = cJSON_GetArrayItem(value_obj, i)->valueint;
+	}
+
+	value_obj = json_object_decode(params_obj, "script");
+	if (cJSON_GetArraySize(value_obj) > ROBOT_SCRIPT_STEPS_MAX) {
+		LOG_ERR("script longer than %d steps", ROBOT_SCRIPT_STEPS_MAX);
+		return -EINVAL;
+	}
+
+	params->script_len = 0;
+	cJSON_ArrayForEach(step_obj, value_obj) {
+		struct robot_script_step *step = &params->script[params->script_len++];
+
+		step->drive_time = cJSON_GetArrayItem(step_obj, 0) ? cJSON_GetArrayItem(step_obj, 0)->valueint : 0;
+		step->rotation = cJSON_GetArrayItem(step_obj, 1) ? cJSON_GetArrayItem(step_obj, 1)->valueint : 0;
+	}
+	return 0;
+}
+
 static int json_get_delta_robot_config(cJSON *root_obj)
 {
 	char robot_addr[13];
@@ -460,6 +977,17 @@ static int json_get_delta_robot_config(cJSON *root_obj)
 			movement_config = true;
 		}
 
+		/* A script is the movement of the round, and replaces the one above. */
+		value_obj = json_object_decode(robot_obj, "params");
+		if(value_obj != NULL && json_get_robot_params(&robot->cfg.params, value_obj) == 0) {
+			if (robot->cfg.params.script_len > 0) {
+				movement_config = false;
+				robot->state = ROBOT_STATE_CONFIGURING;
+			}
+
+			robot->params_changed = true;
+		}
+
 		value_obj = json_object_decode(robot_obj, "led");
 		if(value_obj != NULL) {
 			led_value_obj = cJSON_GetArrayItem(value_obj, 0);
@@ -499,57 +1027,16 @@ static int json_get_delta_robot_config(cJSON *root_obj)
 		}
 	}
 
+	configure_params();
+
 	// TODO: Ensure that this is the correct place to submit this event
 	struct robot_module_event *clear_to_move_event = new_robot_module_event();
 	clear_to_move_event->type = ROBOT_EVT_CLEAR_TO_MOVE;
+	clear_to_move_event->data.robot.addr = round_addr();
 	APP_EVENT_SUBMIT(clear_to_move_event);
 	return 0;
 }
 
-/* Handlers */
-static bool app_event_handler(const struct app_event_header *aeh)
-{
-	struct robot_msg_data msg = {0};
-	bool enqueue_msg = false;
-
-	if (is_robot_module_event(aeh)) {
-		struct robot_module_event *evt = cast_robot_module_event(aeh);
-		msg.module.robot = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_cloud_module_event(aeh)) {
-		struct cloud_module_event *evt = cast_cloud_module_event(aeh);
-		msg.module.cloud = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_ui_module_event(aeh)) {
-		struct ui_module_event *evt = cast_ui_module_event(aeh);
-
-		msg.module.ui = *evt;
-		enqueue_msg = true;
-	}
-
-	if (is_mesh_module_event(aeh)) {
-		struct mesh_module_event *evt = cast_mesh_module_event(aeh);
-
-		msg.module.mesh = *evt;
-		enqueue_msg = true;
-	}
-
-	if (enqueue_msg) {
-		int err = module_enqueue_msg(&self, &msg);
-
-		if (err) {
-			LOG_ERR("Message could not be enqueued");
-			SEND_ERROR(robot, ROBOT_EVT_ERROR, err);
-		}
-	}
-
-	return false;
-}
-
 /* Functions to report updates */
 static void report_robot_list(void) 
 {	
@@ -590,6 +1077,14 @@ static void report_robot_movement_config(uint64_t addr)
 	APP_EVENT_SUBMIT(event);
 }
 
+static void report_robot_params(uint64_t addr)
+{
+	struct robot_module_event *event = new_robot_module_event();
+	event->type = ROBOT_EVT_REPORT;
+	event->data.str = json_encode_robot_params_report(addr);
+	APP_EVENT_SUBMIT(event);
+}
+
 static void report_robot_led_config(uint64_t addr) 
 {	
 	struct robot_module_event *event = new_robot_module_event();
@@ -605,17 +1100,107 @@ static void report_revolution_count_list(void) {
 	APP_EVENT_SUBMIT(event);
 }
 
+static void report_groups(void)
+{
+	struct robot_module_event *event = new_robot_module_event();
+	event->type = ROBOT_EVT_REPORT;
+	event->data.str = json_encode_groups_report();
+	APP_EVENT_SUBMIT(event);
+}
+
+static void report_link_stats(void)
+{
+	struct robot_module_event *event = new_robot_module_event();
+	event->type = ROBOT_EVT_REPORT;
+	event->data.str = json_encode_robot_link_stats_report();
+	APP_EVENT_SUBMIT(event);
+}
+
+/* A statistics request is in flight, or its result is not handled yet. The mesh module fills the
+ * statistics the result points to again for the next request, so that one waits until then.
+ */
+static bool link_stats_requested;
+static bool link_stats_wanted;
+
+/* The nRF52840 answers with the statistics of every robot it knows of. */
+static void request_link_stats(void)
+{
+	if (link_stats_requested) {
+		link_stats_wanted = true;
+		return;
+	}
+	link_stats_requested = true;
+
+	struct robot_module_event *event = new_robot_module_event();
+	event->type = ROBOT_EVT_LINK_STATS_REQUEST;
+	APP_EVENT_SUBMIT(event);
+}
+
+static void set_link_stats(const struct mesh_uart_robot_stats *link)
+{
+	struct robot *robot;
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->addr == link->addr) {
+			robot->link = *link;
+			robot->link_valid = true;
+			return;
+		}
+	}
+
+	LOG_DBG("Link statistics of unknown robot %d", link->addr);
+}
+
+/* Log the robots with a weak mesh link, so they can be dealt with before a match. */
+static void check_link_stats(void)
+{
+	struct robot *robot;
+	int robots = 0;
+	int weak = 0;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (!robot->link_valid) {
+			continue;
+		}
+
+		robots++;
+		if (!link_is_weak(&robot->link)) {
+			continue;
+		}
+
+		weak++;
+		LOG_WRN("Robot %lld has a weak mesh link: delivery %d%%, %d timeouts, %d retries, "
+			"RTT median %d ms, RSSI %d, %d hops",
+			robot->addr, link_delivery_pct(&robot->link), robot->link.timeouts,
+			robot->link.retries, link_rtt_median_ms(&robot->link), robot->link.rssi,
+			robot->link.hops);
+	}
+
+	LOG_INF("%d of %d robots have a weak mesh link", weak, robots);
+}
+
 static void set_revolution_count(uint64_t addr, int revolutions) 
 {
 	struct robot *robot;
+	bool awaited = false;
+
 	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
 		if (robot->addr == addr) {
+			awaited = robot->state != ROBOT_STATE_READY;
 			robot->state = ROBOT_STATE_READY;
 			robot->cfg.revolutions = revolutions;
 			break;
 		}
 	}
 
+	/* The list is reported once per round, when the last robot of the round has reported.
+	 * Reports from robots that were not part of the round, or repeated ones, only update
+	 * the stored count.
+	 */
+	if (!awaited) {
+		LOG_DBG("Movement report from robot %lld outside of a round", addr);
+		return;
+	}
+
 	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
 		if (robot->state != ROBOT_STATE_READY) {
 			return;
@@ -623,6 +1208,8 @@ static void set_revolution_count(uint64_t addr, int revolutions)
 	}
 
 	report_revolution_count_list();
+	/* The round just ended, and with it the configurations the statistics are counted on. */
+	request_link_stats();
 }
 
 static void set_state_configured(uint64_t addr) 
@@ -643,15 +1230,61 @@ static void set_state_configured(uint64_t addr)
 
 	struct robot_module_event *clear_to_move_event = new_robot_module_event();
 	clear_to_move_event->type = ROBOT_EVT_CLEAR_TO_MOVE;
+	clear_to_move_event->data.robot.addr = round_addr();
 	APP_EVENT_SUBMIT(clear_to_move_event);
 }
 
+static void set_params_configured(uint64_t addr, int status)
+{
+	struct robot *robot;
+
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->addr != addr) {
+			continue;
+		}
+
+		robot->params_sending = false;
+		if (status) {
+			LOG_ERR("Failed to configure the parameters of robot %lld: %d", addr, status);
+			if (robot->state == ROBOT_STATE_CONFIGURING && robot->cfg.params.script_len > 0) {
+				robot->state = ROBOT_STATE_READY;
+			}
+			break;
+		}
+
+		report_robot_params(addr);
+		if (robot->cfg.params.script_len > 0) {
+			/* The script is the movement of the round. */
+			set_state_configured(addr);
+		}
+		break;
+	}
+
+	configure_params();
+}
+
 /* Internal robot list functions */
 static void add_robot(uint64_t addr) 
 {
-	struct robot *robot = k_malloc(sizeof(struct robot));
+	struct robot *robot;
+	SYS_SLIST_FOR_EACH_CONTAINER(&robot_list, robot, node) {
+		if (robot->addr == addr) {
+			LOG_DBG("Robot %lld already added", addr);
+			return;
+		}
+	}
+
+	robot = k_calloc(1, sizeof(struct robot));
+	if (robot == NULL) {
+		LOG_ERR("No memory for robot %lld", addr);
+		return;
+	}
 	robot->addr = addr;
+	robot->state = ROBOT_STATE_READY;
 	sys_slist_append(&robot_list, &robot->node);
+
+	/* The robot may have been put in groups before it was added. */
+	configure_groups();
 }
 
 static void remove_robot(uint64_t addr) 
@@ -688,6 +1321,7 @@ static void on_state_cloud_disconnected(struct robot_msg_data *msg)
 	if (IS_EVENT(msg, cloud, CLOUD_EVT_CONNECTED)) {
 			report_clear_robot_list();
 			report_robot_list();
+			request_link_stats();
 
 			state_set(STATE_CLOUD_CONNECTED);
 	}
@@ -704,6 +1338,9 @@ static void on_state_cloud_connected(struct robot_msg_data *msg)
 			LOG_ERR("Root object could not be obtained");
 		}
 
+		/* Groups first, the round of this update may be for one of them. */
+		json_get_delta_groups(root_obj);
+
 		err = json_get_delta_robot_config(root_obj);
 		if (err) {
 			// LOG_ERR("could not get robot config %d", err);
@@ -726,21 +1363,59 @@ static void on_state_cloud_connected(struct robot_msg_data *msg)
 		set_state_configured(msg->module.mesh.data.movement_config.addr); 
 	}
 
+	if (IS_EVENT(msg, mesh, MESH_EVT_PARAMS_CONFIGURED)) {
+		set_params_configured(msg->module.mesh.data.params_configured.addr,
+				      msg->module.mesh.data.params_configured.status);
+	}
+
 	if (IS_EVENT(msg, mesh, MESH_EVT_MOVEMENT_REPORTED)) {
 		set_revolution_count(msg->module.mesh.data.movement_reported.addr, msg->module.mesh.data.movement_reported.yaw); 
 	}
 }
 
-/* Message handler for all states. */
+/* Message handler for all states. Results are reported here rather than in the state handler,
+ * which runs before they are stored.
+ */
 static void on_all_states(struct robot_msg_data *msg)
 { 
+	if (IS_EVENT(msg, mesh, MESH_EVT_ROBOT_STATS_DONE)) {
+		for (uint8_t i = 0; i < msg->module.mesh.data.robot_stats.count; i++) {
+			set_link_stats(&msg->module.mesh.data.robot_stats.robots[i]);
+		}
+	}
+
+	if (IS_EVENT(msg, mesh, MESH_EVT_GROUPS_CONFIGURED)) {
+		set_groups_configured(msg->module.mesh.data.groups_configured.addr,
+				      msg->module.mesh.data.groups_configured.groups,
+				      msg->module.mesh.data.groups_configured.status);
+		if (state == STATE_CLOUD_CONNECTED) {
+			report_groups();
+		}
+	}
 
+	if (IS_EVENT(msg, mesh, MESH_EVT_ROBOT_STATS_DONE) &&
+	    msg->module.mesh.data.robot_stats.status == 0) {
+		check_link_stats();
+		if (state == STATE_CLOUD_CONNECTED) {
+			report_link_stats();
+		}
+	}
+
+	/* Done with the statistics of the event, the mesh module may fill them again. */
+	if (IS_EVENT(msg, mesh, MESH_EVT_ROBOT_STATS_DONE)) {
+		link_stats_requested = false;
+		if (link_stats_wanted) {
+			link_stats_wanted = false;
+			request_link_stats();
+		}
+	}
 }
 
 static void module_thread_fn(void)
 {
 	int err;
-	struct robot_msg_data msg;
+	struct robot_msg_data msg_buf;
+	struct robot_msg_data *msg;
 
 	LOG_INF("Robot module thread started");
 
@@ -755,20 +1430,22 @@ static void module_thread_fn(void)
 	sys_slist_init(&robot_list);
 
 	while (true) {
-		module_get_next_msg(&self, &msg);
+		msg = module_get_next_event(&self, &msg_buf);
 
 		switch (state) {
 		case STATE_CLOUD_DISCONNECTED:
-			on_state_cloud_disconnected(&msg);
+			on_state_cloud_disconnected(msg);
 			break;
 		case STATE_CLOUD_CONNECTED:
-			on_state_cloud_connected(&msg);
+			on_state_cloud_connected(msg);
 			break;
 		default:
 			break;
 		}
 
-		on_all_states(&msg);
+		on_all_states(msg);
+
+		module_release_event(&self, msg);
 	}
 }
 
@@ -776,8 +1453,12 @@ K_THREAD_DEFINE(robot_module_thread, CONFIG_ROBOT_THREAD_STACK_SIZE,
 		module_thread_fn, NULL, NULL, NULL,
 		K_LOWEST_APPLICATION_THREAD_PRIO, 0, 0);
 
-APP_EVENT_LISTENER(MODULE, app_event_handler);
-APP_EVENT_SUBSCRIBE(MODULE, robot_module_event);
-APP_EVENT_SUBSCRIBE(MODULE, cloud_module_event);
-APP_EVENT_SUBSCRIBE(MODULE, ui_module_event);
-APP_EVENT_SUBSCRIBE(MODULE, mesh_module_event);
+MODULE_SUBSCRIBE(self, cloud_module_event, CLOUD_EVT_CONNECTED);
+MODULE_SUBSCRIBE(self, cloud_module_event, CLOUD_EVT_DISCONNECTED);
+MODULE_SUBSCRIBE(self, cloud_module_event, CLOUD_EVT_UPDATE_DELTA);
+MODULE_SUBSCRIBE(self, mesh_module_event, MESH_EVT_ROBOT_ADDED);
+MODULE_SUBSCRIBE(self, mesh_module_event, MESH_EVT_MOVEMENT_CONFIG_ACCEPTED);
+MODULE_SUBSCRIBE(self, mesh_module_event, MESH_EVT_MOVEMENT_REPORTED);
+MODULE_SUBSCRIBE(self, mesh_module_event, MESH_EVT_ROBOT_STATS_DONE);
+MODULE_SUBSCRIBE(self, mesh_module_event, MESH_EVT_GROUPS_CONFIGURED);
+MODULE_SUBSCRIBE(self, mesh_module_event, MESH_EVT_PARAMS_CONFIGURED);
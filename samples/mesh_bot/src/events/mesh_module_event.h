@@ -8,6 +8,7 @@ typedef enum {
     MESH_EVT_DISCONNECTED,
     MESH_EVT_MOVEMENT_RECEIVED,
     MESH_EVT_CLEAR_TO_MOVE_RECEIVED,
+    MESH_EVT_PARAMS_RECEIVED, // Read the parameters with model_handler_params_get().
 } mesh_module_event_type;
 
 struct mesh_module_event {
@@ -15,6 +16,10 @@ struct mesh_module_event {
     mesh_module_event_type type;
     union {
         struct robot_movement_set_msg movement; // Should only be read when type == MESH_EVT_MOVEMENT_RECEIVED
+        struct {
+            uint32_t round;  // Same for every copy of a clear to move.
+            int64_t time;    // Uptime in milliseconds to start at.
+        } start; // Should only be read when type == MESH_EVT_CLEAR_TO_MOVE_RECEIVED
     } data;
 };
 
@@ -9,10 +9,18 @@
 
 #define MODULE main
 #include "events/module_state_event.h"
+#include "events/mesh_module_event.h"
+#include "events/motor_module_event.h"
+#include "modules_common.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(MODULE);
 
+/* Module events are routed to the module queues from here, see MODULE_SUBSCRIBE(). */
+APP_EVENT_LISTENER(MODULE, modules_route_event);
+APP_EVENT_SUBSCRIBE(MODULE, mesh_module_event);
+APP_EVENT_SUBSCRIBE(MODULE, motor_module_event);
+
 void main(void)
 {
 	if (app_event_manager_init()) {
@@ -1,13 +1,25 @@
 #include <zephyr/sys/byteorder.h>
+#include <zephyr/sys/crc.h>
 #include <zephyr/bluetooth/mesh/msg.h>
 
 #include "../../common/mesh_model_defines/robot_movement_srv.h"
 #include "../../common/mesh_model_defines/robot_movement_cli.h"
 #include "model_handler.h"
+#include "time_sync_cli.h"
+
+BUILD_ASSERT(CONFIG_BT_MESH_MODEL_GROUP_COUNT >= ROBOT_MOVEMENT_SRV_GROUPS_MAX,
+             "The movement server cannot subscribe to every group the gateway puts robots in");
+/* 12 bytes per segment, the transport MIC included. */
+BUILD_ASSERT(3 + ROBOT_PARAMS_SET_MSG_LEN(ROBOT_PARAMS_STEPS_MAX) + BT_MESH_MIC_SHORT <= CONFIG_BT_MESH_RX_SEG_MAX * 12,
+             "The longest parameter set takes more segments than CONFIG_BT_MESH_RX_SEG_MAX");
+
+/* Clock synchronized to the gateway. */
+static struct bt_mesh_time_sync_cli time_sync_cli;
 
 /* Application handler functions */
 movement_received_handler_t app_movement_handler;
 start_movement_handler_t app_start_movement_handler;
+params_received_handler_t app_params_handler;
 
 /* SIG models */
 
@@ -64,24 +76,177 @@ static int movement_config_recieved(struct bt_mesh_model *model, struct bt_mesh_
     return err;
 }
 
+/* Status of a multicast movement set. Robots answer in the order of their entries, one slot
+ * apart, so that the answers do not all collide.
+ */
+static struct k_work_delayable multi_status_work;
+static struct bt_mesh_msg_ctx multi_status_ctx;
+static uint8_t multi_status_tid;
+
+static void multi_status_send(struct k_work *work);
+
+static int movement_config_multi_recieved(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx, struct net_buf_simple *buf)
+{
+    uint16_t own_addr = bt_mesh_model_elem(model)->addr;
+    uint8_t tid = net_buf_simple_pull_u8(buf);
+
+    for (int i = 0; buf->len >= ROBOT_MOVEMENT_SET_MULTI_ENTRY_LEN; i++)
+    {
+        uint16_t addr = net_buf_simple_pull_be16(buf);
+        struct robot_movement_set_msg mov_conf;
+        mov_conf.time = net_buf_simple_pull_be32(buf);
+        mov_conf.angle = net_buf_simple_pull_be32(buf);
+        if (addr != own_addr)
+        {
+            continue;
+        }
+
+        if (app_movement_handler != NULL)
+        {
+            app_movement_handler(&mov_conf);
+        }
+        multi_status_ctx = *ctx;
+        multi_status_tid = tid;
+        k_work_reschedule(&multi_status_work, K_MSEC(i * CONFIG_MESH_ROBOT_MULTI_STATUS_SLOT_MS));
+        break;
+    }
+    return 0;
+}
+
+/* Sender of the last clear to move, the movement done status goes back to it. */
+static struct bt_mesh_msg_ctx start_movement_ctx;
+static bool start_movement_ctx_valid;
+
 static int start_movement_recieved(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx, struct net_buf_simple *buf)
 {
+    struct robot_clear_to_move_msg msg;
+    msg.start_ms = net_buf_simple_pull_be32(buf);
+    msg.delay_ms = net_buf_simple_pull_be16(buf);
+    msg.ttl = net_buf_simple_pull_u8(buf);
+
+    /* With a synchronized clock the start time is known directly. Without, every relay on the
+     * way took some of the time that was left.
+     */
+    int64_t start_time;
+    if (time_sync_cli_local_ms_get(&time_sync_cli, msg.start_ms, &start_time))
+    {
+        uint8_t hops = msg.ttl > ctx->recv_ttl ? msg.ttl - ctx->recv_ttl : 0;
+        start_time = k_uptime_get() + msg.delay_ms - hops * CONFIG_MESH_ROBOT_RELAY_DELAY_MS;
+    }
+
+    start_movement_ctx = *ctx;
+    start_movement_ctx_valid = true;
     if (app_start_movement_handler != NULL){
-        app_start_movement_handler();
+        app_start_movement_handler(msg.start_ms, start_time);
     }
     return 0;
 }
 
+/* Last parameter set that was applied. A copy that is resent because the status got lost is only
+ * acknowledged again.
+ */
+static uint16_t params_src;
+static uint8_t params_tid;
+static bool params_valid;
+/* The set itself is copied out under the lock, as the next set may arrive while the application
+ * reads this one.
+ */
+static struct robot_params params_received;
+static struct k_spinlock params_lock;
+
+static int params_status_send(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx, uint8_t tid, uint8_t status)
+{
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_VND_ROBOT_PARAMS_STATUS, sizeof(struct robot_params_status_msg));
+    bt_mesh_model_msg_init(&msg, OP_VND_ROBOT_PARAMS_STATUS);
+    net_buf_simple_add_u8(&msg, tid);
+    net_buf_simple_add_u8(&msg, status);
+    int err = bt_mesh_model_send(model, ctx, &msg, NULL, NULL);
+    if (err)
+    {
+        printk("Failed to send parameter set status (err %d)", err);
+    }
+    return err;
+}
+
+static int params_set_recieved(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx, struct net_buf_simple *buf)
+{
+    struct robot_params params;
+    uint8_t tid = net_buf_simple_pull_u8(buf);
+    uint32_t crc = net_buf_simple_pull_be32(buf);
+
+    if (crc32_ieee(buf->data, buf->len) != crc)
+    {
+        return params_status_send(model, ctx, tid, ROBOT_PARAMS_STATUS_CRC_MISMATCH);
+    }
+    if (params_valid && ctx->addr == params_src && tid == params_tid)
+    {
+        return params_status_send(model, ctx, tid, ROBOT_PARAMS_STATUS_OK);
+    }
+
+    params.kp = net_buf_simple_pull_be16(buf);
+    params.ki = net_buf_simple_pull_be16(buf);
+    params.kd = net_buf_simple_pull_be16(buf);
+    params.trim_a = CLAMP((int16_t)net_buf_simple_pull_be16(buf), -ROBOT_PARAMS_TRIM_MAX, ROBOT_PARAMS_TRIM_MAX);
+    params.trim_b = CLAMP((int16_t)net_buf_simple_pull_be16(buf), -ROBOT_PARAMS_TRIM_MAX, ROBOT_PARAMS_TRIM_MAX);
+    params.step_count = net_buf_simple_pull_u8(buf);
+    if (params.step_count > ROBOT_PARAMS_STEPS_MAX ||
+        buf->len != params.step_count * sizeof(struct robot_movement_set_msg))
+    {
+        return params_status_send(model, ctx, tid, ROBOT_PARAMS_STATUS_INVALID);
+    }
+    for (uint8_t i = 0; i < params.step_count; i++)
+    {
+        params.steps[i].time = net_buf_simple_pull_be32(buf);
+        params.steps[i].angle = net_buf_simple_pull_be32(buf);
+    }
+
+    k_spinlock_key_t key = k_spin_lock(&params_lock);
+    params_received = params;
+    params_src = ctx->addr;
+    params_tid = tid;
+    params_valid = true;
+    k_spin_unlock(&params_lock, key);
+
+    if (app_params_handler != NULL)
+    {
+        app_params_handler();
+    }
+    return params_status_send(model, ctx, tid, ROBOT_PARAMS_STATUS_OK);
+}
+
 static const struct bt_mesh_model_op movement_server_ops[] = {
     {OP_VND_ROBOT_MOVEMENT_SET, BT_MESH_LEN_EXACT(sizeof(struct robot_movement_set_msg)), movement_config_recieved},
-    {OP_VND_ROBOT_CLEAR_TO_MOVE, BT_MESH_LEN_EXACT(0), start_movement_recieved},
+    {OP_VND_ROBOT_CLEAR_TO_MOVE, BT_MESH_LEN_EXACT(ROBOT_CLEAR_TO_MOVE_MSG_LEN), start_movement_recieved},
+    {OP_VND_ROBOT_MOVEMENT_SET_MULTI, BT_MESH_LEN_MIN(1), movement_config_multi_recieved},
+    {OP_VND_ROBOT_PARAMS_SET, BT_MESH_LEN_MIN(ROBOT_PARAMS_SET_MSG_LEN(0)), params_set_recieved},
     BT_MESH_MODEL_OP_END,
 };
 
 static struct bt_mesh_model vendor_models[] = {
     BT_MESH_MODEL_VND(CONFIG_BT_COMPANY_ID, ROBOT_MOVEMENT_SRV_MODEL_ID, movement_server_ops, NULL, NULL),
+    BT_MESH_MODEL_VND_TIME_SYNC_CLI(&time_sync_cli),
 };
 
+static void multi_status_send(struct k_work *work)
+{
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = multi_status_ctx.net_idx,
+        .app_idx = multi_status_ctx.app_idx,
+        .addr = multi_status_ctx.addr,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_VND_ROBOT_MOVEMENT_SET_MULTI_STATUS, sizeof(struct robot_movement_set_multi_status_msg));
+    bt_mesh_model_msg_init(&msg, OP_VND_ROBOT_MOVEMENT_SET_MULTI_STATUS);
+    net_buf_simple_add_u8(&msg, multi_status_tid);
+    net_buf_simple_add_u8(&msg, 0);
+    int err = bt_mesh_model_send(&vendor_models[0], &ctx, &msg, NULL, NULL);
+    if (err)
+    {
+        printk("Failed to send multicast movement status (err %d)", err);
+    }
+}
+
 /* Composition */
 static struct bt_mesh_elem elements[] = {
     BT_MESH_ELEM(0, sig_models, vendor_models),
@@ -94,9 +259,53 @@ static struct bt_mesh_comp comp = {
 };
 
 const struct bt_mesh_comp *model_handler_init(movement_received_handler_t movement_handler,
-    start_movement_handler_t start_movement_handler)
+    start_movement_handler_t start_movement_handler, params_received_handler_t params_handler)
 {
     app_movement_handler = movement_handler;
     app_start_movement_handler = start_movement_handler;
+    app_params_handler = params_handler;
+    k_work_init_delayable(&multi_status_work, multi_status_send);
     return &comp;
-}
\ No newline at end of file
+}
+
+int model_handler_movement_done_send(const struct robot_movement_done_status_msg *status)
+{
+    if (!start_movement_ctx_valid)
+    {
+        return -EINVAL;
+    }
+    struct bt_mesh_msg_ctx ctx = {
+        .net_idx = start_movement_ctx.net_idx,
+        .app_idx = start_movement_ctx.app_idx,
+        .addr = start_movement_ctx.addr,
+        .send_ttl = BT_MESH_TTL_DEFAULT,
+    };
+
+    BT_MESH_MODEL_BUF_DEFINE(msg, OP_VND_ROBOT_MOVEMENT_DONE_STATUS, sizeof(struct robot_movement_done_status_msg));
+    bt_mesh_model_msg_init(&msg, OP_VND_ROBOT_MOVEMENT_DONE_STATUS);
+    net_buf_simple_add_le16(&msg, status->motor_a_rot);
+    net_buf_simple_add_le16(&msg, status->motor_b_rot);
+    net_buf_simple_add_le16(&msg, status->imu.rotation);
+    net_buf_simple_add_le16(&msg, status->imu.local_trans.x);
+    net_buf_simple_add_le16(&msg, status->imu.local_trans.y);
+    net_buf_simple_add_le16(&msg, status->imu.local_trans.z);
+    return bt_mesh_model_send(&vendor_models[0], &ctx, &msg, NULL, NULL);
+}
+
+int model_handler_time_offset_get(int64_t *offset_us, uint32_t *uncertainty_us)
+{
+    return time_sync_cli_offset_get(&time_sync_cli, offset_us, uncertainty_us);
+}
+
+int model_handler_params_get(struct robot_params *params)
+{
+    k_spinlock_key_t key = k_spin_lock(&params_lock);
+    int err = params_valid ? 0 : -ENODATA;
+
+    if (!err)
+    {
+        *params = params_received;
+    }
+    k_spin_unlock(&params_lock, key);
+    return err;
+}
@@ -2,10 +2,48 @@
 
 #include <zephyr/bluetooth/mesh.h>
 #include "../../common/mesh_model_defines/robot_movement_srv.h"
+#include "../../common/mesh_model_defines/robot_movement_cli.h"
 
 typedef void (*movement_received_handler_t)(struct robot_movement_set_msg *);
-typedef void (*start_movement_handler_t)();
+/**
+ * @brief Called for every copy of a clear to move.
+ *
+ * @param round Start time in the time base of the gateway. The same for all copies.
+ * @param start_time Uptime in milliseconds to start at, estimated from this copy.
+ */
+typedef void (*start_movement_handler_t)(uint32_t round, int64_t start_time);
+/**
+ * @brief Called once for every parameter set whose CRC matched. The parameters are read with
+ * model_handler_params_get().
+ */
+typedef void (*params_received_handler_t)(void);
 
 const struct bt_mesh_comp *model_handler_init(
     movement_received_handler_t movement_received_handler,
-    start_movement_handler_t start_movement_handler);
\ No newline at end of file
+    start_movement_handler_t start_movement_handler,
+    params_received_handler_t params_received_handler);
+
+/**
+ * @brief Report to the sender of the last clear to move that the movement is done.
+ *
+ * @param status Movement done status.
+ * @return 0 on success, negative error code otherwise.
+ */
+int model_handler_movement_done_send(const struct robot_movement_done_status_msg *status);
+
+/**
+ * @brief Get the last parameter set that was received.
+ *
+ * @param params Movement parameters and script.
+ * @return 0 on success, -ENODATA if no parameter set has been received.
+ */
+int model_handler_params_get(struct robot_params *params);
+
+/**
+ * @brief Get the estimated offset from local uptime to the time of the gateway.
+ *
+ * @param offset_us Gateway time minus local uptime, in microseconds.
+ * @param uncertainty_us How far the offset may be off, in microseconds.
+ * @return 0 on success, -EAGAIN if the clock is not synchronized yet.
+ */
+int model_handler_time_offset_get(int64_t *offset_us, uint32_t *uncertainty_us);
@@ -10,6 +10,7 @@
 #include "../events/mesh_module_event.h"
 
 #include "../model_handler.h"
+#include "modules_common.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_MESH_MODULE_LOG_LEVEL);
@@ -43,13 +44,33 @@ static void movement_received_handler(struct robot_movement_set_msg *movement) {
     APP_EVENT_SUBMIT(evt);
 }
 
-static void start_movement_handler(void) {
-    LOG_DBG("Starting movement");
+static void start_movement_handler(uint32_t round, int64_t start_time) {
+    LOG_DBG("Clear to move for round %u", round);
     struct mesh_module_event *evt = new_mesh_module_event();
     evt->type = MESH_EVT_CLEAR_TO_MOVE_RECEIVED;
+    evt->data.start.round = round;
+    evt->data.start.time = start_time;
     APP_EVENT_SUBMIT(evt);
 }
 
+static void params_received_handler(void) {
+    LOG_DBG("Parameters received");
+    struct mesh_module_event *evt = new_mesh_module_event();
+    evt->type = MESH_EVT_PARAMS_RECEIVED;
+    APP_EVENT_SUBMIT(evt);
+}
+
+static void movement_done_handler(void) {
+    /* The robot has no rotation or position feedback yet, the report only tells that the
+     * movement is done.
+     */
+    struct robot_movement_done_status_msg status = {0};
+    int err = model_handler_movement_done_send(&status);
+    if (err) {
+        LOG_ERR("Failed to report movement done: Error %d", err);
+    }
+}
+
 /* Setup */
 
 static int setup_mesh()
@@ -61,7 +82,8 @@ static int setup_mesh()
         return err;
     }
     LOG_DBG("Bluetooth initialized");
-    err = bt_mesh_init(bt_mesh_dk_prov_init(), model_handler_init(movement_received_handler, start_movement_handler));
+    err = bt_mesh_init(bt_mesh_dk_prov_init(), model_handler_init(movement_received_handler, start_movement_handler,
+                                                                  params_received_handler));
     if (err) {
         LOG_ERR("Failed to initialize mesh: Error %d", err);
         return err;
@@ -98,16 +120,31 @@ struct mesh_msg_data
 };
 
 /** Module message queue */
-K_MSGQ_DEFINE(mesh_module_msg_q, sizeof(struct mesh_msg_data), 10, 4);
+MODULE_MSGQ_DEFINE(mesh_module_msg_q, struct mesh_msg_data, 10);
+
+static struct module_data self = {
+    .name = "mesh",
+    .msg_q = &mesh_module_msg_q,
+    .supports_shutdown = false,
+};
 
 /* Module thread */
 static void module_thread_fn(void)
 {
     LOG_DBG("Mesh module thread started");
-    struct mesh_msg_data msg;
+    struct mesh_msg_data msg_buf;
+    struct mesh_msg_data *msg;
 
     int err;
 
+    self.thread_id = k_current_get();
+
+    err = module_start(&self);
+    if (err) {
+        LOG_ERR("Failed starting module, error: %d", err);
+        return;
+    }
+
     err = setup_mesh();
 
     if (err) {
@@ -116,7 +153,7 @@ static void module_thread_fn(void)
     }
 
     while (true) {
-        k_msgq_get(&mesh_module_msg_q, &msg, K_FOREVER);
+        msg = module_get_next_event(&self, &msg_buf);
 
         switch(module_state) {
             case UNPROVISIONED: {
@@ -135,6 +172,13 @@ static void module_thread_fn(void)
                 LOG_ERR("Unknown mesh module state %d", module_state);
             }
         }
+
+        if (is_motor_module_event(&msg->event.motor.header) &&
+            msg->event.motor.type == MOTOR_EVT_MOVEMENT_DONE) {
+            movement_done_handler();
+        }
+
+        module_release_event(&self, msg);
     }
 }
 
@@ -149,31 +193,4 @@ K_THREAD_DEFINE(
     0,
     0);
 
-/* Event handling */
-static bool app_event_handler(const struct app_event_header *header)
-{
-    struct mesh_msg_data msg = {0};
-    bool enqueue = false;
-
-    if (is_motor_module_event(header))
-    {
-        LOG_DBG("Motor module event received");
-        struct motor_module_event *evt = cast_motor_module_event(header);
-        msg.event.motor = *evt;
-        enqueue = true;
-    }
-
-    if (enqueue)
-    {
-        int err = k_msgq_put(&mesh_module_msg_q, &msg, K_FOREVER);
-        if (err)
-        {
-            LOG_ERR("Message could not be enqueued");
-        }
-    }
-
-    return false;
-}
-
-APP_EVENT_LISTENER(MODULE, app_event_handler);
-APP_EVENT_SUBSCRIBE(MODULE, motor_module_event);
\ No newline at end of file
+MODULE_SUBSCRIBE(self, motor_module_event, MODULE_SUBTYPE_ANY);
@@ -8,6 +8,7 @@
 #include "../events/motor_module_event.h"
 
 #include "../../drivers/motors/motor.h"
+#include "modules_common.h"
 
 #include <zephyr/logging/log.h>
 LOG_MODULE_REGISTER(MODULE, CONFIG_MOTOR_MODULE_LOG_LEVEL);
@@ -17,7 +18,7 @@ enum motor_module_state
 {
     STANDBY,       // Movement not configured, can not move.
     READY_TO_MOVE, // Movement configured, waiting for clear to move.
-    MOVING,        // In motion. No new new configurations will be accepted.
+    MOVING,        // In motion. Movements are not accepted, parameters are taken once it is done.
 };
 
 static void set_module_state(enum motor_module_state new_state);
@@ -29,9 +30,50 @@ struct motor_msg_data
     union
     {
         struct mesh_module_event mesh;
+        struct motor_module_event motor;
     } event;
 };
-K_MSGQ_DEFINE(motor_module_msg_q, sizeof(struct motor_msg_data), 10, 4);
+
+/* Clear to move has a lane of its own, so that a burst of movements never pushes it out. Only a
+ * newer copy of the clear to move can take the place of an older one. Movements are served first,
+ * as the clear to move only counts once the movement it starts has been received.
+ */
+enum motor_lane
+{
+    MOTOR_LANE_MOVEMENT,
+    MOTOR_LANE_START,
+};
+
+MODULE_MSGQ_DEFINE(motor_module_start_msg_q, struct motor_msg_data, 4);
+MODULE_MSGQ_DEFINE(motor_module_msg_q, struct motor_msg_data, 10);
+static K_SEM_DEFINE(motor_lane_sem, 0, K_SEM_MAX_LIMIT);
+
+static struct module_lane lanes[] = {
+    [MOTOR_LANE_MOVEMENT] = {.msg_q = &motor_module_msg_q},
+    [MOTOR_LANE_START] = {.msg_q = &motor_module_start_msg_q},
+};
+
+static const struct module_lane_class lane_classes[] = {
+    MODULE_LANE_CLASS(mesh_module_event, MESH_EVT_CLEAR_TO_MOVE_RECEIVED, MOTOR_LANE_START),
+    MODULE_LANE_CLASS(mesh_module_event, MESH_EVT_MOVEMENT_RECEIVED, MOTOR_LANE_MOVEMENT),
+    MODULE_LANE_CLASS(mesh_module_event, MESH_EVT_PARAMS_RECEIVED, MOTOR_LANE_MOVEMENT),
+    MODULE_LANE_CLASS(motor_module_event, MOTOR_EVT_MOVEMENT_DONE, MOTOR_LANE_MOVEMENT),
+};
+
+/* A newer movement supersedes an older one, so the oldest message is the one to give up
+ * when a lane overflows.
+ */
+static struct module_data self = {
+    .name = "motor",
+    .lanes = lanes,
+    .lane_count = ARRAY_SIZE(lanes),
+    .lane_classes = lane_classes,
+    .lane_class_count = ARRAY_SIZE(lane_classes),
+    .lane_policy = MODULE_LANE_POLICY_STRICT,
+    .lane_sem = &motor_lane_sem,
+    .overload_policy = MODULE_OVERLOAD_DROP_OLDEST,
+    .supports_shutdown = false,
+};
 
 /* Global module data */
 static const int32_t motor_power = 10000000;
@@ -51,14 +93,51 @@ static int set_next_time(uint32_t time)
     return 0;
 }
 
+/* Parameters from the gateway. A script, if there is one, is driven instead of the next movement,
+ * one step after another in the same round.
+ */
+static struct robot_params params;
+static uint8_t script_len;
+static uint8_t script_step;
+/* Parameters received while moving. They are acknowledged already, and taken once the movement
+ * is done, as the script may be running.
+ */
+static bool params_pending;
+
+static void params_set(void)
+{
+    params_pending = false;
+    if (model_handler_params_get(&params))
+    {
+        return;
+    }
+    script_len = params.step_count;
+    /* The gains are kept for when turning is closed loop. */
+    LOG_DBG("New parameters received: Kp:%d Ki:%d Kd:%d  Trim:%d/%d  Steps:%d",
+            params.kp, params.ki, params.kd, params.trim_a, params.trim_b, script_len);
+}
+
 /* Motor actuation */
 
+static int turn_degrees(int32_t angle);
+static int drive_forward(uint32_t time);
+
 static void stop_motor_work_fn(struct k_work_user *work)
 {
+    if (script_len > 0 && ++script_step < script_len)
+    {
+        LOG_DBG("Script step %d", script_step);
+        turn_degrees(params.steps[script_step].angle);
+        drive_forward(params.steps[script_step].time);
+        return;
+    }
     drive_continous(motor_a, 0);
     drive_continous(motor_b, 0);
     LOG_DBG("Stopped motors");
     set_module_state(STANDBY);
+    struct motor_module_event *evt = new_motor_module_event();
+    evt->type = MOTOR_EVT_MOVEMENT_DONE;
+    APP_EVENT_SUBMIT(evt);
 }
 K_WORK_DELAYABLE_DEFINE(stop_motor_work, stop_motor_work_fn);
 
@@ -68,15 +147,87 @@ static int turn_degrees(int32_t angle)
     return 0;
 }
 
+/* Full power plus the trim of the motor, in thousandths, capped at full power. A motor that is
+ * too fast is evened out by trimming it down.
+ */
+static int32_t trimmed_power(int16_t trim)
+{
+    trim = CLAMP(trim, -ROBOT_PARAMS_TRIM_MAX, ROBOT_PARAMS_TRIM_MAX);
+    return MIN(motor_power + motor_power / 1000 * trim, motor_power);
+}
+
 static int drive_forward(uint32_t time)
 {
-    drive_continous(motor_a, motor_power);
-    drive_continous(motor_b, motor_power);
+    drive_continous(motor_a, trimmed_power(params.trim_a));
+    drive_continous(motor_b, trimmed_power(params.trim_b));
     LOG_DBG("Started motors");
     k_work_schedule(&stop_motor_work, K_MSEC(time));
     return 0;
 }
 
+/* Synchronized start. Every copy of the clear to move gives an estimate of the start time, the
+ * timer is armed for the latest one. The spread of the estimates only shows how much the delivery
+ * of the copies to this robot varied. The start skew between robots also depends on how far
+ * their clocks are apart, and is only known by comparing the gateway times logged at the start.
+ */
+static uint32_t armed_round;
+static uint32_t started_round;
+static bool started_round_valid;
+static uint8_t start_copies;
+static int64_t start_earliest;
+static int64_t start_latest;
+
+static void start_motor_work_fn(struct k_work *work)
+{
+    int64_t offset_us;
+    uint32_t uncertainty_us;
+
+    LOG_INF("Starting round %u: %u copies, local start estimates spread %d ms",
+            armed_round, start_copies, (int32_t)(start_latest - start_earliest));
+    /* Compared between robots, the gateway times of the starts give the start skew, within the
+     * sum of their uncertainties.
+     */
+    if (!model_handler_time_offset_get(&offset_us, &uncertainty_us))
+    {
+        LOG_INF("Started at gateway time %lld us, +/- %u us",
+                k_ticks_to_us_floor64(k_uptime_ticks()) + offset_us, uncertainty_us);
+    }
+    started_round = armed_round;
+    started_round_valid = true;
+    set_module_state(MOVING);
+    if (script_len > 0)
+    {
+        script_step = 0;
+        turn_degrees(params.steps[0].angle);
+        drive_forward(params.steps[0].time);
+        return;
+    }
+    turn_degrees(next_movement.angle);
+    drive_forward(next_movement.time);
+}
+K_WORK_DELAYABLE_DEFINE(start_motor_work, start_motor_work_fn);
+
+static void start_arm(uint32_t round, int64_t start_time)
+{
+    if (started_round_valid && round == started_round)
+    {
+        return; // Late copy of a round that already started.
+    }
+    if (start_copies == 0 || round != armed_round)
+    {
+        armed_round = round;
+        start_copies = 0;
+        start_earliest = start_time;
+        start_latest = start_time;
+    }
+    start_copies++;
+    start_earliest = MIN(start_earliest, start_time);
+    start_latest = MAX(start_latest, start_time);
+
+    int64_t delay = start_time - k_uptime_get();
+    k_work_reschedule(&start_motor_work, K_MSEC(MAX(delay, 0)));
+}
+
 /* State handling*/
 
 static enum motor_module_state module_state = STANDBY; // Current state of the module
@@ -88,7 +239,7 @@ static void set_module_state(enum motor_module_state new_state)
 
 static int on_state_standby(struct motor_msg_data *msg)
 {
-    if (is_mesh_module_event((struct event_header *)(&msg->event.mesh)))
+    if (is_mesh_module_event(&msg->event.mesh.header))
     {
         switch (msg->event.mesh.type)
         {
@@ -97,21 +248,40 @@ static int on_state_standby(struct motor_msg_data *msg)
             set_next_time(msg->event.mesh.data.movement.time);
             set_next_angle(msg->event.mesh.data.movement.angle);
             LOG_DBG("New movement received: Time:%d  Angle:%d", next_movement.time, next_movement.angle);
+            script_len = 0;
             set_module_state(READY_TO_MOVE);
             return 0;
         }
+        case MESH_EVT_PARAMS_RECEIVED:
+        {
+            params_set();
+            if (script_len > 0)
+            {
+                set_module_state(READY_TO_MOVE);
+            }
+            return 0;
+        }
         default:
         {
             return 0;
         }
         }
     }
+    if (is_motor_module_event(&msg->event.motor.header) &&
+        msg->event.motor.type == MOTOR_EVT_MOVEMENT_DONE && params_pending)
+    {
+        params_set();
+        if (script_len > 0)
+        {
+            set_module_state(READY_TO_MOVE);
+        }
+    }
     return 0;
 }
 
 static int on_state_ready_to_move(struct motor_msg_data *msg)
 {
-    if (is_mesh_module_event(&msg->event.mesh))
+    if (is_mesh_module_event(&msg->event.mesh.header))
     {
         switch (msg->event.mesh.type)
         {
@@ -120,14 +290,19 @@ static int on_state_ready_to_move(struct motor_msg_data *msg)
             set_next_time(msg->event.mesh.data.movement.time);
             set_next_angle(msg->event.mesh.data.movement.angle);
             LOG_DBG("New movement received: Time:%d  Angle:%d", next_movement.time, next_movement.angle);
+            script_len = 0;
+            return 0;
+        }
+        case MESH_EVT_PARAMS_RECEIVED:
+        {
+            /* Without a script, the movement that was received still stands. */
+            params_set();
             return 0;
         }
         case MESH_EVT_CLEAR_TO_MOVE_RECEIVED:
         {
-            LOG_DBG("Starting movement");
-            turn_degrees(next_movement.angle);
-            drive_forward(next_movement.time);
-            set_module_state(MOVING);
+            LOG_DBG("Clear to move for round %u", msg->event.mesh.data.start.round);
+            start_arm(msg->event.mesh.data.start.round, msg->event.mesh.data.start.time);
             return 0;
         }
         default:
@@ -136,11 +311,26 @@ static int on_state_ready_to_move(struct motor_msg_data *msg)
         }
         }
     }
+    if (is_motor_module_event(&msg->event.motor.header) &&
+        msg->event.motor.type == MOTOR_EVT_MOVEMENT_DONE && params_pending)
+    {
+        /* The movement was received after the parameters, so it is driven instead of the
+         * script.
+         */
+        params_set();
+        script_len = 0;
+    }
     return 0;
 }
 
 static int on_state_moving(struct motor_msg_data *msg)
 {
+    if (is_mesh_module_event(&msg->event.mesh.header) &&
+        msg->event.mesh.type == MESH_EVT_PARAMS_RECEIVED)
+    {
+        LOG_DBG("Parameters received while moving, taken once the movement is done");
+        params_pending = true;
+    }
     return 0;
 }
 
@@ -170,10 +360,20 @@ static int init_motors()
 static void module_thread_fn(void)
 {
     LOG_DBG("motor module thread started");
-    struct motor_msg_data msg;
+    struct motor_msg_data msg_buf;
+    struct motor_msg_data *msg;
 
     int err;
 
+    self.thread_id = k_current_get();
+
+    err = module_start(&self);
+    if (err)
+    {
+        LOG_ERR("Failed starting module, error: %d", err);
+        return;
+    }
+
     err = init_motors();
     if (err)
     {
@@ -182,23 +382,23 @@ static void module_thread_fn(void)
 
     while (true)
     {
-        k_msgq_get(&motor_module_msg_q, &msg, K_FOREVER);
+        msg = module_get_next_event(&self, &msg_buf);
 
         switch (module_state)
         {
         case STANDBY:
         {
-            on_state_standby(&msg);
+            on_state_standby(msg);
             break;
         }
         case READY_TO_MOVE:
         {
-            on_state_ready_to_move(&msg);
+            on_state_ready_to_move(msg);
             break;
         }
         case MOVING:
         {
-            on_state_moving(&msg);
+            on_state_moving(msg);
             break;
         }
         default:
@@ -206,6 +406,8 @@ static void module_thread_fn(void)
             LOG_ERR("Unknown motor module state %d", module_state);
         }
         }
+
+        module_release_event(&self, msg);
     }
 }
 
@@ -220,29 +422,7 @@ K_THREAD_DEFINE(
     0,
     0);
 
-/* Event handling */
-static bool app_event_handler(const struct app_event_header *header)
-{
-    struct motor_msg_data msg = {0};
-    bool enqueue = false;
-
-    if (is_mesh_module_event(header))
-    {
-        msg.event.mesh = *cast_mesh_module_event(header);
-        enqueue = true;
-    }
-
-    if (enqueue)
-    {
-        int err = k_msgq_put(&motor_module_msg_q, &msg, K_FOREVER);
-        if (err)
-        {
-            LOG_ERR("Message could not be enqueued");
-        }
-    }
-
-    return false;
-}
-
-APP_EVENT_LISTENER(MODULE, app_event_handler);
-APP_EVENT_SUBSCRIBE(MODULE, mesh_module_event);
\ No newline at end of file
+MODULE_SUBSCRIBE(self, mesh_module_event, MESH_EVT_MOVEMENT_RECEIVED);
+MODULE_SUBSCRIBE(self, mesh_module_event, MESH_EVT_PARAMS_RECEIVED);
+MODULE_SUBSCRIBE(self, mesh_module_event, MESH_EVT_CLEAR_TO_MOVE_RECEIVED);
+MODULE_SUBSCRIBE(self, motor_module_event, MOTOR_EVT_MOVEMENT_DONE);
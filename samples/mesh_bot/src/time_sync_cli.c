@@ -0,0 +1,177 @@
+
+#include <zephyr.h>
+#include <zephyr/bluetooth/mesh.h>
+#include "time_sync_cli.h"
+
+#define MODULE time_sync_client
+
+#include <zephyr/logging/log.h>
+LOG_MODULE_REGISTER(MODULE, CONFIG_TIME_SYNC_CLIENT_LOG_LEVEL);
+
+static int64_t local_now_us(void)
+{
+    return k_ticks_to_us_floor64(k_uptime_ticks());
+}
+
+static int64_t offset_predict(const struct bt_mesh_time_sync_cli *time_sync_cli, int64_t local_us)
+{
+    return time_sync_cli->ref_offset_us +
+           (int64_t)time_sync_cli->drift_ppb * (local_us - time_sync_cli->ref_local_us) / 1000000000;
+}
+
+/* Delays make samples spread by milliseconds, so the drift is only measured over minutes. */
+#define DRIFT_BASELINE_MIN_US (60LL * USEC_PER_SEC)
+#define DRIFT_BASELINE_MAX_US (30LL * 60 * USEC_PER_SEC)
+
+static void drift_update(struct bt_mesh_time_sync_cli *time_sync_cli, int64_t local_us, int64_t offset_us)
+{
+    const int64_t limit = (int64_t)CONFIG_MESH_ROBOT_TIME_SYNC_DRIFT_MAX_PPM * 1000;
+    int64_t baseline_us = local_us - time_sync_cli->anchor_local_us;
+
+    if (!time_sync_cli->anchor_valid || baseline_us > DRIFT_BASELINE_MAX_US)
+    {
+        time_sync_cli->anchor_local_us = local_us;
+        time_sync_cli->anchor_offset_us = offset_us;
+        time_sync_cli->anchor_spread_us = time_sync_cli->spread_us;
+        time_sync_cli->anchor_valid = true;
+        return;
+    }
+    if (baseline_us >= DRIFT_BASELINE_MIN_US)
+    {
+        int64_t drift_ppb = (offset_us - time_sync_cli->anchor_offset_us) * 1000000000 / baseline_us;
+        int64_t error_ppb = ((int64_t)time_sync_cli->anchor_spread_us + time_sync_cli->spread_us) *
+                            1000000000 / baseline_us;
+
+        time_sync_cli->drift_ppb = CLAMP(drift_ppb, -limit, limit);
+        time_sync_cli->drift_error_ppb = MIN(error_ppb, 2 * limit);
+        time_sync_cli->drift_valid = true;
+    }
+}
+
+static void clock_update(struct bt_mesh_time_sync_cli *time_sync_cli, int64_t local_us, int64_t offset_us,
+                         uint8_t hops)
+{
+    uint32_t slot = time_sync_cli->samples % TIME_SYNC_CLI_SAMPLES;
+    uint32_t count;
+    uint32_t used = 0;
+    uint8_t hops_min = UINT8_MAX;
+    int64_t best = INT64_MIN;
+    int64_t sum = 0;
+    int64_t window_us = 0;
+
+    time_sync_cli->sample_local_us[slot] = local_us;
+    time_sync_cli->sample_offset_us[slot] = offset_us;
+    time_sync_cli->sample_hops[slot] = hops;
+    time_sync_cli->samples++;
+    count = MIN(time_sync_cli->samples, TIME_SYNC_CLI_SAMPLES);
+
+    /* Every relay hop adds delay that is only compensated on average, so only the samples that
+     * took the fewest hops are used.
+     */
+    for (uint32_t i = 0; i < count; i++)
+    {
+        hops_min = MIN(hops_min, time_sync_cli->sample_hops[i]);
+    }
+
+    /* The samples brought to the time of the newest, the least delayed one wins. */
+    for (uint32_t i = 0; i < count; i++)
+    {
+        if (time_sync_cli->sample_hops[i] != hops_min)
+        {
+            continue;
+        }
+        int64_t age_us = local_us - time_sync_cli->sample_local_us[i];
+        int64_t offset = time_sync_cli->sample_offset_us[i] +
+                         (int64_t)time_sync_cli->drift_ppb * age_us / 1000000000;
+
+        best = MAX(best, offset);
+        sum += offset;
+        used++;
+        window_us = MAX(window_us, age_us);
+    }
+    time_sync_cli->ref_local_us = local_us;
+    time_sync_cli->ref_offset_us = best;
+    /* Few samples tell little about the spread, so the delay of receiving one counts as well. */
+    time_sync_cli->spread_us = best - sum / used + CONFIG_MESH_ROBOT_TIME_SYNC_RX_DELAY_US / used;
+    time_sync_cli->hops = hops_min;
+    time_sync_cli->window_us = window_us;
+
+    if (count == TIME_SYNC_CLI_SAMPLES)
+    {
+        drift_update(time_sync_cli, local_us, best);
+    }
+}
+
+int time_sync_cli_offset_get(const struct bt_mesh_time_sync_cli *time_sync_cli, int64_t *offset_us,
+                             uint32_t *uncertainty_us)
+{
+    if (time_sync_cli->samples == 0)
+    {
+        return -EAGAIN;
+    }
+    int64_t now = local_now_us();
+    /* Drift errors build up from the oldest sample in use. */
+    uint64_t age_us = now - time_sync_cli->ref_local_us + time_sync_cli->window_us;
+    uint64_t drift_error_ppb = time_sync_cli->drift_valid ? time_sync_cli->drift_error_ppb
+                                                          : 2 * CONFIG_MESH_ROBOT_TIME_SYNC_DRIFT_MAX_PPM * 1000;
+
+    *offset_us = offset_predict(time_sync_cli, now);
+    /* A relay hop may differ from the expected delay by a quarter either way. */
+    *uncertainty_us = 2 * time_sync_cli->spread_us + time_sync_cli->hops * CONFIG_MESH_ROBOT_RELAY_DELAY_MS * 250 +
+                      age_us * drift_error_ppb / 1000000000;
+    return 0;
+}
+
+int time_sync_cli_local_ms_get(const struct bt_mesh_time_sync_cli *time_sync_cli, uint32_t gateway_ms,
+                               int64_t *local_ms)
+{
+    if (time_sync_cli->samples == 0)
+    {
+        return -EAGAIN;
+    }
+    int64_t now = local_now_us();
+    int64_t gateway_now_ms = (now + offset_predict(time_sync_cli, now)) / 1000;
+
+    /* Relative to now, which keeps a wrapped 32 bit time usable. */
+    *local_ms = now / 1000 + (int32_t)(gateway_ms - (uint32_t)gateway_now_ms);
+    return 0;
+}
+
+static int handle_time_sync_beacon(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx, struct net_buf_simple *buf)
+{
+    struct bt_mesh_time_sync_cli *time_sync_cli = model->user_data;
+    int64_t rx_us = local_now_us() - CONFIG_MESH_ROBOT_TIME_SYNC_RX_DELAY_US;
+    struct time_sync_beacon_msg msg;
+
+    msg.seq = net_buf_simple_pull_u8(buf);
+    msg.ttl = net_buf_simple_pull_u8(buf);
+    msg.prev_tx_us = net_buf_simple_pull_be48(buf);
+
+    if (msg.prev_tx_us != 0 && time_sync_cli->pending_valid &&
+        time_sync_cli->pending_seq == (uint8_t)(msg.seq - 1))
+    {
+        /* The previous beacon reached us later by the time every relay held it. */
+        int64_t tx_us = msg.prev_tx_us + time_sync_cli->pending_hops * CONFIG_MESH_ROBOT_RELAY_DELAY_MS * 1000;
+
+        clock_update(time_sync_cli, time_sync_cli->pending_rx_us, tx_us - time_sync_cli->pending_rx_us,
+                     time_sync_cli->pending_hops);
+
+        int64_t offset_us;
+        uint32_t uncertainty_us;
+        time_sync_cli_offset_get(time_sync_cli, &offset_us, &uncertainty_us);
+        LOG_DBG("Offset %lld us, drift %d ppb, uncertainty %u us", offset_us, time_sync_cli->drift_ppb,
+                uncertainty_us);
+    }
+
+    time_sync_cli->pending_seq = msg.seq;
+    time_sync_cli->pending_rx_us = rx_us;
+    time_sync_cli->pending_hops = msg.ttl > ctx->recv_ttl ? msg.ttl - ctx->recv_ttl : 0;
+    time_sync_cli->pending_valid = true;
+    return 0;
+}
+
+/* Model operations */
+const struct bt_mesh_model_op time_sync_cli_ops[] = {
+    {OP_VND_TIME_SYNC_BEACON, BT_MESH_LEN_EXACT(TIME_SYNC_BEACON_MSG_LEN), handle_time_sync_beacon},
+    BT_MESH_MODEL_OP_END,
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <zephyr/bluetooth/mesh.h>
+#include "../../common/mesh_model_defines/time_sync.h"
+
+// Defined in time_sync_cli.c
+extern const struct bt_mesh_model_op time_sync_cli_ops[];
+
+/**
+ * Clock synchronized to the time beacons of the gateway.
+ *
+ * Every pair of gateway send time and local receive time of a beacon gives a sample of the offset
+ * from local uptime to gateway time. Delays on the way only ever make a beacon late, which makes
+ * the sample too small, so the offset is taken from the largest of the last samples that passed
+ * the fewest relays. The drift between the clocks is measured between such offsets minutes
+ * apart, and keeps the offset usable between beacons. The uncertainty is how much the samples
+ * spread below the offset, plus what the relays and the drift since the oldest sample may add.
+ */
+#define TIME_SYNC_CLI_SAMPLES 8
+
+struct bt_mesh_time_sync_cli
+{
+    /* Beacon whose send time the next beacon brings. */
+    int64_t pending_rx_us;
+    uint8_t pending_seq;
+    uint8_t pending_hops;
+    bool pending_valid;
+    /* Last samples, as local time and offset. */
+    int64_t sample_local_us[TIME_SYNC_CLI_SAMPLES];
+    int64_t sample_offset_us[TIME_SYNC_CLI_SAMPLES];
+    uint8_t sample_hops[TIME_SYNC_CLI_SAMPLES];
+    uint32_t samples;
+    /* Estimate at the last sample, and the drift in parts per billion. */
+    int64_t ref_local_us;
+    int64_t ref_offset_us;
+    int32_t drift_ppb;
+    uint32_t drift_error_ppb;
+    uint32_t spread_us;
+    int64_t window_us;
+    uint8_t hops;
+    bool drift_valid;
+    /* Earlier estimate the drift is measured from. */
+    int64_t anchor_local_us;
+    int64_t anchor_offset_us;
+    uint32_t anchor_spread_us;
+    bool anchor_valid;
+};
+
+#define BT_MESH_MODEL_VND_TIME_SYNC_CLI(_time_sync_cli)                            \
+    BT_MESH_MODEL_VND_CB(                                                          \
+        CONFIG_BT_COMPANY_ID,                                                      \
+        TIME_SYNC_CLI_MODEL_ID,                                                    \
+        time_sync_cli_ops,                                                         \
+        NULL,                                                                      \
+        BT_MESH_MODEL_USER_DATA(struct bt_mesh_time_sync_cli, _time_sync_cli),     \
+        NULL)
+
+/**
+ * @brief Get the estimated offset from local uptime to gateway time.
+ *
+ * @param time_sync_cli Time sync client.
+ * @param offset_us Gateway time minus local uptime, in microseconds.
+ * @param uncertainty_us How far the offset may be off, in microseconds.
+ * @return 0 on success, -EAGAIN if no beacon pair was received yet.
+ */
+int time_sync_cli_offset_get(const struct bt_mesh_time_sync_cli *time_sync_cli, int64_t *offset_us,
+                             uint32_t *uncertainty_us);
+
+/**
+ * @brief Convert a gateway time in milliseconds to local uptime.
+ *
+ * @param time_sync_cli Time sync client.
+ * @param gateway_ms Gateway uptime in milliseconds, truncated to 32 bits.
+ * @param local_ms Local uptime in milliseconds.
+ * @return 0 on success, -EAGAIN if no beacon pair was received yet.
+ */
+int time_sync_cli_local_ms_get(const struct bt_mesh_time_sync_cli *time_sync_cli, uint32_t gateway_ms,
+                               int64_t *local_ms);
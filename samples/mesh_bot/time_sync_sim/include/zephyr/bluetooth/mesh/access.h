@@ -0,0 +1,58 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* The parts of the Zephyr mesh access API the time sync client uses, for host builds. */
+
+#pragma once
+#include <zephyr.h>
+
+#define BT_MESH_MODEL_OP_3(b0, cid) ((((b0) << 16) | 0xc00000) | (cid))
+#define BT_MESH_LEN_EXACT(len) (-(len))
+#define BT_MESH_MODEL_OP_END {0, 0, NULL}
+
+struct net_buf_simple
+{
+    uint8_t *data;
+    uint16_t len;
+};
+
+struct bt_mesh_msg_ctx
+{
+    uint16_t addr;
+    uint8_t recv_ttl;
+};
+
+struct bt_mesh_model
+{
+    void *user_data;
+};
+
+struct bt_mesh_model_op
+{
+    const uint32_t opcode;
+    const ssize_t len;
+    int (*const func)(struct bt_mesh_model *model, struct bt_mesh_msg_ctx *ctx, struct net_buf_simple *buf);
+};
+
+static inline uint8_t net_buf_simple_pull_u8(struct net_buf_simple *buf)
+{
+    uint8_t val = buf->data[0];
+
+    buf->data++;
+    buf->len--;
+    return val;
+}
+
+static inline uint64_t net_buf_simple_pull_be48(struct net_buf_simple *buf)
+{
+    uint64_t val = 0;
+
+    for (int i = 0; i < 6; i++)
+    {
+        val = (val << 8) | net_buf_simple_pull_u8(buf);
+    }
+    return val;
+}
@@ -0,0 +1,181 @@
+/*
+ * Copyright (c) 2022 Nordic Semiconductor ASA
+ *
+ * SPDX-License-Identifier: LicenseRef-Nordic-5-Clause
+ */
+
+/* Host simulation of the time sync client.
+ *
+ * A gateway sends a time beacon every TIME_SYNC_SRV_PERIOD_MS, which reaches a robot whose clock
+ * drifts from the gateway clock through a number of relays. Every relay holds the beacon for
+ * MESH_ROBOT_RELAY_DELAY_MS, give or take a quarter, and the robot handles it some time after it
+ * was on air. Some beacons are lost. Between beacons the estimated offset is compared with the
+ * true one, and the error with the uncertainty the client reports.
+ *
+ * A scenario fails if more than 1% of the estimates after the first minutes are further off than
+ * their uncertainty.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "time_sync_cli.h"
+
+#define TIME_SYNC_SRV_PERIOD_MS 5000
+#define SIM_DURATION_US (2LL * 60 * 60 * USEC_PER_SEC)
+/* Estimates before this are not judged, the drift is not known yet. */
+#define SIM_SETTLE_US (5LL * 60 * USEC_PER_SEC)
+#define SIM_QUERIES_PER_PERIOD 4
+#define SIM_TTL 7
+
+int64_t sim_local_us;
+
+struct scenario
+{
+    const char *name;
+    int32_t drift_ppm;
+    uint8_t hops_min;
+    uint8_t hops_max;
+    /* Share of beacons lost, in percent. */
+    uint8_t loss_pct;
+};
+
+static const struct scenario scenarios[] = {
+    {"direct, no drift", 0, 0, 0, 0},
+    {"direct, +40 ppm", 40, 0, 0, 10},
+    {"direct, -40 ppm", -40, 0, 0, 10},
+    {"1 to 3 hops, +20 ppm", 20, 1, 3, 10},
+    {"0 to 4 hops, -50 ppm", -50, 0, 4, 30},
+};
+
+static uint32_t rand_state = 0x2545f491;
+
+static uint32_t rand_next(void)
+{
+    uint32_t x = rand_state;
+
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    rand_state = x;
+    return x;
+}
+
+/* Uniform in [low, high]. */
+static int64_t rand_range(int64_t low, int64_t high)
+{
+    return low + (int64_t)(rand_next() % (uint64_t)(high - low + 1));
+}
+
+/* The robot booted a little after the gateway, and its clock runs drift_ppm fast. */
+static int64_t local_from_gateway(const struct scenario *scenario, int64_t gateway_us)
+{
+    const int64_t boot_us = 1234567;
+
+    return (gateway_us - boot_us) + (gateway_us - boot_us) * scenario->drift_ppm / 1000000;
+}
+
+static void beacon_deliver(struct bt_mesh_time_sync_cli *time_sync_cli, uint8_t seq, uint8_t hops,
+                           uint64_t prev_tx_us)
+{
+    struct bt_mesh_model model = {
+        .user_data = time_sync_cli,
+    };
+    struct bt_mesh_msg_ctx ctx = {
+        .recv_ttl = SIM_TTL - hops,
+    };
+    uint8_t data[TIME_SYNC_BEACON_MSG_LEN] = {seq, SIM_TTL};
+    struct net_buf_simple buf = {
+        .data = data,
+        .len = sizeof(data),
+    };
+
+    for (int i = 0; i < 6; i++)
+    {
+        data[2 + i] = prev_tx_us >> (8 * (5 - i));
+    }
+    time_sync_cli_ops[0].func(&model, &ctx, &buf);
+}
+
+static int compare_i64(const void *a, const void *b)
+{
+    int64_t x = *(const int64_t *)a;
+    int64_t y = *(const int64_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+static bool scenario_run(const struct scenario *scenario)
+{
+    static int64_t errors[SIM_DURATION_US / (TIME_SYNC_SRV_PERIOD_MS * 1000) * SIM_QUERIES_PER_PERIOD];
+    struct bt_mesh_time_sync_cli time_sync_cli = {0};
+    uint32_t estimates = 0;
+    uint32_t outside = 0;
+    uint64_t uncertainty_total = 0;
+    uint64_t prev_tx_us = 0;
+    uint8_t seq = 0;
+
+    for (int64_t period_us = TIME_SYNC_SRV_PERIOD_MS * 1000; period_us < SIM_DURATION_US;
+         period_us += TIME_SYNC_SRV_PERIOD_MS * 1000)
+    {
+        /* Waiting in the send queue moves the beacon on air, which the time stamp follows. */
+        int64_t tx_us = period_us + rand_range(0, 30000);
+        uint8_t hops = rand_range(scenario->hops_min, scenario->hops_max);
+        int64_t rx_us = tx_us + CONFIG_MESH_ROBOT_TIME_SYNC_RX_DELAY_US / 2 +
+                        rand_range(0, CONFIG_MESH_ROBOT_TIME_SYNC_RX_DELAY_US);
+
+        for (uint8_t hop = 0; hop < hops; hop++)
+        {
+            rx_us += rand_range(CONFIG_MESH_ROBOT_RELAY_DELAY_MS * 750, CONFIG_MESH_ROBOT_RELAY_DELAY_MS * 1250);
+        }
+
+        seq++;
+        if (rand_next() % 100 >= scenario->loss_pct)
+        {
+            sim_local_us = local_from_gateway(scenario, rx_us);
+            beacon_deliver(&time_sync_cli, seq, hops, prev_tx_us);
+        }
+        prev_tx_us = tx_us;
+
+        for (int i = 0; i < SIM_QUERIES_PER_PERIOD; i++)
+        {
+            int64_t gateway_us = rx_us + rand_range(0, TIME_SYNC_SRV_PERIOD_MS * 1000 - 1);
+            int64_t offset_us;
+            uint32_t uncertainty_us;
+
+            sim_local_us = local_from_gateway(scenario, gateway_us);
+            if (gateway_us < SIM_SETTLE_US || time_sync_cli_offset_get(&time_sync_cli, &offset_us, &uncertainty_us))
+            {
+                continue;
+            }
+
+            int64_t error_us = llabs(sim_local_us + offset_us - gateway_us);
+
+            errors[estimates++] = error_us;
+            outside += error_us > uncertainty_us;
+            uncertainty_total += uncertainty_us;
+        }
+    }
+
+    qsort(errors, estimates, sizeof(errors[0]), compare_i64);
+
+    bool ok = estimates > 0 && outside * 100 <= estimates;
+
+    printf("%-22s %6u estimates, error p50 %5lld us, p99 %6lld us, max %6lld us, "
+           "uncertainty avg %6llu us, %u outside: %s\n",
+           scenario->name, estimates, (long long)errors[estimates / 2], (long long)errors[estimates * 99 / 100],
+           (long long)errors[estimates - 1], (unsigned long long)(uncertainty_total / estimates), outside,
+           ok ? "ok" : "FAILED");
+    return ok;
+}
+
+int main(void)
+{
+    bool ok = true;
+
+    for (size_t i = 0; i < sizeof(scenarios) / sizeof(scenarios[0]); i++)
+    {
+        ok &= scenario_run(&scenarios[i]);
+    }
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}